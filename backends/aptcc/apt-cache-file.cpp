@@ -23,6 +23,7 @@
 
 #include <sstream>
 #include <cstdio>
+#include <cstring>
 #include <apt-pkg/algorithms.h>
 #include <apt-pkg/progress.h>
 #include <apt-pkg/upgrade.h>
@@ -54,6 +55,7 @@ void AptCacheFile::Close()
     delete m_packageRecords;
 
     m_packageRecords = 0;
+    m_versionAttributes.clear();
 
     pkgCacheFile::Close();
 
@@ -451,6 +453,64 @@ std::string AptCacheFile::getLongDescription(const pkgCache::VerIterator &ver)
     }
 }
 
+guint8 AptCacheFile::versionAttributes(const pkgCache::VerIterator &ver)
+{
+    if (m_versionAttributes.empty()) {
+        m_versionAttributes.resize(GetPkgCache()->HeaderP->VersionCount, 0);
+    }
+
+    guint8 &attrs = m_versionAttributes[ver->ID];
+    if (attrs & VERSION_ATTR_KNOWN) {
+        return attrs;
+    }
+    attrs = VERSION_ATTR_KNOWN;
+
+    const char *str = ver.Section() == NULL ? "" : ver.Section();
+    const char *section = strrchr(str, '/');
+    string component;
+    if (section == NULL) {
+        section = str;
+        component = "main";
+    } else {
+        component.assign(str, section - str);
+        section++;
+    }
+
+    const char *name = ver.ParentPkg().Name();
+    if (g_str_has_suffix(name, "-dev") ||
+            g_str_has_suffix(name, "-dbg") ||
+            strcmp(section, "devel") == 0 ||
+            strcmp(section, "libdevel") == 0) {
+        attrs |= VERSION_ATTR_DEVELOPMENT;
+    }
+
+    if (strcmp(section, "x11") == 0 ||
+            strcmp(section, "gnome") == 0 ||
+            strcmp(section, "kde") == 0 ||
+            strcmp(section, "graphics") == 0) {
+        attrs |= VERSION_ATTR_GUI;
+    }
+
+    // Must be in main and universe to be free
+    if (component.compare("main") == 0 ||
+            component.compare("universe") == 0) {
+        attrs |= VERSION_ATTR_FREE;
+    }
+
+    pkgCache::VerFileIterator vf = ver.FileList();
+    const char *origin = vf.end() || vf.File().Origin() == NULL ? "" : vf.File().Origin();
+    if ((strcmp(origin, "Debian") == 0 || strcmp(origin, "Ubuntu") == 0) &&
+            (component.empty() ||
+             component.compare("main") == 0 ||
+             component.compare("restricted") == 0 ||
+             component.compare("unstable") == 0 ||
+             component.compare("testing") == 0)) {
+        attrs |= VERSION_ATTR_SUPPORTED;
+    }
+
+    return attrs;
+}
+
 std::string AptCacheFile::getLongDescriptionParsed(const pkgCache::VerIterator &ver)
 {
     return debParser(getLongDescription(ver));
@@ -27,6 +27,20 @@
 #include <apt-pkg/progress.h>
 #include <pk-backend.h>
 
+#include <vector>
+
+/**
+ * Attributes of a version used by the filters, they only depend on the
+ * package cache so they are computed once per cache
+ */
+enum VersionAttribute {
+    VERSION_ATTR_KNOWN       = 1 << 0,
+    VERSION_ATTR_DEVELOPMENT = 1 << 1,
+    VERSION_ATTR_GUI         = 1 << 2,
+    VERSION_ATTR_FREE        = 1 << 3,
+    VERSION_ATTR_SUPPORTED   = 1 << 4
+};
+
 class pkgProblemResolver;
 class AptCacheFile : public pkgCacheFile
 {
@@ -71,6 +85,12 @@ public:
 
     inline pkgRecords* GetPkgRecords() { buildPkgRecords(); return m_packageRecords; }
 
+    /**
+      * Binds an already opened cache to another job, so progress and
+      * errors are reported to it
+      */
+    inline void setJob(PkBackendJob *job) { m_job = job; }
+
     /**
       * GetPolicy will build the policy object if needed and return it
       * @note This override if because the cache should be built before the policy
@@ -83,6 +103,11 @@ public:
       */
     inline pkgDepCache* GetDepCache() { BuildCaches(); BuildPolicy(); BuildDepCache(); return DCache; }
 
+    /**
+     * Returns the VersionAttribute bits of the given version
+     */
+    guint8 versionAttributes(const pkgCache::VerIterator &ver);
+
     /**
      * Checks if the package is garbage (not depended on)
      */
@@ -148,6 +173,7 @@ private:
 
     pkgRecords *m_packageRecords;
     PkBackendJob *m_job;
+    std::vector<guint8> m_versionAttributes;
 };
 
 /**
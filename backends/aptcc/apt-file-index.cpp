@@ -0,0 +1,344 @@
+/* apt-file-index.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "apt-file-index.h"
+
+#include <apt-pkg/configuration.h>
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+#include "apt-utils.h"
+
+#define DPKG_INFO_DIR               "/var/lib/dpkg/info/"
+#define APT_FILE_INDEX_VERSION      2
+#define APT_FILE_INDEX_FORMAT       "(ua(sxtbas))"
+
+struct FileOwner {
+    string package;
+    gint64 mtime;
+    guint64 size;
+    bool application;
+    vector<string> paths;
+};
+
+struct CStrHash {
+    size_t operator()(const char *s) const { return g_str_hash(s); }
+};
+
+struct CStrEqual {
+    bool operator()(const char *a, const char *b) const { return strcmp(a, b) == 0; }
+};
+
+typedef vector<const FileOwner *> FileOwners;
+
+struct BasenameEntry {
+    string reversed;
+    const char *path;
+    const FileOwners *owners;
+
+    bool operator<(const BasenameEntry &other) const { return reversed < other.reversed; }
+};
+
+// The file lists by the name of their .list file, which is the package
+// name with the architecture for Multi-Arch: same packages. The path
+// and basename tables point into them and are rebuilt after any change.
+static GMutex s_mutex;
+static bool s_loaded = false;
+static std::map<string, FileOwner> s_owners;
+static std::unordered_map<const char *, FileOwners, CStrHash, CStrEqual> s_paths;
+static vector<BasenameEntry> s_basenames;
+
+static string indexPath()
+{
+    return _config->FindDir("Dir::Cache") + "pkgkit-files.bin";
+}
+
+static void rebuildTables()
+{
+    s_paths.clear();
+    s_basenames.clear();
+
+    for (const auto &it : s_owners) {
+        const FileOwner &owner = it.second;
+        for (const string &path : owner.paths) {
+            s_paths[path.c_str()].push_back(&owner);
+        }
+    }
+
+    // sorted by the reversed basename, so the paths ending with a string
+    // are a prefix range
+    s_basenames.reserve(s_paths.size());
+    for (const auto &it : s_paths) {
+        const char *base = strrchr(it.first, '/');
+        BasenameEntry entry;
+        entry.reversed = base != NULL ? base + 1 : it.first;
+        std::reverse(entry.reversed.begin(), entry.reversed.end());
+        entry.path = it.first;
+        entry.owners = &it.second;
+        s_basenames.push_back(entry);
+    }
+    std::sort(s_basenames.begin(), s_basenames.end());
+}
+
+static void load()
+{
+    gchar *data = NULL;
+    gsize len;
+    guint32 version;
+    const gchar *package;
+    gint64 mtime;
+    guint64 size;
+    gboolean application;
+    GVariantIter *paths;
+    const gchar *path;
+    g_autoptr(GVariant) index = NULL;
+    g_autoptr(GVariantIter) iter = NULL;
+
+    if (!g_file_get_contents(indexPath().c_str(), &data, &len, NULL)) {
+        return;
+    }
+
+    index = g_variant_new_from_data(G_VARIANT_TYPE(APT_FILE_INDEX_FORMAT),
+                                    data, len, FALSE, g_free, data);
+    g_variant_get(index, APT_FILE_INDEX_FORMAT, &version, &iter);
+    if (version != APT_FILE_INDEX_VERSION) {
+        return;
+    }
+
+    while (g_variant_iter_next(iter, "(&sxtbas)", &package, &mtime, &size, &application, &paths)) {
+        FileOwner &owner = s_owners[package];
+        owner.package = package;
+        owner.mtime = mtime;
+        owner.size = size;
+        owner.application = application;
+        owner.paths.reserve(g_variant_iter_n_children(paths));
+        while (g_variant_iter_next(paths, "&s", &path)) {
+            owner.paths.push_back(path);
+        }
+        g_variant_iter_free(paths);
+    }
+}
+
+static void save()
+{
+    GVariantBuilder builder;
+    g_autoptr(GVariant) index = NULL;
+    g_autoptr(GError) error = NULL;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(sxtbas)"));
+    for (const auto &it : s_owners) {
+        const FileOwner &owner = it.second;
+        g_variant_builder_open(&builder, G_VARIANT_TYPE("(sxtbas)"));
+        g_variant_builder_add(&builder, "s", owner.package.c_str());
+        g_variant_builder_add(&builder, "x", owner.mtime);
+        g_variant_builder_add(&builder, "t", owner.size);
+        g_variant_builder_add(&builder, "b", owner.application);
+        g_variant_builder_open(&builder, G_VARIANT_TYPE("as"));
+        for (const string &path : owner.paths) {
+            g_variant_builder_add(&builder, "s", path.c_str());
+        }
+        g_variant_builder_close(&builder);
+        g_variant_builder_close(&builder);
+    }
+    index = g_variant_ref_sink(g_variant_new(APT_FILE_INDEX_FORMAT,
+                                             APT_FILE_INDEX_VERSION,
+                                             &builder));
+
+    if (!g_file_set_contents(indexPath().c_str(),
+                             static_cast<const gchar *>(g_variant_get_data(index)),
+                             g_variant_get_size(index),
+                             &error)) {
+        g_warning("failed to save file index: %s", error->message);
+    }
+}
+
+static void updateLocked()
+{
+    DIR *dp;
+    struct dirent *dirp;
+    std::set<string> seen;
+    string line;
+    guint read = 0;
+    bool changed = false;
+
+    if (!s_loaded) {
+        load();
+        rebuildTables();
+        s_loaded = true;
+    }
+
+    if (!(dp = opendir(DPKG_INFO_DIR))) {
+        g_debug("Error opening " DPKG_INFO_DIR);
+        return;
+    }
+
+    while ((dirp = readdir(dp)) != NULL) {
+        if (!ends_with(dirp->d_name, ".list")) {
+            continue;
+        }
+
+        struct stat buf;
+        string file(dirp->d_name);
+        string f = DPKG_INFO_DIR + file;
+        if (stat(f.c_str(), &buf) != 0) {
+            continue;
+        }
+
+        string package = file.erase(file.size() - 5, file.size());
+        seen.insert(package);
+
+        const gint64 mtime = buf.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + buf.st_mtim.tv_nsec;
+        auto it = s_owners.find(package);
+        if (it != s_owners.end() &&
+                it->second.mtime == mtime &&
+                it->second.size == static_cast<guint64>(buf.st_size)) {
+            continue;
+        }
+
+        FileOwner &owner = s_owners[package];
+        owner.package = package;
+        owner.mtime = mtime;
+        owner.size = buf.st_size;
+        owner.application = false;
+        owner.paths.clear();
+
+        ifstream in(f.c_str());
+        while (getline(in, line)) {
+            if (line.empty()) {
+                continue;
+            }
+            if (ends_with(line, ".desktop")) {
+                owner.application = true;
+            }
+            owner.paths.push_back(line);
+        }
+        changed = true;
+        read++;
+    }
+    closedir(dp);
+
+    // packages that were removed
+    for (auto it = s_owners.begin(); it != s_owners.end();) {
+        if (seen.find(it->first) == seen.end()) {
+            it = s_owners.erase(it);
+            changed = true;
+        } else {
+            ++it;
+        }
+    }
+
+    if (changed) {
+        g_debug("file index: read %u file lists", read);
+        rebuildTables();
+        save();
+    }
+}
+
+void AptFileIndex::update()
+{
+    g_mutex_lock(&s_mutex);
+    updateLocked();
+    g_mutex_unlock(&s_mutex);
+}
+
+bool AptFileIndex::search(gchar **values, vector<string> &packages)
+{
+    std::set<string> found;
+
+    // regular expressions are left to the caller, a '.' is taken literally
+    for (guint i = 0; values[i] != NULL; ++i) {
+        if (strpbrk(values[i], "^$*+?()[]{}|\\") != NULL) {
+            return false;
+        }
+    }
+
+    g_mutex_lock(&s_mutex);
+    updateLocked();
+
+    for (guint i = 0; values[i] != NULL; ++i) {
+        const gchar *value = values[i];
+        if (value[0] == '\0') {
+            continue;
+        }
+
+        // a full path
+        if (value[0] == '/') {
+            auto it = s_paths.find(value);
+            if (it != s_paths.end()) {
+                for (const FileOwner *owner : it->second) {
+                    found.insert(owner->package);
+                }
+            }
+            continue;
+        }
+
+        // the end of a path, when it has a directory part the basename
+        // must match exactly, otherwise its end only
+        const gchar *base = strrchr(value, '/');
+        const bool exact = base != NULL;
+        BasenameEntry key;
+        key.reversed = exact ? base + 1 : value;
+        std::reverse(key.reversed.begin(), key.reversed.end());
+
+        for (auto it = std::lower_bound(s_basenames.begin(), s_basenames.end(), key);
+             it != s_basenames.end() && starts_with(it->reversed, key.reversed.c_str());
+             ++it) {
+            if (exact && (it->reversed.size() != key.reversed.size() ||
+                          !g_str_has_suffix(it->path, value))) {
+                continue;
+            }
+            for (const FileOwner *owner : *it->owners) {
+                found.insert(owner->package);
+            }
+        }
+    }
+    g_mutex_unlock(&s_mutex);
+
+    packages.assign(found.begin(), found.end());
+    return true;
+}
+
+bool AptFileIndex::isApplication(const char *name, const char *arch)
+{
+    bool ret = false;
+
+    g_mutex_lock(&s_mutex);
+    if (!s_loaded) {
+        updateLocked();
+    }
+
+    // Multi-Arch: same packages have the architecture in the list name
+    auto it = s_owners.find(string(name) + ":" + arch);
+    if (it == s_owners.end()) {
+        it = s_owners.find(name);
+    }
+    if (it != s_owners.end()) {
+        ret = it->second.application;
+    }
+    g_mutex_unlock(&s_mutex);
+
+    return ret;
+}
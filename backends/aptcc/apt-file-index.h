@@ -0,0 +1,62 @@
+/* apt-file-index.h
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef APT_FILE_INDEX_H
+#define APT_FILE_INDEX_H
+
+#include <glib.h>
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/**
+ * Index of the files owned by the installed packages
+ *
+ * The index is shared by all jobs and mirrors the file lists dpkg keeps
+ * in /var/lib/dpkg/info/. It is saved to disk and kept up to date by
+ * only reading the lists that changed since it was last updated.
+ */
+class AptFileIndex
+{
+public:
+    /**
+     * Rereads the file lists that were added, changed or removed since
+     * the last update, this is cheap when nothing changed
+     */
+    static void update();
+
+    /**
+     * Finds the packages owning the given files, a value starting with
+     * '/' is a full path, anything else matches the end of a path
+     * @returns false if a value cannot be answered by the index, e.g.
+     * when it is a regular expression
+     */
+    static bool search(gchar **values, vector<string> &packages);
+
+    /**
+     * Checks if the installed package ships a desktop file, using the
+     * index as it was last updated
+     */
+    static bool isApplication(const char *name, const char *arch);
+};
+
+#endif // APT_FILE_INDEX_H
@@ -44,11 +44,14 @@
 #include <pty.h>
 
 #include <iostream>
+#include <map>
 #include <memory>
 #include <fstream>
 #include <dirent.h>
 
 #include "apt-cache-file.h"
+#include "apt-file-index.h"
+#include "apt-search-index.h"
 #include "apt-utils.h"
 #include "gst-matcher.h"
 #include "apt-messages.h"
@@ -59,40 +62,293 @@ using namespace APT;
 
 #define RAMFS_MAGIC     0x858458f6
 
+// Jobs share the on-disk package cache under a reader/writer discipline:
+// any number of read-only jobs may have it open at once, while a job that
+// changes the system or the package lists waits for them and excludes
+// everybody else. Waiting writers block new readers so that a
+// RefreshCache is not starved by a stream of queries.
+// This is built on a mutex and condition rather than GRWLock as the lock
+// is released from the main thread when the job is stopped.
+static GMutex s_cacheMutex;
+static GCond s_cacheCond;
+static guint s_cacheReaders = 0;
+static guint s_cacheWritersWaiting = 0;
+static bool s_cacheWriter = false;
+
+// The locale and the proxies live in the process environment, and
+// setlocale() or setenv() in one job races with every other thread that
+// reads them. So readers only share the cache with readers that need the
+// same environment, and it is only changed by the job that takes the lock
+// when nobody else holds it. Readers waiting for another environment hold
+// back new readers of the current one so that they are not starved.
+static string s_cacheEnvironment;
+static std::map<string, guint> s_cacheEnvironmentsWaiting;
+
+// The last cache opened by a query is kept here, so the next query does
+// not have to map the binary cache and rebuild the policy and the
+// dependency cache again. Only one job at a time can use it, a query
+// running next to it opens its own. It is also guarded by s_cacheMutex
+// and dropped whenever the generation changes.
+static AptCacheFile *s_warmCache = nullptr;
+static guint s_warmCacheGeneration = 0;
+static time_t s_warmCacheListsMtime = 0;
+static guint s_cacheGeneration = 0;
+
+// libapt keeps its configuration in process wide state, which concurrent
+// readers must not modify at the same time
+G_LOCK_DEFINE_STATIC(aptcc_config);
+
 AptIntf::AptIntf(PkBackendJob *job) :
     m_cache(0),
     m_job(job),
     m_cancel(false),
+    m_cacheLocked(false),
+    m_cacheWriter(false),
+    m_cacheReady(false),
+    m_cacheGeneration(0),
+    m_fileIndexUpdated(false),
     m_lastSubProgress(0),
     m_terminalTimeout(120)
 {
     m_cancel = false;
 }
 
-bool AptIntf::init(gchar **localDebs)
+bool AptIntf::isCacheWriter() const
 {
-    const gchar *http_proxy;
-    const gchar *ftp_proxy;
+    PkBitfield transactionFlags = pk_backend_job_get_transaction_flags(m_job);
+    bool simulate = pk_bitfield_contain(transactionFlags, PK_TRANSACTION_FLAG_ENUM_SIMULATE);
 
-    m_isMultiArch = APT::Configuration::getArchitectures(false).size() > 1;
+    switch (pk_backend_job_get_role(m_job)) {
+    case PK_ROLE_ENUM_REFRESH_CACHE:
+    case PK_ROLE_ENUM_REPO_ENABLE:
+    case PK_ROLE_ENUM_REPO_SET_DATA:
+    case PK_ROLE_ENUM_REPAIR_SYSTEM:
+    case PK_ROLE_ENUM_INSTALL_SIGNATURE:
+        return true;
+    case PK_ROLE_ENUM_INSTALL_PACKAGES:
+    case PK_ROLE_ENUM_INSTALL_FILES:
+    case PK_ROLE_ENUM_REMOVE_PACKAGES:
+    case PK_ROLE_ENUM_UPDATE_PACKAGES:
+    case PK_ROLE_ENUM_UPGRADE_SYSTEM:
+    case PK_ROLE_ENUM_REPO_REMOVE:
+        return !simulate;
+    default:
+        return false;
+    }
+}
 
-    // set locale
-    setEnvLocaleFromJob();
+bool AptIntf::isCacheShareable() const
+{
+    // only roles that never mark anything in the dependency cache
+    switch (pk_backend_job_get_role(m_job)) {
+    case PK_ROLE_ENUM_SEARCH_NAME:
+    case PK_ROLE_ENUM_SEARCH_DETAILS:
+    case PK_ROLE_ENUM_SEARCH_GROUP:
+    case PK_ROLE_ENUM_SEARCH_FILE:
+    case PK_ROLE_ENUM_RESOLVE:
+    case PK_ROLE_ENUM_GET_DETAILS:
+    case PK_ROLE_ENUM_GET_FILES:
+    case PK_ROLE_ENUM_GET_PACKAGES:
+    case PK_ROLE_ENUM_GET_UPDATE_DETAIL:
+    case PK_ROLE_ENUM_DEPENDS_ON:
+    case PK_ROLE_ENUM_REQUIRED_BY:
+    case PK_ROLE_ENUM_WHAT_PROVIDES:
+        return true;
+    default:
+        return false;
+    }
+}
 
-    // set http proxy
-    http_proxy = pk_backend_job_get_proxy_http(m_job);
-    if (http_proxy != NULL) {
-        g_autofree gchar *uri = pk_backend_convert_uri(http_proxy);
-        g_setenv("http_proxy", uri, TRUE);
+static time_t listsMtime()
+{
+    struct stat buf;
+    string listsDir = _config->FindDir("Dir::State::lists");
+    if (stat(listsDir.c_str(), &buf) != 0) {
+        return 0;
     }
+    return buf.st_mtime;
+}
 
-    // set ftp proxy
-    ftp_proxy = pk_backend_job_get_proxy_ftp(m_job);
-    if (ftp_proxy != NULL) {
-        g_autofree gchar *uri = pk_backend_convert_uri(ftp_proxy);
-        g_setenv("ftp_proxy", uri, TRUE);
+void AptIntf::invalidateCache()
+{
+    AptCacheFile *cache;
+
+    g_mutex_lock(&s_cacheMutex);
+    s_cacheGeneration++;
+    cache = s_warmCache;
+    s_warmCache = nullptr;
+    g_mutex_unlock(&s_cacheMutex);
+
+    if (cache != nullptr) {
+        g_debug("dropping warm package cache");
+        delete cache;
+    }
+}
+
+bool AptIntf::takeWarmCache()
+{
+    AptCacheFile *cache = nullptr;
+
+    g_mutex_lock(&s_cacheMutex);
+    m_cacheGeneration = s_cacheGeneration;
+    if (s_warmCache != nullptr &&
+            s_warmCacheGeneration == s_cacheGeneration &&
+            s_warmCacheListsMtime == listsMtime()) {
+        cache = s_warmCache;
+        s_warmCache = nullptr;
+    }
+    g_mutex_unlock(&s_cacheMutex);
+
+    if (cache == nullptr) {
+        return false;
+    }
+
+    cache->setJob(m_job);
+    m_cache = cache;
+    return true;
+}
+
+void AptIntf::releaseCache()
+{
+    AptCacheFile *cache = m_cache;
+
+    m_cache = nullptr;
+    if (cache == nullptr) {
+        return;
+    }
+
+    // keep a clean cache of a query that completed for the next one
+    if (m_cacheReady && isCacheShareable() && !m_cancel &&
+            (*cache)->InstCount() == 0 && (*cache)->DelCount() == 0) {
+        time_t mtime = listsMtime();
+
+        cache->setJob(nullptr);
+        g_mutex_lock(&s_cacheMutex);
+        if (s_warmCache == nullptr && m_cacheGeneration == s_cacheGeneration) {
+            s_warmCache = cache;
+            s_warmCacheGeneration = m_cacheGeneration;
+            s_warmCacheListsMtime = mtime;
+            cache = nullptr;
+        }
+        g_mutex_unlock(&s_cacheMutex);
+    }
+
+    delete cache;
+}
+
+string AptIntf::jobEnvironment() const
+{
+    const gchar *locale = pk_backend_job_get_locale(m_job);
+    const gchar *httpProxy = pk_backend_job_get_proxy_http(m_job);
+    const gchar *ftpProxy = pk_backend_job_get_proxy_ftp(m_job);
+
+    return string(locale != NULL ? locale : "") + '\n' +
+            (httpProxy != NULL ? httpProxy : "") + '\n' +
+            (ftpProxy != NULL ? ftpProxy : "");
+}
+
+// must be called with s_cacheMutex held
+static bool cacheReaderMustWait(const string &environment)
+{
+    if (s_cacheWriter || s_cacheWritersWaiting > 0) {
+        return true;
+    }
+    if (s_cacheReaders == 0) {
+        return false;
+    }
+    if (s_cacheEnvironment != environment) {
+        return true;
+    }
+    for (const auto &it : s_cacheEnvironmentsWaiting) {
+        if (it.first != environment) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AptIntf::lockCache()
+{
+    if (m_cacheLocked) {
+        return;
     }
 
+    m_cacheWriter = isCacheWriter();
+    const string environment = jobEnvironment();
+
+    g_mutex_lock(&s_cacheMutex);
+    if (m_cacheWriter) {
+        s_cacheWritersWaiting++;
+        if (s_cacheWriter || s_cacheReaders > 0) {
+            pk_backend_job_set_status(m_job, PK_STATUS_ENUM_WAITING_FOR_LOCK);
+        }
+        while (s_cacheWriter || s_cacheReaders > 0) {
+            g_cond_wait(&s_cacheCond, &s_cacheMutex);
+        }
+        s_cacheWritersWaiting--;
+        s_cacheWriter = true;
+        s_cacheEnvironment = environment;
+        setEnvFromJob();
+    } else {
+        if (cacheReaderMustWait(environment)) {
+            pk_backend_job_set_status(m_job, PK_STATUS_ENUM_WAITING_FOR_LOCK);
+            s_cacheEnvironmentsWaiting[environment]++;
+            while (cacheReaderMustWait(environment)) {
+                g_cond_wait(&s_cacheCond, &s_cacheMutex);
+            }
+            if (--s_cacheEnvironmentsWaiting[environment] == 0) {
+                s_cacheEnvironmentsWaiting.erase(environment);
+            }
+        }
+        // the first reader sets the environment the others share
+        if (s_cacheReaders == 0) {
+            s_cacheEnvironment = environment;
+            setEnvFromJob();
+        }
+        s_cacheReaders++;
+    }
+    g_mutex_unlock(&s_cacheMutex);
+
+    // let the scheduler know this job cannot run in parallel, and do not
+    // let anybody reuse a cache that is about to become stale
+    if (m_cacheWriter) {
+        pk_backend_job_set_locked(m_job, true);
+        invalidateCache();
+    }
+    m_cacheLocked = true;
+}
+
+void AptIntf::unlockCache()
+{
+    if (!m_cacheLocked) {
+        return;
+    }
+
+    g_mutex_lock(&s_cacheMutex);
+    if (m_cacheWriter) {
+        s_cacheWriter = false;
+    } else {
+        s_cacheReaders--;
+    }
+    g_cond_broadcast(&s_cacheCond);
+    g_mutex_unlock(&s_cacheMutex);
+
+    if (m_cacheWriter) {
+        pk_backend_job_set_locked(m_job, false);
+    }
+    m_cacheLocked = false;
+}
+
+bool AptIntf::init(gchar **localDebs)
+{
+    // wait until we can share the cache, or own it if we change it, this
+    // also sets the locale and the proxies of the job
+    lockCache();
+
+    G_LOCK(aptcc_config);
+    m_isMultiArch = APT::Configuration::getArchitectures(false).size() > 1;
+    G_UNLOCK(aptcc_config);
+
     // Check if we should open the Cache with lock
     bool withLock;
     bool AllowBroken = false;
@@ -121,45 +377,49 @@ bool AptIntf::init(gchar **localDebs)
         withLock = !simulate;
     }
 
-    // Create the AptCacheFile class to search for packages
-    m_cache = new AptCacheFile(m_job);
-    if (localDebs) {
-        PkBitfield flags = pk_backend_job_get_transaction_flags(m_job);
-        if (pk_bitfield_contain(flags, PK_TRANSACTION_FLAG_ENUM_ONLY_TRUSTED)) {
-            // We are NOT simulating and have untrusted packages
-            // fail the transaction.
-            pk_backend_job_error_code(m_job,
-                                  PK_ERROR_ENUM_CANNOT_INSTALL_REPO_UNSIGNED,
-                                  "Local packages cannot be authenticated");
-            return false;
+    // Queries reuse the cache of a previous query when nothing changed,
+    // otherwise create the AptCacheFile class to search for packages
+    if (!isCacheShareable() || !takeWarmCache()) {
+        m_cache = new AptCacheFile(m_job);
+        if (localDebs) {
+            PkBitfield flags = pk_backend_job_get_transaction_flags(m_job);
+            if (pk_bitfield_contain(flags, PK_TRANSACTION_FLAG_ENUM_ONLY_TRUSTED)) {
+                // We are NOT simulating and have untrusted packages
+                // fail the transaction.
+                pk_backend_job_error_code(m_job,
+                                      PK_ERROR_ENUM_CANNOT_INSTALL_REPO_UNSIGNED,
+                                      "Local packages cannot be authenticated");
+                return false;
+            }
+
+            for (guint i = 0; i < g_strv_length(localDebs); ++i)
+                markFileForInstall(localDebs[i]);
         }
 
-        for (guint i = 0; i < g_strv_length(localDebs); ++i)
-            markFileForInstall(localDebs[i]);
-    }
+        int timeout = 10;
+        // TODO test this
+        while (m_cache->Open(withLock) == false) {
+            if (withLock == false || (timeout <= 0)) {
+                show_errors(m_job, PK_ERROR_ENUM_CANNOT_GET_LOCK);
+                return false;
+            } else {
+                _error->Discard();
+                pk_backend_job_set_status(m_job, PK_STATUS_ENUM_WAITING_FOR_LOCK);
+                sleep(1);
+                timeout--;
+            }
 
-    int timeout = 10;
-    // TODO test this
-    while (m_cache->Open(withLock) == false) {
-        if (withLock == false || (timeout <= 0)) {
-            show_errors(m_job, PK_ERROR_ENUM_CANNOT_GET_LOCK);
-            return false;
-        } else {
-            _error->Discard();
-            pk_backend_job_set_status(m_job, PK_STATUS_ENUM_WAITING_FOR_LOCK);
-            sleep(1);
-            timeout--;
+            // Close the cache if we are going to try again
+            m_cache->Close();
         }
-
-        // Close the cache if we are going to try again
-        m_cache->Close();
     }
 
     // default settings
+    G_LOCK(aptcc_config);
     _config->CndSet("APT::Get::AutomaticRemove::Kernels", _config->FindB("APT::Get::AutomaticRemove", true));
 
     m_interactive = pk_backend_job_get_interactive(m_job);
-    if (!m_interactive) {
+    if (!m_interactive && m_cacheWriter) {
         // Do not ask about config updates if we are not interactive
         _config->Set("Dpkg::Options::", "--force-confdef");
         _config->Set("Dpkg::Options::", "--force-confold");
@@ -167,14 +427,44 @@ bool AptIntf::init(gchar **localDebs)
         g_setenv("APT_LISTCHANGES_FRONTEND", "none", TRUE);
         g_setenv("APT_LISTBUGS_FRONTEND", "none", TRUE);
     }
+    G_UNLOCK(aptcc_config);
 
     // Check if there are half-installed packages and if we can fix them
-    return m_cache->CheckDeps(AllowBroken);
+    m_cacheReady = m_cache->CheckDeps(AllowBroken);
+    return m_cacheReady;
 }
 
 AptIntf::~AptIntf()
 {
-    delete m_cache;
+    releaseCache();
+    unlockCache();
+}
+
+void AptIntf::setEnvFromJob()
+{
+    const gchar *http_proxy;
+    const gchar *ftp_proxy;
+
+    // set locale
+    setEnvLocaleFromJob();
+
+    // set http proxy, or drop the one of a previous job
+    http_proxy = pk_backend_job_get_proxy_http(m_job);
+    if (http_proxy != NULL) {
+        g_autofree gchar *uri = pk_backend_convert_uri(http_proxy);
+        g_setenv("http_proxy", uri, TRUE);
+    } else {
+        g_unsetenv("http_proxy");
+    }
+
+    // set ftp proxy
+    ftp_proxy = pk_backend_job_get_proxy_ftp(m_job);
+    if (ftp_proxy != NULL) {
+        g_autofree gchar *uri = pk_backend_convert_uri(ftp_proxy);
+        g_setenv("ftp_proxy", uri, TRUE);
+    } else {
+        g_unsetenv("ftp_proxy");
+    }
 }
 
 void AptIntf::setEnvLocaleFromJob()
@@ -229,79 +519,51 @@ bool AptIntf::matchPackage(const pkgCache::VerIterator &ver, PkBitfield filters)
             }
         }
 
-        std::string str = ver.Section() == NULL ? "" : ver.Section();
-        std::string section, component;
-
-        size_t found;
-        found = str.find_last_of("/");
-        section = str.substr(found + 1);
-        if(found == str.npos) {
-            component = "main";
-        } else {
-            component = str.substr(0, found);
-        }
-
         if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_INSTALLED) && installed) {
             return false;
         } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_INSTALLED) && !installed) {
             return false;
         }
 
+        const guint8 attrs = m_cache->versionAttributes(ver);
+
         if (pk_bitfield_contain(filters, PK_FILTER_ENUM_DEVELOPMENT)) {
-            // if ver.end() means unknow
-            // strcmp will be true when it's different than devel
-            std::string pkgName = pkg.Name();
-            if (!ends_with(pkgName, "-dev") &&
-                    !ends_with(pkgName, "-dbg") &&
-                    section.compare("devel") &&
-                    section.compare("libdevel")) {
+            if (!(attrs & VERSION_ATTR_DEVELOPMENT)) {
                 return false;
             }
         } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_DEVELOPMENT)) {
-            std::string pkgName = pkg.Name();
-            if (ends_with(pkgName, "-dev") ||
-                    ends_with(pkgName, "-dbg") ||
-                    !section.compare("devel") ||
-                    !section.compare("libdevel")) {
+            if (attrs & VERSION_ATTR_DEVELOPMENT) {
                 return false;
             }
         }
 
         if (pk_bitfield_contain(filters, PK_FILTER_ENUM_GUI)) {
-            // if ver.end() means unknow
-            // strcmp will be true when it's different than x11
-            if (section.compare("x11") && section.compare("gnome") &&
-                    section.compare("kde") && section.compare("graphics")) {
+            if (!(attrs & VERSION_ATTR_GUI)) {
                 return false;
             }
         } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_GUI)) {
-            if (!section.compare("x11") || !section.compare("gnome") ||
-                    !section.compare("kde") || !section.compare("graphics")) {
+            if (attrs & VERSION_ATTR_GUI) {
                 return false;
             }
         }
 
         if (pk_bitfield_contain(filters, PK_FILTER_ENUM_FREE)) {
-            if (component.compare("main") != 0 &&
-                    component.compare("universe") != 0) {
-                // Must be in main and universe to be free
+            if (!(attrs & VERSION_ATTR_FREE)) {
                 return false;
             }
         } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_FREE)) {
-            if (component.compare("main") == 0 ||
-                    component.compare("universe") == 0) {
-                // Must not be in main or universe to be free
+            if (attrs & VERSION_ATTR_FREE) {
                 return false;
             }
         }
 
         // Check for supported packages
         if (pk_bitfield_contain(filters, PK_FILTER_ENUM_SUPPORTED)) {
-            if (!packageIsSupported(ver, component)) {
+            if (!(attrs & VERSION_ATTR_SUPPORTED)) {
                 return false;
             }
         } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_SUPPORTED)) {
-            if (packageIsSupported(ver, component)) {
+            if (attrs & VERSION_ATTR_SUPPORTED) {
                 return false;
             }
         }
@@ -1108,8 +1370,8 @@ PkgList AptIntf::getPackagesFromGroup(gchar **values)
     return output;
 }
 
-bool AptIntf::matchesQueries(const vector<string> &queries, string s) {
-    for (string query : queries) {
+bool AptIntf::matchesQueries(const vector<string> &queries, const string &s) {
+    for (const string &query : queries) {
         // Case insensitive "string.contains"
         auto it = std::search(
             s.begin(), s.end(),
@@ -1126,11 +1388,28 @@ bool AptIntf::matchesQueries(const vector<string> &queries, string s) {
     return false;
 }
 
+vector<pkgCache::PkgIterator> AptIntf::searchCandidates(const vector<string> &queries, bool details)
+{
+    vector<pkgCache::PkgIterator> packages;
+    AptSearchIndex index;
+
+    // narrow the packages to look at when the index is current
+    if (index.open(m_cache) && index.lookup(queries, details, packages)) {
+        return packages;
+    }
+
+    packages.reserve(m_cache->GetPkgCache()->HeaderP->PackageCount);
+    for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
+        packages.push_back(pkg);
+    }
+    return packages;
+}
+
 PkgList AptIntf::searchPackageName(const vector<string> &queries)
 {
     PkgList output;
 
-    for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
+    for (const pkgCache::PkgIterator &pkg : searchCandidates(queries, false)) {
         if (m_cancel) {
             break;
         }
@@ -1166,7 +1445,7 @@ PkgList AptIntf::searchPackageDetails(const vector<string> &queries)
 {
     PkgList output;
 
-    for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
+    for (const pkgCache::PkgIterator &pkg : searchCandidates(queries, true)) {
         if (m_cancel) {
             break;
         }
@@ -1210,64 +1489,68 @@ PkgList AptIntf::searchPackageFiles(gchar **values)
     string search;
     regex_t re;
 
-    for (uint i = 0; i < g_strv_length(values); ++i) {
-        gchar *value = values[i];
-        if (strlen(value) < 1) {
-            continue;
-        }
+    // the file lists of the installed packages are indexed, only
+    // regular expressions still need to scan them
+    if (!AptFileIndex::search(values, packages)) {
+        for (uint i = 0; i < g_strv_length(values); ++i) {
+            gchar *value = values[i];
+            if (strlen(value) < 1) {
+                continue;
+            }
 
-        if (!search.empty()) {
-            search.append("|");
-        }
+            if (!search.empty()) {
+                search.append("|");
+            }
 
-        if (value[0] == '/') {
-            search.append("^");
-            search.append(value);
-            search.append("$");
-        } else {
-            search.append(value);
-            search.append("$");
+            if (value[0] == '/') {
+                search.append("^");
+                search.append(value);
+                search.append("$");
+            } else {
+                search.append(value);
+                search.append("$");
+            }
         }
-    }
 
-    if(regcomp(&re, search.c_str(), REG_NOSUB) != 0) {
-        g_debug("Regex compilation error");
-        return output;
-    }
-
-    DIR *dp;
-    struct dirent *dirp;
-    if (!(dp = opendir("/var/lib/dpkg/info/"))) {
-        g_debug ("Error opening /var/lib/dpkg/info/\n");
-        regfree(&re);
-        return output;
-    }
+        if(regcomp(&re, search.c_str(), REG_NOSUB) != 0) {
+            g_debug("Regex compilation error");
+            return output;
+        }
 
-    string line;
-    while ((dirp = readdir(dp)) != NULL) {
-        if (m_cancel) {
-            break;
+        DIR *dp;
+        struct dirent *dirp;
+        if (!(dp = opendir("/var/lib/dpkg/info/"))) {
+            g_debug ("Error opening /var/lib/dpkg/info/\n");
+            regfree(&re);
+            return output;
         }
 
-        if (ends_with(dirp->d_name, ".list")) {
-            string file(dirp->d_name);
-            string f = "/var/lib/dpkg/info/" + file;
-            ifstream in(f.c_str());
-            if (!in != 0) {
-                continue;
+        string line;
+        while ((dirp = readdir(dp)) != NULL) {
+            if (m_cancel) {
+                break;
             }
 
-            while (!in.eof()) {
-                getline(in, line);
-                if (regexec(&re, line.c_str(), (size_t)0, NULL, 0) == 0) {
-                    packages.push_back(file.erase(file.size() - 5, file.size()));
-                    break;
+            if (ends_with(dirp->d_name, ".list")) {
+                string file(dirp->d_name);
+                string f = "/var/lib/dpkg/info/" + file;
+                ifstream in(f.c_str());
+                if (!in != 0) {
+                    continue;
+                }
+
+                while (!in.eof()) {
+                    getline(in, line);
+                    if (regexec(&re, line.c_str(), (size_t)0, NULL, 0) == 0) {
+                        packages.push_back(file.erase(file.size() - 5, file.size()));
+                        break;
+                    }
                 }
             }
         }
+        closedir(dp);
+        regfree(&re);
     }
-    closedir(dp);
-    regfree(&re);
 
     // Resolve the package names now
     for (const string &name : packages) {
@@ -1439,38 +1722,12 @@ void AptIntf::providesMimeType(PkgList &output, gchar **values)
 
 bool AptIntf::isApplication(const pkgCache::VerIterator &ver)
 {
-    bool ret = false;
-    gchar *fileName;
-    string line;
-
-    fileName = g_strdup_printf("/var/lib/dpkg/info/%s:%s.list",
-                               ver.ParentPkg().Name(),
-                               ver.Arch());
-    if (!FileExists(fileName)) {
-        g_free(fileName);
-        // if the file was not found try without the arch field
-        fileName = g_strdup_printf("/var/lib/dpkg/info/%s.list",
-                                   ver.ParentPkg().Name());
-    }
-
-    if (FileExists(fileName)) {
-        ifstream in(fileName);
-        if (!in != 0) {
-            g_free(fileName);
-            return false;
-        }
-
-        while (in.eof() == false) {
-            getline(in, line);
-            if (ends_with(line, ".desktop")) {
-                ret = true;
-                break;
-            }
-        }
+    // bring the index up to date once per job, after that this is a lookup
+    if (!m_fileIndexUpdated) {
+        AptFileIndex::update();
+        m_fileIndexUpdated = true;
     }
-
-    g_free(fileName);
-    return ret;
+    return AptFileIndex::isApplication(ver.ParentPkg().Name(), ver.Arch());
 }
 
 // used to emit files it reads the info directly from the files
@@ -1541,41 +1798,6 @@ void AptIntf::emitPackageFilesLocal(const gchar *file)
     g_ptr_array_unref(files);
 }
 
-/**
-  * Check if package is officially supported by the current distribution
-  */
-bool AptIntf::packageIsSupported(const pkgCache::VerIterator &verIter, string component)
-{
-    string origin;
-    if (!verIter.end()) {
-        pkgCache::VerFileIterator vf = verIter.FileList();
-        origin = vf.File().Origin() == NULL ? "" : vf.File().Origin();
-    }
-
-    if (component.empty()) {
-        component = "main";
-    }
-
-    // Get a fetcher
-    AcqPackageKitStatus Stat(this, m_job);
-    pkgAcquire fetcher;
-    fetcher.SetLog(&Stat);
-
-    PkBitfield flags = pk_backend_job_get_transaction_flags(m_job);
-    bool trusted = checkTrusted(fetcher, flags);
-
-    if ((origin.compare("Debian") == 0) || (origin.compare("Ubuntu") == 0))  {
-        if ((component.compare("main") == 0 ||
-             component.compare("restricted") == 0 ||
-             component.compare("unstable") == 0 ||
-             component.compare("testing") == 0) && trusted) {
-            return true;
-        }
-    }
-
-    return false;
-}
-
 bool AptIntf::checkTrusted(pkgAcquire &fetcher, PkBitfield flags)
 {
     string UntrustedList;
@@ -2168,6 +2390,14 @@ void AptIntf::refreshCache()
     if (m_cache->BuildCaches() == false) {
         return;
     }
+
+    // The caches of this job were built before the lists changed, open
+    // the new ones to index them for searching
+    m_cache->Close();
+    if (m_cache->Open() == false) {
+        return;
+    }
+    AptSearchIndex::build(m_cache);
 }
 
 void AptIntf::markAutoInstalled(const PkgList &pkgs)
@@ -2299,6 +2529,11 @@ bool AptIntf::runTransaction(const PkgList &install, const PkgList &remove, cons
     // will just calculate the trusted packages
     const auto ret = installPackages(flags);
 
+    // index the file lists of the packages that changed
+    if (ret && !pk_bitfield_contain(flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE)) {
+        AptFileIndex::update();
+    }
+
     if (g_file_test(REBOOT_REQUIRED, G_FILE_TEST_EXISTS)) {
         struct stat restartStat;
         g_stat(REBOOT_REQUIRED, &restartStat);
@@ -2488,9 +2723,14 @@ bool AptIntf::installPackages(PkBitfield flags)
         return false;
     }
 
+    // dpkg writes its status file while it runs, the watch on it must not
+    // take our own changes for an external tool discarding offline updates
+    pk_backend_transaction_inhibit_start(backend);
+
     int pty_master;
     m_child_pid = forkpty(&pty_master, NULL, NULL, NULL);
     if (m_child_pid == -1) {
+        pk_backend_transaction_inhibit_end(backend);
         return false;
     }
 
@@ -2567,6 +2807,7 @@ bool AptIntf::installPackages(PkBitfield flags)
     close(readFromChildFD[1]);
     close(pty_master);
     _system->LockInner();
+    pk_backend_transaction_inhibit_end(backend);
 
     cout << "Parent finished..." << endl;
     return true;
@@ -50,6 +50,23 @@ public:
     void cancel();
     bool cancelled() const;
 
+    /**
+     * Takes the backend wide cache lock for this job, shared for
+     * read-only roles and exclusive for roles that change the system
+     * or the package lists. This is called by init() and is released
+     * when the object is destroyed, calling it again is a no-op.
+     * The locale and proxies of the job are set in the environment
+     * while nobody else holds the lock, readers only share it with
+     * readers of the same environment.
+     */
+    void lockCache();
+
+    /**
+     * Drops the package cache kept warm between queries, this must be
+     * called when the dpkg status or the package lists change
+     */
+    static void invalidateCache();
+
     /**
      * Tries to find a package with the given packageId
      * @returns pkgCache::VerIterator, if .end() is true the package could not be found
@@ -242,11 +259,18 @@ public:
     AptCacheFile* aptCacheFile() const;
 
 private:
+    bool isCacheWriter() const;
+    bool isCacheShareable() const;
+    void unlockCache();
+    bool takeWarmCache();
+    void releaseCache();
+    string jobEnvironment() const;
+    void setEnvFromJob();
     void setEnvLocaleFromJob();
     bool checkTrusted(pkgAcquire &fetcher, PkBitfield flags);
-    bool packageIsSupported(const pkgCache::VerIterator &verIter, string component);
     bool isApplication(const pkgCache::VerIterator &verIter);
-    bool matchesQueries(const vector<string> &queries, string s);
+    bool matchesQueries(const vector<string> &queries, const string &s);
+    vector<pkgCache::PkgIterator> searchCandidates(const vector<string> &queries, bool details);
 
     /**
      *  interprets dpkg status fd
@@ -258,6 +282,11 @@ private:
     AptCacheFile *m_cache;
     PkBackendJob  *m_job;
     bool       m_cancel;
+    bool       m_cacheLocked;
+    bool       m_cacheWriter;
+    bool       m_cacheReady;
+    guint      m_cacheGeneration;
+    bool       m_fileIndexUpdated;
     struct stat m_restartStat;
 
     bool m_isMultiArch;
@@ -0,0 +1,313 @@
+/* apt-search-index-data.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "apt-search-index-data.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#define APT_SEARCH_INDEX_MAGIC      "PKAPTIDX"
+#define APT_SEARCH_INDEX_VERSION    1
+
+// On disk the index is this header, followed by one entry per trigram
+// sorted by trigram, followed by the posting lists. A posting list holds
+// the sorted offsets of the packages in the package map, encoded as
+// deltas in 7 bit variable length integers.
+struct AptSearchIndexHeader {
+    char magic[8];
+    guint32 version;
+    guint32 packageCount;
+    guint64 cacheMtime;
+    guint64 cacheSize;
+    guint32 trigramCount;
+    guint32 padding;
+};
+
+struct AptSearchIndexEntry {
+    guint32 trigram;
+    guint32 nameOffset;
+    guint32 nameLength;
+    guint32 detailsOffset;
+    guint32 detailsLength;
+};
+
+static void uniqueSort(vector<guint32> &v)
+{
+    std::sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+}
+
+static void putPostings(string &blob, vector<guint32> offsets)
+{
+    guint32 last = 0;
+
+    uniqueSort(offsets);
+    for (guint32 offset : offsets) {
+        guint32 delta = offset - last;
+        while (delta >= 0x80) {
+            blob.push_back(static_cast<char>(delta | 0x80));
+            delta >>= 7;
+        }
+        blob.push_back(static_cast<char>(delta));
+        last = offset;
+    }
+}
+
+static const AptSearchIndexHeader *header(GBytes *bytes)
+{
+    return static_cast<const AptSearchIndexHeader *>(g_bytes_get_data(bytes, nullptr));
+}
+
+AptSearchIndexData::AptSearchIndexData() :
+    m_bytes(nullptr),
+    m_damaged(false)
+{
+}
+
+AptSearchIndexData::~AptSearchIndexData()
+{
+    if (m_bytes != nullptr) {
+        g_bytes_unref(m_bytes);
+    }
+}
+
+void AptSearchIndexData::addTrigrams(const char *s, size_t len, vector<guint32> &trigrams)
+{
+    for (size_t i = 0; i + 3 <= len; ++i) {
+        const guchar a = s[i];
+        const guchar b = s[i + 1];
+        const guchar c = s[i + 2];
+        if (a >= 0x80 || b >= 0x80 || c >= 0x80) {
+            continue;
+        }
+        trigrams.push_back(static_cast<guint32>(g_ascii_tolower(a)) << 16 |
+                           static_cast<guint32>(g_ascii_tolower(b)) << 8 |
+                           static_cast<guint32>(g_ascii_tolower(c)));
+    }
+}
+
+string AptSearchIndexData::encode(const Postings &names,
+                                  const Postings &details,
+                                  guint32 packageCount,
+                                  guint64 cacheMtime,
+                                  guint64 cacheSize)
+{
+    AptSearchIndexHeader header;
+    vector<guint32> trigrams;
+
+    trigrams.reserve(details.size());
+    for (const auto &it : details) {
+        trigrams.push_back(it.first);
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, APT_SEARCH_INDEX_MAGIC, sizeof(header.magic));
+    header.version = APT_SEARCH_INDEX_VERSION;
+    header.packageCount = packageCount;
+    header.cacheMtime = cacheMtime;
+    header.cacheSize = cacheSize;
+    header.trigramCount = trigrams.size();
+
+    vector<AptSearchIndexEntry> entries(trigrams.size());
+    string blob;
+    for (guint i = 0; i < trigrams.size(); ++i) {
+        AptSearchIndexEntry &entry = entries[i];
+        entry.trigram = trigrams[i];
+
+        entry.nameOffset = blob.size();
+        auto it = names.find(trigrams[i]);
+        if (it != names.end()) {
+            putPostings(blob, it->second);
+        }
+        entry.nameLength = blob.size() - entry.nameOffset;
+
+        entry.detailsOffset = blob.size();
+        putPostings(blob, details.at(trigrams[i]));
+        entry.detailsLength = blob.size() - entry.detailsOffset;
+    }
+
+    string data;
+    data.reserve(sizeof(header) + entries.size() * sizeof(AptSearchIndexEntry) + blob.size());
+    data.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    data.append(reinterpret_cast<const char *>(entries.data()),
+                entries.size() * sizeof(AptSearchIndexEntry));
+    data.append(blob);
+    return data;
+}
+
+bool AptSearchIndexData::load(GBytes *bytes)
+{
+    gsize len;
+    const auto *hdr = static_cast<const AptSearchIndexHeader *>(g_bytes_get_data(bytes, &len));
+
+    if (len < sizeof(AptSearchIndexHeader) ||
+            memcmp(hdr->magic, APT_SEARCH_INDEX_MAGIC, sizeof(hdr->magic)) != 0 ||
+            hdr->version != APT_SEARCH_INDEX_VERSION ||
+            (len - sizeof(AptSearchIndexHeader)) / sizeof(AptSearchIndexEntry) < hdr->trigramCount) {
+        return false;
+    }
+    if (m_bytes != nullptr) {
+        g_bytes_unref(m_bytes);
+    }
+    m_bytes = g_bytes_ref(bytes);
+    m_damaged = false;
+    return true;
+}
+
+guint32 AptSearchIndexData::packageCount() const
+{
+    return header(m_bytes)->packageCount;
+}
+
+guint64 AptSearchIndexData::cacheMtime() const
+{
+    return header(m_bytes)->cacheMtime;
+}
+
+guint64 AptSearchIndexData::cacheSize() const
+{
+    return header(m_bytes)->cacheSize;
+}
+
+const AptSearchIndexEntry *AptSearchIndexData::find(guint32 trigram) const
+{
+    const auto *data = static_cast<const gchar *>(g_bytes_get_data(m_bytes, nullptr));
+    const auto *begin = reinterpret_cast<const AptSearchIndexEntry *>(data + sizeof(AptSearchIndexHeader));
+    const auto *end = begin + header(m_bytes)->trigramCount;
+
+    const auto *entry = std::lower_bound(begin, end, trigram,
+                                         [](const AptSearchIndexEntry &e, guint32 t) {
+                                             return e.trigram < t;
+                                         });
+    if (entry == end || entry->trigram != trigram) {
+        return nullptr;
+    }
+    return entry;
+}
+
+bool AptSearchIndexData::decode(const AptSearchIndexEntry *entry, bool details, vector<guint32> &offsets)
+{
+    gsize len;
+    const auto *data = static_cast<const guchar *>(g_bytes_get_data(m_bytes, &len));
+    const guint32 packages = header(m_bytes)->packageCount;
+    const gsize blob = sizeof(AptSearchIndexHeader) +
+                       header(m_bytes)->trigramCount * sizeof(AptSearchIndexEntry);
+    const guint32 start = details ? entry->detailsOffset : entry->nameOffset;
+    const guint32 length = details ? entry->detailsLength : entry->nameLength;
+    guint64 last = 0;
+
+    offsets.clear();
+    if (start > len - blob || length > len - blob - start) {
+        return false;
+    }
+
+    gsize pos = blob + start;
+    const gsize stop = pos + length;
+    while (pos < stop) {
+        guint32 delta = 0;
+        guint shift = 0;
+        guchar byte;
+        do {
+            // a varint running off the list or wider than 32 bits
+            if (pos == stop || shift >= 32) {
+                return false;
+            }
+            byte = data[pos++];
+            delta |= static_cast<guint32>(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        last += delta;
+        if (last >= packages) {
+            return false;
+        }
+        offsets.push_back(last);
+    }
+    return true;
+}
+
+bool AptSearchIndexData::lookupQuery(const string &query, bool details, vector<guint32> &offsets)
+{
+    vector<guint32> trigrams;
+    vector<const AptSearchIndexEntry *> entries;
+    vector<guint32> other;
+    vector<guint32> both;
+
+    addTrigrams(query.data(), query.size(), trigrams);
+    uniqueSort(trigrams);
+    if (trigrams.empty()) {
+        return false;
+    }
+
+    offsets.clear();
+    for (guint32 trigram : trigrams) {
+        const AptSearchIndexEntry *entry = find(trigram);
+        if (entry == nullptr) {
+            // nothing has this trigram so nothing can match
+            return true;
+        }
+        entries.push_back(entry);
+    }
+
+    // intersect starting with the shortest list
+    std::sort(entries.begin(), entries.end(),
+              [details](const AptSearchIndexEntry *a, const AptSearchIndexEntry *b) {
+                  return details ? a->detailsLength < b->detailsLength :
+                                   a->nameLength < b->nameLength;
+              });
+    if (!decode(entries[0], details, offsets)) {
+        m_damaged = true;
+        return false;
+    }
+    for (guint i = 1; i < entries.size() && !offsets.empty(); ++i) {
+        if (!decode(entries[i], details, other)) {
+            m_damaged = true;
+            return false;
+        }
+        both.clear();
+        std::set_intersection(offsets.begin(), offsets.end(),
+                              other.begin(), other.end(),
+                              std::back_inserter(both));
+        offsets.swap(both);
+    }
+    return true;
+}
+
+bool AptSearchIndexData::lookup(const vector<string> &queries, bool details, vector<guint32> &offsets)
+{
+    vector<guint32> matches;
+
+    if (m_bytes == nullptr || m_damaged || queries.empty()) {
+        return false;
+    }
+
+    offsets.clear();
+    for (const string &query : queries) {
+        if (!lookupQuery(query, details, matches)) {
+            if (m_damaged) {
+                g_warning("search index is damaged, searching all packages");
+            }
+            return false;
+        }
+        offsets.insert(offsets.end(), matches.begin(), matches.end());
+    }
+    uniqueSort(offsets);
+    return true;
+}
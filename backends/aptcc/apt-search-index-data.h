@@ -0,0 +1,97 @@
+/* apt-search-index-data.h
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef APT_SEARCH_INDEX_DATA_H
+#define APT_SEARCH_INDEX_DATA_H
+
+#include <glib.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+struct AptSearchIndexEntry;
+
+/**
+ * The on-disk format of the search index
+ *
+ * This knows nothing about APT, the packages are only the offsets into
+ * the package map of the cache the index was built from. The file may be
+ * stale, truncated or damaged, so nothing read from it is trusted: any
+ * offset that points outside the data or past the last package makes the
+ * lookup fail and the caller fall back to a full scan.
+ */
+class AptSearchIndexData
+{
+public:
+    // trigram -> the offsets of the packages that have it
+    typedef std::unordered_map<guint32, vector<guint32> > Postings;
+
+    AptSearchIndexData();
+    ~AptSearchIndexData();
+    AptSearchIndexData(const AptSearchIndexData &) = delete;
+    AptSearchIndexData &operator=(const AptSearchIndexData &) = delete;
+
+    /**
+     * Appends the trigrams of @s, only ASCII is folded and trigrams with
+     * other bytes are skipped
+     */
+    static void addTrigrams(const char *s, size_t len, vector<guint32> &trigrams);
+
+    /**
+     * Serializes the postings, every name trigram must also be a details
+     * trigram
+     */
+    static string encode(const Postings &names,
+                         const Postings &details,
+                         guint32 packageCount,
+                         guint64 cacheMtime,
+                         guint64 cacheSize);
+
+    /**
+     * Takes a reference on @bytes, returns false if it is not an index
+     * of this version
+     */
+    bool load(GBytes *bytes);
+
+    guint32 packageCount() const;
+    guint64 cacheMtime() const;
+    guint64 cacheSize() const;
+
+    /**
+     * Fills @offsets with the sorted offsets of the packages that may
+     * match any of the queries
+     * @returns false if the index cannot narrow the search, either as a
+     * query is shorter than a trigram or as the index is damaged
+     */
+    bool lookup(const vector<string> &queries, bool details, vector<guint32> &offsets);
+
+private:
+    bool lookupQuery(const string &query, bool details, vector<guint32> &offsets);
+    bool decode(const AptSearchIndexEntry *entry, bool details, vector<guint32> &offsets);
+    const AptSearchIndexEntry *find(guint32 trigram) const;
+
+    GBytes *m_bytes;
+    bool m_damaged;
+};
+
+#endif // APT_SEARCH_INDEX_DATA_H
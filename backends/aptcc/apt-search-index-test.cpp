@@ -0,0 +1,184 @@
+/* apt-search-index-test.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include <glib.h>
+
+#include <cstring>
+
+#include "apt-search-index-data.h"
+
+// the offset of each package is its position here
+static const char *testPackages[][2] = {
+    { "powertop", "Tool to diagnose power consumption" },
+    { "power-profiles-daemon", "Makes power profiles handling available" },
+    { "gnome-shell", "Next generation GNOME shell" },
+    { "zsh", "Shell with lots of features" },
+};
+
+static string aptSearchIndexTestEncode()
+{
+    AptSearchIndexData::Postings names;
+    AptSearchIndexData::Postings details;
+
+    for (guint32 i = 0; i < G_N_ELEMENTS(testPackages); ++i) {
+        vector<guint32> nameTrigrams;
+        vector<guint32> detailTrigrams;
+        const char *name = testPackages[i][0];
+        const char *summary = testPackages[i][1];
+
+        AptSearchIndexData::addTrigrams(name, strlen(name), nameTrigrams);
+        for (guint32 trigram : nameTrigrams) {
+            names[trigram].push_back(i);
+            details[trigram].push_back(i);
+        }
+        AptSearchIndexData::addTrigrams(summary, strlen(summary), detailTrigrams);
+        for (guint32 trigram : detailTrigrams) {
+            details[trigram].push_back(i);
+        }
+    }
+    return AptSearchIndexData::encode(names, details, G_N_ELEMENTS(testPackages), 1, 2);
+}
+
+static GBytes *aptSearchIndexTestBytes(const string &data)
+{
+    return g_bytes_new(data.data(), data.size());
+}
+
+static void apt_search_index_trigram_func(void)
+{
+    AptSearchIndexData index;
+    vector<guint32> offsets;
+    g_autoptr(GBytes) bytes = aptSearchIndexTestBytes(aptSearchIndexTestEncode());
+
+    g_assert_true(index.load(bytes));
+    g_assert_cmpuint(index.packageCount(), ==, G_N_ELEMENTS(testPackages));
+    g_assert_cmpuint(index.cacheMtime(), ==, 1);
+    g_assert_cmpuint(index.cacheSize(), ==, 2);
+
+    // every trigram of the query has to be there
+    g_assert_true(index.lookup({ "power" }, false, offsets));
+    g_assert_cmpuint(offsets.size(), ==, 2);
+    g_assert_cmpuint(offsets[0], ==, 0);
+    g_assert_cmpuint(offsets[1], ==, 1);
+
+    // case is folded, and details include the names
+    g_assert_true(index.lookup({ "SHELL" }, false, offsets));
+    g_assert_cmpuint(offsets.size(), ==, 1);
+    g_assert_cmpuint(offsets[0], ==, 2);
+    g_assert_true(index.lookup({ "SHELL" }, true, offsets));
+    g_assert_cmpuint(offsets.size(), ==, 2);
+    g_assert_cmpuint(offsets[0], ==, 2);
+    g_assert_cmpuint(offsets[1], ==, 3);
+
+    // queries are or'ed
+    g_assert_true(index.lookup({ "zsh", "gnome" }, false, offsets));
+    g_assert_cmpuint(offsets.size(), ==, 2);
+
+    // a trigram nobody has narrows the search to nothing
+    g_assert_true(index.lookup({ "xyzzy" }, true, offsets));
+    g_assert_cmpuint(offsets.size(), ==, 0);
+
+    // shorter than a trigram, so the index cannot help
+    g_assert_false(index.lookup({ "zs" }, false, offsets));
+}
+
+// the layout of the file, see AptSearchIndexHeader and AptSearchIndexEntry
+#define APT_SEARCH_INDEX_TEST_HEADER_SIZE           40
+#define APT_SEARCH_INDEX_TEST_TRIGRAM_COUNT         32
+#define APT_SEARCH_INDEX_TEST_ENTRY_SIZE            20
+#define APT_SEARCH_INDEX_TEST_ENTRY_NAME_OFFSET     4
+#define APT_SEARCH_INDEX_TEST_ENTRY_DETAILS_OFFSET  12
+
+static gsize aptSearchIndexTestBlob(const string &data)
+{
+    guint32 trigramCount;
+
+    memcpy(&trigramCount, data.data() + APT_SEARCH_INDEX_TEST_TRIGRAM_COUNT, sizeof(trigramCount));
+    return APT_SEARCH_INDEX_TEST_HEADER_SIZE + trigramCount * APT_SEARCH_INDEX_TEST_ENTRY_SIZE;
+}
+
+// a damaged index loads, but the first lookup finds the damage and every
+// lookup from then on leaves the caller to scan all the packages
+static void aptSearchIndexTestDamaged(const string &data)
+{
+    AptSearchIndexData index;
+    vector<guint32> offsets;
+    g_autoptr(GBytes) bytes = aptSearchIndexTestBytes(data);
+
+    g_assert_true(index.load(bytes));
+    g_test_expect_message(G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*damaged*");
+    g_assert_false(index.lookup({ "power" }, true, offsets));
+    g_test_assert_expected_messages();
+    g_assert_false(index.lookup({ "shell" }, false, offsets));
+}
+
+static void apt_search_index_damaged_func(void)
+{
+    const string data = aptSearchIndexTestEncode();
+    const gsize blob = aptSearchIndexTestBlob(data);
+    const guint32 huge = G_MAXUINT32 - 1;
+    string bad;
+
+    // truncated in the trigram table, or not an index at all
+    {
+        AptSearchIndexData index;
+        g_autoptr(GBytes) bytes = aptSearchIndexTestBytes(data.substr(0, blob - 1));
+        g_assert_false(index.load(bytes));
+    }
+    {
+        AptSearchIndexData index;
+        g_autoptr(GBytes) bytes = g_bytes_new_static("PKAPTID", 7);
+        g_assert_false(index.load(bytes));
+    }
+
+    // posting lists that start outside the file
+    bad = data;
+    for (gsize i = APT_SEARCH_INDEX_TEST_HEADER_SIZE; i < blob; i += APT_SEARCH_INDEX_TEST_ENTRY_SIZE) {
+        memcpy(&bad[i + APT_SEARCH_INDEX_TEST_ENTRY_NAME_OFFSET], &huge, sizeof(huge));
+        memcpy(&bad[i + APT_SEARCH_INDEX_TEST_ENTRY_DETAILS_OFFSET], &huge, sizeof(huge));
+    }
+    aptSearchIndexTestDamaged(bad);
+
+    // posting lists that end outside the file
+    aptSearchIndexTestDamaged(data.substr(0, blob + 1));
+
+    // offsets past the last package
+    bad = data;
+    for (gsize i = blob; i < bad.size(); ++i) {
+        bad[i] = G_N_ELEMENTS(testPackages);
+    }
+    aptSearchIndexTestDamaged(bad);
+
+    // a variable length integer that never ends
+    bad = data;
+    for (gsize i = blob; i < bad.size(); ++i) {
+        bad[i] = static_cast<char>(0xff);
+    }
+    aptSearchIndexTestDamaged(bad);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/aptcc/search-index/trigram", apt_search_index_trigram_func);
+    g_test_add_func("/aptcc/search-index/damaged", apt_search_index_damaged_func);
+
+    return g_test_run();
+}
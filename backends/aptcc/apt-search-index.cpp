@@ -0,0 +1,191 @@
+/* apt-search-index.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "apt-search-index.h"
+
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/pkgrecords.h>
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstring>
+
+#include "apt-cache-file.h"
+
+static void uniqueSort(vector<guint32> &v)
+{
+    std::sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+}
+
+static bool cacheStamp(guint64 &mtime, guint64 &size)
+{
+    struct stat buf;
+    string cacheFile = _config->FindFile("Dir::Cache::pkgcache");
+    if (cacheFile.empty() || stat(cacheFile.c_str(), &buf) != 0) {
+        return false;
+    }
+    mtime = buf.st_mtime;
+    size = buf.st_size;
+    return true;
+}
+
+AptSearchIndex::AptSearchIndex() :
+    m_cache(nullptr),
+    m_open(false)
+{
+}
+
+AptSearchIndex::~AptSearchIndex()
+{
+}
+
+string AptSearchIndex::path()
+{
+    return _config->FindDir("Dir::Cache") + "pkgkit-search.bin";
+}
+
+bool AptSearchIndex::build(AptCacheFile *cache)
+{
+    guint64 mtime;
+    guint64 size;
+    AptSearchIndexData::Postings names;
+    AptSearchIndexData::Postings details;
+    vector<guint32> nameTrigrams;
+    vector<guint32> detailTrigrams;
+    g_autoptr(GError) error = NULL;
+
+    pkgCache *pkgcache = cache->GetPkgCache();
+    pkgRecords *records = cache->GetPkgRecords();
+    if (pkgcache == nullptr || records == nullptr) {
+        return false;
+    }
+
+    if (!cacheStamp(mtime, size)) {
+        g_debug("no binary package cache on disk, not building a search index");
+        return false;
+    }
+
+    for (pkgCache::PkgIterator pkg = pkgcache->PkgBegin(); !pkg.end(); ++pkg) {
+        // Ignore packages that exist only due to dependencies.
+        if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
+            continue;
+        }
+
+        const guint32 offset = static_cast<pkgCache::Package *>(pkg) - pkgcache->PkgP;
+        const char *name = pkg.Name();
+
+        nameTrigrams.clear();
+        AptSearchIndexData::addTrigrams(name, strlen(name), nameTrigrams);
+        uniqueSort(nameTrigrams);
+        for (guint32 trigram : nameTrigrams) {
+            names[trigram].push_back(offset);
+        }
+
+        // the description searched depends on the version that is picked
+        // and on the locale of the job, so index all that may be used
+        detailTrigrams = nameTrigrams;
+        pkgCache::VerIterator vers[] = { cache->findVer(pkg), cache->findCandidateVer(pkg) };
+        for (guint i = 0; i < G_N_ELEMENTS(vers); ++i) {
+            if (vers[i].end() || (i > 0 && vers[i] == vers[0])) {
+                continue;
+            }
+            for (pkgCache::DescIterator desc = vers[i].DescriptionList(); !desc.end(); ++desc) {
+                pkgCache::DescFileIterator df = desc.FileList();
+                if (df.end()) {
+                    continue;
+                }
+                const string longDesc = records->Lookup(df).LongDesc();
+                AptSearchIndexData::addTrigrams(longDesc.data(), longDesc.size(), detailTrigrams);
+            }
+        }
+        uniqueSort(detailTrigrams);
+        for (guint32 trigram : detailTrigrams) {
+            details[trigram].push_back(offset);
+        }
+    }
+
+    const string data = AptSearchIndexData::encode(names, details,
+                                                   pkgcache->HeaderP->PackageCount,
+                                                   mtime, size);
+
+    // replaced atomically, jobs that have the old one mapped keep it
+    if (!g_file_set_contents(path().c_str(), data.data(), data.size(), &error)) {
+        g_warning("failed to write search index: %s", error->message);
+        return false;
+    }
+    g_debug("search index built with %u trigrams for %u packages",
+            static_cast<guint>(details.size()), pkgcache->HeaderP->PackageCount);
+    return true;
+}
+
+bool AptSearchIndex::open(AptCacheFile *cache)
+{
+    guint64 mtime;
+    guint64 size;
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GMappedFile) file = NULL;
+    g_autoptr(GBytes) bytes = NULL;
+
+    m_cache = cache->GetPkgCache();
+    if (m_cache == nullptr || !cacheStamp(mtime, size)) {
+        return false;
+    }
+
+    file = g_mapped_file_new(path().c_str(), FALSE, &error);
+    if (file == nullptr) {
+        g_debug("no search index: %s", error->message);
+        return false;
+    }
+
+    // the bytes keep the file mapped
+    bytes = g_mapped_file_get_bytes(file);
+    if (!m_data.load(bytes)) {
+        g_warning("ignoring invalid search index");
+        return false;
+    }
+    if (m_data.packageCount() != m_cache->HeaderP->PackageCount ||
+            m_data.cacheMtime() != mtime ||
+            m_data.cacheSize() != size) {
+        g_debug("search index was built for another package cache");
+        return false;
+    }
+    m_open = true;
+    return true;
+}
+
+bool AptSearchIndex::lookup(const vector<string> &queries,
+                            bool details,
+                            vector<pkgCache::PkgIterator> &packages)
+{
+    vector<guint32> offsets;
+
+    // every offset is below the package count of the cache, as that was
+    // checked when the index was opened
+    if (!m_open || !m_data.lookup(queries, details, offsets)) {
+        return false;
+    }
+
+    packages.clear();
+    packages.reserve(offsets.size());
+    for (guint32 offset : offsets) {
+        packages.push_back(pkgCache::PkgIterator(*m_cache, m_cache->PkgP + offset));
+    }
+    return true;
+}
@@ -0,0 +1,80 @@
+/* apt-search-index.h
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef APT_SEARCH_INDEX_H
+#define APT_SEARCH_INDEX_H
+
+#include <apt-pkg/pkgcache.h>
+#include <glib.h>
+
+#include <string>
+#include <vector>
+
+#include "apt-search-index-data.h"
+
+using std::string;
+using std::vector;
+
+class AptCacheFile;
+
+/**
+ * Trigram index over package names and descriptions
+ *
+ * The index lives next to the binary package cache and is only valid for
+ * the pkgcache.bin it was built from. It never decides if a package
+ * matches, it only narrows the packages a search has to look at, so
+ * callers still verify every candidate.
+ */
+class AptSearchIndex
+{
+public:
+    AptSearchIndex();
+    ~AptSearchIndex();
+
+    /**
+     * Builds the index for the given cache and atomically replaces the
+     * one on disk
+     */
+    static bool build(AptCacheFile *cache);
+
+    /**
+     * Maps the index, returns false if there is none or if it was built
+     * for another package cache
+     */
+    bool open(AptCacheFile *cache);
+
+    /**
+     * Fills @packages with the packages that may match any of the
+     * queries, in names only or in names and descriptions
+     * @returns false if the index cannot narrow the search, e.g. when a
+     * query is shorter than a trigram or the index is damaged
+     */
+    bool lookup(const vector<string> &queries,
+                bool details,
+                vector<pkgCache::PkgIterator> &packages);
+
+private:
+    static string path();
+
+    AptSearchIndexData m_data;
+    pkgCache *m_cache;
+    bool m_open;
+};
+
+#endif // APT_SEARCH_INDEX_H
@@ -56,8 +56,15 @@ const gchar* pk_backend_get_author(PkBackend *backend)
 gboolean
 pk_backend_supports_parallelization (PkBackend *backend)
 {
-    // we need to set this to TRUE as soon as the parallelization work is completed!
-    return FALSE;
+    // read-only jobs share the cache, jobs that change it lock it, see AptIntf::lockCache()
+    return TRUE;
+}
+
+static void pk_backend_dpkg_status_changed_cb(PkBackend *backend, gpointer data)
+{
+    // something installed or removed packages, queries must see it
+    AptIntf::invalidateCache();
+    pk_backend_installed_db_changed(backend);
 }
 
 void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
@@ -83,6 +90,11 @@ void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
         g_debug("ERROR initializing backend system");
     }
 
+    // the package cache kept warm between queries follows the dpkg database,
+    // changes to the package lists are noticed when the cache is reused
+    string statusFile = _config->FindFile("Dir::State::status");
+    pk_backend_watch_file(backend, statusFile.c_str(), pk_backend_dpkg_status_changed_cb, NULL);
+
     spawn = pk_backend_spawn_new(conf);
     //     pk_backend_spawn_set_job(spawn, backend);
     pk_backend_spawn_set_name(spawn, "aptcc");
@@ -91,6 +103,7 @@ void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
 void pk_backend_destroy(PkBackend *backend)
 {
     g_debug("APTcc being destroyed");
+    AptIntf::invalidateCache();
 }
 
 PkBitfield pk_backend_get_groups(PkBackend *backend)
@@ -889,6 +902,10 @@ static void backend_repo_manager_thread(PkBackendJob *job, GVariant *params, gpo
                        &enabled);
     }
 
+    // sources.list must not change while other jobs read it
+    AptIntf *apt = static_cast<AptIntf*>(pk_backend_job_get_user_data(job));
+    apt->lockCache();
+
     SourcesList sourcesList;
     if (sourcesList.ReadSources() == false) {
         _error->
@@ -943,7 +960,6 @@ static void backend_repo_manager_thread(PkBackendJob *job, GVariant *params, gpo
                 }
             } else if (role == PK_ROLE_ENUM_REPO_REMOVE) {
                 if (autoremove) {
-                    AptIntf *apt = static_cast<AptIntf*>(pk_backend_job_get_user_data(job));
                     if (!apt->init()) {
                         g_debug("Failed to create apt cache");
                         return;
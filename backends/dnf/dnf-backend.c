@@ -28,6 +28,7 @@
 #include <libdnf/libdnf.h>
 
 #include "dnf-backend.h"
+#include "dnf-filter.h"
 
 void
 dnf_emit_package (PkBackendJob *job, PkInfoEnum info, DnfPackage *pkg)
@@ -78,105 +79,13 @@ dnf_emit_package_array (PkBackendJob *job,
 
 void
 dnf_emit_package_list_filter (PkBackendJob *job,
+			      DnfSack *sack,
 			      PkBitfield filters,
 			      GPtrArray *pkglist)
 {
-	DnfPackage *found;
-	DnfPackage *pkg;
-	guint i;
-	g_autoptr(GHashTable) hash_cost = NULL;
-	g_autoptr(GHashTable) hash_installed = NULL;
-
-	/* if a package exists in multiple repos, show the one with the lowest
-	 * cost of downloading */
-	hash_cost = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-	for (i = 0; i < pkglist->len; i++) {
-		pkg = g_ptr_array_index (pkglist, i);
-		if (dnf_package_installed (pkg))
-			continue;
-
-		/* if the NEVRA does not already exist in the array, just add */
-		found = g_hash_table_lookup (hash_cost,
-					     dnf_package_get_nevra (pkg));
-		if (found == NULL) {
-			g_hash_table_insert (hash_cost,
-					     g_strdup (dnf_package_get_nevra (pkg)),
-					     (gpointer) pkg);
-			continue;
-		}
-
-		/* a lower cost package */
-		if (dnf_package_get_cost (pkg) < dnf_package_get_cost (found)) {
-			dnf_package_set_info (found, PK_INFO_ENUM_BLOCKED);
-			g_hash_table_replace (hash_cost,
-					      g_strdup (dnf_package_get_nevra (pkg)),
-					      (gpointer) pkg);
-		} else {
-			dnf_package_set_info (pkg, PK_INFO_ENUM_BLOCKED);
-		}
-	}
-
-	/* add all the installed packages to a hash */
-	hash_installed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-	for (i = 0; i < pkglist->len; i++) {
-		pkg = g_ptr_array_index (pkglist, i);
-		if (!dnf_package_installed (pkg))
-			continue;
-		g_hash_table_insert (hash_installed,
-				     g_strdup (dnf_package_get_nevra (pkg)),
-				     (gpointer) pkg);
-	}
-
-	/* anything remote in metadata-only mode needs to be unavailable */
-	for (i = 0; i < pkglist->len; i++) {
-		DnfRepo *repo;
-		pkg = g_ptr_array_index (pkglist, i);
-		if (dnf_package_installed (pkg))
-			continue;
-		repo = dnf_package_get_repo (pkg);
-		if (repo == NULL)
-			continue;
-		if (dnf_repo_get_enabled (repo) != DNF_REPO_ENABLED_METADATA)
-			continue;
-		dnf_package_set_info (pkg, PK_INFO_ENUM_UNAVAILABLE);
-	}
+	g_autoptr(GPtrArray) filtered = dnf_package_list_filter (sack, filters, pkglist);
 
-	for (i = 0; i < pkglist->len; i++) {
-		pkg = g_ptr_array_index (pkglist, i);
-
-		/* blocked */
-		if ((PkInfoEnum) dnf_package_get_info (pkg) == PK_INFO_ENUM_BLOCKED)
-			continue;
-
-		/* GUI */
-		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_GUI) && !dnf_package_is_gui (pkg))
-			continue;
-		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_GUI) && dnf_package_is_gui (pkg))
-			continue;
-
-		/* DEVELOPMENT */
-		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_DEVELOPMENT) && !dnf_package_is_devel (pkg))
-			continue;
-		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_DEVELOPMENT) && dnf_package_is_devel (pkg))
-			continue;
-
-		/* DOWNLOADED */
-		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_DOWNLOADED) && !dnf_package_is_downloaded (pkg))
-			continue;
-		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_DOWNLOADED) && dnf_package_is_downloaded (pkg))
-			continue;
-
-		/* if this package is available and the very same NEVRA is
-		 * installed, skip this package */
-		if (!dnf_package_installed (pkg)) {
-			found = g_hash_table_lookup (hash_installed,
-						     dnf_package_get_nevra (pkg));
-			if (found != NULL)
-				continue;
-		}
-
-		dnf_emit_package (job, PK_INFO_ENUM_UNKNOWN, pkg);
-	}
+	dnf_emit_package_array (job, PK_INFO_ENUM_UNKNOWN, filtered);
 }
 
 PkInfoEnum
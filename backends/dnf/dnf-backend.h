@@ -26,6 +26,7 @@
 
 #include <libdnf/dnf-advisory.h>
 #include <libdnf/dnf-package.h>
+#include <libdnf/dnf-sack.h>
 
 #include <pk-backend.h>
 
@@ -45,6 +46,7 @@ void		 dnf_emit_package_array		(PkBackendJob		*job,
 						 PkInfoEnum		 info,
 						 GPtrArray		*array);
 void		 dnf_emit_package_list_filter	(PkBackendJob		*job,
+						 DnfSack		*sack,
 						 PkBitfield		 filters,
 						 GPtrArray		*pkglist);
 PkBitfield	 dnf_get_filter_for_ids		(gchar			**package_ids);
@@ -0,0 +1,230 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include <libdnf/libdnf.h>
+
+#include "dnf-filter.h"
+
+#define DNF_FILTER_BITS_KEY	"pk-dnf-filter-bits"
+
+/* what is known about each solvable of a sack, indexed by solvable id */
+typedef enum {
+	DNF_FILTER_BIT_GUI_KNOWN	= 1 << 0,
+	DNF_FILTER_BIT_GUI		= 1 << 1,
+	DNF_FILTER_BIT_DEVEL_KNOWN	= 1 << 2,
+	DNF_FILTER_BIT_DEVEL		= 1 << 3,
+} DnfFilterBits;
+
+/*
+ * The name, evr and arch strings are interned in the pool, so the same
+ * id always gives the same pointer and comparing the pointers compares
+ * the ids. This only holds while no strings are added to the pool, so
+ * the tables are only used before any of the predicates run.
+ */
+static guint
+dnf_filter_nevra_hash (gconstpointer key)
+{
+	DnfPackage *pkg = (DnfPackage *) key;
+	guint hash = g_direct_hash (dnf_package_get_name (pkg));
+
+	hash = hash * 31 + g_direct_hash (dnf_package_get_evr (pkg));
+	return hash * 31 + g_direct_hash (dnf_package_get_arch (pkg));
+}
+
+static gboolean
+dnf_filter_nevra_equal (gconstpointer a, gconstpointer b)
+{
+	DnfPackage *pkg_a = (DnfPackage *) a;
+	DnfPackage *pkg_b = (DnfPackage *) b;
+
+	return dnf_package_get_name (pkg_a) == dnf_package_get_name (pkg_b) &&
+	       dnf_package_get_evr (pkg_a) == dnf_package_get_evr (pkg_b) &&
+	       dnf_package_get_arch (pkg_a) == dnf_package_get_arch (pkg_b);
+}
+
+/* the bits live as long as the sack, which is cached between jobs */
+static GByteArray *
+dnf_filter_get_bits (DnfSack *sack)
+{
+	GByteArray *bits = g_object_get_data (G_OBJECT (sack), DNF_FILTER_BITS_KEY);
+
+	if (bits == NULL) {
+		bits = g_byte_array_new ();
+		g_object_set_data_full (G_OBJECT (sack), DNF_FILTER_BITS_KEY, bits,
+					(GDestroyNotify) g_byte_array_unref);
+	}
+	return bits;
+}
+
+static guint8 *
+dnf_filter_bits_for_package (GByteArray *bits, DnfPackage *pkg)
+{
+	guint id = dnf_package_get_id (pkg);
+
+	/* packages added to the sack later have higher ids */
+	if (id >= bits->len) {
+		guint len = bits->len;
+		g_byte_array_set_size (bits, id + 1);
+		memset (bits->data + len, 0, bits->len - len);
+	}
+	return &bits->data[id];
+}
+
+static gboolean
+dnf_filter_is_gui (GByteArray *bits, DnfPackage *pkg)
+{
+	guint8 *b = dnf_filter_bits_for_package (bits, pkg);
+
+	/* this looks at all the requires */
+	if ((*b & DNF_FILTER_BIT_GUI_KNOWN) == 0) {
+		*b |= DNF_FILTER_BIT_GUI_KNOWN;
+		if (dnf_package_is_gui (pkg))
+			*b |= DNF_FILTER_BIT_GUI;
+	}
+	return (*b & DNF_FILTER_BIT_GUI) > 0;
+}
+
+static gboolean
+dnf_filter_is_devel (GByteArray *bits, DnfPackage *pkg)
+{
+	guint8 *b = dnf_filter_bits_for_package (bits, pkg);
+
+	if ((*b & DNF_FILTER_BIT_DEVEL_KNOWN) == 0) {
+		*b |= DNF_FILTER_BIT_DEVEL_KNOWN;
+		if (dnf_package_is_devel (pkg))
+			*b |= DNF_FILTER_BIT_DEVEL;
+	}
+	return (*b & DNF_FILTER_BIT_DEVEL) > 0;
+}
+
+/**
+ * dnf_package_list_filter:
+ * @sack: the #DnfSack all the packages belong to
+ * @filters: the #PkBitfield of filters
+ * @pkglist: the #DnfPackage's to filter
+ *
+ * Picks the packages of @pkglist that should be shown for @filters.
+ *
+ * Remote packages in metadata-only repos are set as unavailable. If the
+ * same package is available from more than one repo, all but the one
+ * with the lowest cost are set as blocked and left out. Available
+ * packages that are also installed are left out too.
+ *
+ * The GUI and development checks are remembered for each solvable of
+ * @sack, as jobs do not run in parallel and the sack is cached between
+ * them.
+ *
+ * Return value: (transfer container): the packages to show
+ **/
+GPtrArray *
+dnf_package_list_filter (DnfSack *sack, PkBitfield filters, GPtrArray *pkglist)
+{
+	DnfPackage *found;
+	DnfPackage *pkg;
+	GByteArray *bits = dnf_filter_get_bits (sack);
+	GPtrArray *result;
+	guint i;
+	gboolean filter_gui = pk_bitfield_contain (filters, PK_FILTER_ENUM_GUI);
+	gboolean filter_not_gui = pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_GUI);
+	gboolean filter_devel = pk_bitfield_contain (filters, PK_FILTER_ENUM_DEVELOPMENT);
+	gboolean filter_not_devel = pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_DEVELOPMENT);
+	gboolean filter_downloaded = pk_bitfield_contain (filters, PK_FILTER_ENUM_DOWNLOADED);
+	gboolean filter_not_downloaded = pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_DOWNLOADED);
+	g_autofree gboolean *skip = g_new0 (gboolean, pkglist->len);
+	g_autoptr(GHashTable) hash_cost = NULL;
+	g_autoptr(GHashTable) hash_installed = NULL;
+
+	/* keyed on the name, evr and arch of the packages */
+	hash_cost = g_hash_table_new (dnf_filter_nevra_hash, dnf_filter_nevra_equal);
+	hash_installed = g_hash_table_new (dnf_filter_nevra_hash, dnf_filter_nevra_equal);
+	for (i = 0; i < pkglist->len; i++) {
+		DnfRepo *repo;
+
+		pkg = g_ptr_array_index (pkglist, i);
+		if (dnf_package_installed (pkg)) {
+			g_hash_table_add (hash_installed, pkg);
+			continue;
+		}
+
+		/* anything remote in metadata-only mode needs to be unavailable */
+		repo = dnf_package_get_repo (pkg);
+		if (repo != NULL &&
+		    dnf_repo_get_enabled (repo) == DNF_REPO_ENABLED_METADATA)
+			dnf_package_set_info (pkg, PK_INFO_ENUM_UNAVAILABLE);
+
+		/* if a package exists in multiple repos, show the one with
+		 * the lowest cost of downloading */
+		found = g_hash_table_lookup (hash_cost, pkg);
+		if (found == NULL) {
+			g_hash_table_add (hash_cost, pkg);
+			continue;
+		}
+		if (dnf_package_get_cost (pkg) < dnf_package_get_cost (found)) {
+			dnf_package_set_info (found, PK_INFO_ENUM_BLOCKED);
+			g_hash_table_add (hash_cost, pkg);
+		} else {
+			dnf_package_set_info (pkg, PK_INFO_ENUM_BLOCKED);
+		}
+	}
+
+	/* if this package is available and the very same NEVRA is
+	 * installed, skip this package */
+	for (i = 0; i < pkglist->len && g_hash_table_size (hash_installed) > 0; i++) {
+		pkg = g_ptr_array_index (pkglist, i);
+		if (!dnf_package_installed (pkg) &&
+		    g_hash_table_contains (hash_installed, pkg))
+			skip[i] = TRUE;
+	}
+
+	result = g_ptr_array_sized_new (pkglist->len);
+	for (i = 0; i < pkglist->len; i++) {
+		pkg = g_ptr_array_index (pkglist, i);
+		if (skip[i])
+			continue;
+
+		/* blocked */
+		if ((PkInfoEnum) dnf_package_get_info (pkg) == PK_INFO_ENUM_BLOCKED)
+			continue;
+
+		/* GUI, the requires are only examined when filtering on them */
+		if ((filter_gui || filter_not_gui) &&
+		    dnf_filter_is_gui (bits, pkg) != filter_gui)
+			continue;
+
+		/* DEVELOPMENT */
+		if ((filter_devel || filter_not_devel) &&
+		    dnf_filter_is_devel (bits, pkg) != filter_devel)
+			continue;
+
+		/* DOWNLOADED */
+		if ((filter_downloaded || filter_not_downloaded) &&
+		    dnf_package_is_downloaded (pkg) != filter_downloaded)
+			continue;
+
+		g_ptr_array_add (result, pkg);
+	}
+	return result;
+}
@@ -0,0 +1,180 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <libdnf/libdnf.h>
+
+#include "dnf-plan-cache.h"
+
+/* a goal solved by a simulation, kept for the transaction that follows */
+typedef struct {
+	gchar		*token;
+	gchar		*request;	/* everything that went into the goal */
+	gchar		*rpmdb;		/* installed-db generation */
+	DnfSack		*sack;
+	HyGoal		 goal;
+} DnfPlanCacheItem;
+
+struct DnfPlanCache {
+	GMutex			 mutex;
+	DnfPlanCacheItem	*item;	/* only the most recent simulation */
+};
+
+static void
+dnf_plan_cache_item_free (DnfPlanCacheItem *item)
+{
+	/* the goal points into the sack */
+	if (item->goal != NULL)
+		hy_goal_free (item->goal);
+	g_object_unref (item->sack);
+	g_free (item->token);
+	g_free (item->request);
+	g_free (item->rpmdb);
+	g_slice_free (DnfPlanCacheItem, item);
+}
+
+/**
+ * dnf_plan_cache_new:
+ *
+ * Creates a cache that keeps the goal of the last simulation, so the
+ * transaction with the same plan token does not have to solve it again.
+ *
+ * Return value: a new #DnfPlanCache
+ **/
+DnfPlanCache *
+dnf_plan_cache_new (void)
+{
+	DnfPlanCache *cache = g_new0 (DnfPlanCache, 1);
+	g_mutex_init (&cache->mutex);
+	return cache;
+}
+
+/**
+ * dnf_plan_cache_free:
+ * @cache: a #DnfPlanCache
+ *
+ * Frees the cache, and the plan it keeps.
+ **/
+void
+dnf_plan_cache_free (DnfPlanCache *cache)
+{
+	if (cache->item != NULL)
+		dnf_plan_cache_item_free (cache->item);
+	g_mutex_clear (&cache->mutex);
+	g_free (cache);
+}
+
+/**
+ * dnf_plan_cache_save:
+ * @cache: a #DnfPlanCache
+ * @token: the plan token of the simulation
+ * @request: describes everything that went into @goal apart from the sack
+ * @rpmdb: the installed-db generation @goal was solved against
+ * @goal: (transfer full): the solved goal
+ *
+ * Keeps @goal, replacing any plan that was kept before.
+ **/
+void
+dnf_plan_cache_save (DnfPlanCache *cache,
+		     const gchar *token,
+		     const gchar *request,
+		     const gchar *rpmdb,
+		     HyGoal goal)
+{
+	DnfPlanCacheItem *item;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	item = g_slice_new0 (DnfPlanCacheItem);
+	item->token = g_strdup (token);
+	item->request = g_strdup (request);
+	item->rpmdb = g_strdup (rpmdb);
+	item->sack = g_object_ref (hy_goal_get_sack (goal));
+	item->goal = goal;
+
+	locker = g_mutex_locker_new (&cache->mutex);
+	if (cache->item != NULL)
+		dnf_plan_cache_item_free (cache->item);
+	cache->item = item;
+}
+
+/**
+ * dnf_plan_cache_take:
+ * @cache: a #DnfPlanCache
+ * @token: the plan token of the transaction
+ * @request: describes everything that goes into the goal apart from the sack
+ * @rpmdb: the current installed-db generation
+ * @sack: the sack the transaction uses
+ *
+ * Takes the plan for @token, if nothing changed since it was saved. A
+ * plan is only ever used once, so a stale plan is dropped.
+ *
+ * Return value: (transfer full): the solved goal, or %NULL
+ **/
+HyGoal
+dnf_plan_cache_take (DnfPlanCache *cache,
+		     const gchar *token,
+		     const gchar *request,
+		     const gchar *rpmdb,
+		     DnfSack *sack)
+{
+	DnfPlanCacheItem *item;
+	HyGoal goal;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	locker = g_mutex_locker_new (&cache->mutex);
+	if (cache->item == NULL || g_strcmp0 (cache->item->token, token) != 0)
+		return NULL;
+	item = g_steal_pointer (&cache->item);
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	if (g_strcmp0 (item->request, request) != 0 ||
+	    g_strcmp0 (item->rpmdb, rpmdb) != 0 ||
+	    item->sack != sack) {
+		g_debug ("not reusing plan %s as the system changed", token);
+		dnf_plan_cache_item_free (item);
+		return NULL;
+	}
+	g_debug ("reusing plan %s", token);
+	goal = g_steal_pointer (&item->goal);
+	dnf_plan_cache_item_free (item);
+	return goal;
+}
+
+/**
+ * dnf_plan_cache_invalidate:
+ * @cache: a #DnfPlanCache
+ * @why: the reason, for debugging
+ *
+ * Drops the plan, as the repos or the rpmdb changed under it.
+ **/
+void
+dnf_plan_cache_invalidate (DnfPlanCache *cache, const gchar *why)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&cache->mutex);
+
+	if (cache->item == NULL)
+		return;
+	g_debug ("invalidating plan %s as %s", cache->item->token, why);
+	g_clear_pointer (&cache->item, dnf_plan_cache_item_free);
+}
@@ -0,0 +1,50 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __DNF_PLAN_CACHE_H
+#define __DNF_PLAN_CACHE_H
+
+#include <glib.h>
+
+#include <libdnf/libdnf.h>
+
+G_BEGIN_DECLS
+
+typedef struct DnfPlanCache DnfPlanCache;
+
+DnfPlanCache	*dnf_plan_cache_new		(void);
+void		 dnf_plan_cache_free		(DnfPlanCache		*cache);
+void		 dnf_plan_cache_save		(DnfPlanCache		*cache,
+						 const gchar		*token,
+						 const gchar		*request,
+						 const gchar		*rpmdb,
+						 HyGoal			 goal);
+HyGoal		 dnf_plan_cache_take		(DnfPlanCache		*cache,
+						 const gchar		*token,
+						 const gchar		*request,
+						 const gchar		*rpmdb,
+						 DnfSack		*sack);
+void		 dnf_plan_cache_invalidate	(DnfPlanCache		*cache,
+						 const gchar		*why);
+
+G_END_DECLS
+
+#endif /* __DNF_PLAN_CACHE_H */
@@ -0,0 +1,369 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <libdnf/libdnf.h>
+
+#include "dnf-refresh.h"
+
+/*
+ * Everything the workers share with the thread that waits for them. The
+ * DnfState of the caller is not thread-safe, so the workers only record
+ * their progress here and the waiting thread passes it on.
+ */
+typedef struct {
+	GPtrArray		*repos;
+	DnfRefreshRepoFunc	 func;
+	gpointer		 user_data;
+	GCancellable		*cancellable;
+	GMutex			 mutex;
+	GCond			 cond;
+	guint			*percentages;	/* one per repo */
+	guint			 pending;
+	DnfStateAction		 action;	/* the latest one */
+	gchar			*action_hint;
+	gboolean		 action_changed;
+	GError			*error;		/* the first one */
+} DnfRefreshHelper;
+
+typedef struct {
+	DnfRefreshHelper	*helper;
+	guint			 idx;
+} DnfRefreshItem;
+
+static void
+dnf_refresh_percentage_changed_cb (DnfState *state,
+				   guint value,
+				   DnfRefreshItem *item)
+{
+	DnfRefreshHelper *helper = item->helper;
+
+	g_mutex_lock (&helper->mutex);
+	if (value > helper->percentages[item->idx]) {
+		helper->percentages[item->idx] = value;
+		g_cond_signal (&helper->cond);
+	}
+	g_mutex_unlock (&helper->mutex);
+}
+
+static void
+dnf_refresh_action_changed_cb (DnfState *state,
+			       DnfStateAction action,
+			       const gchar *action_hint,
+			       DnfRefreshItem *item)
+{
+	DnfRefreshHelper *helper = item->helper;
+
+	if (action == DNF_STATE_ACTION_UNKNOWN)
+		return;
+
+	g_mutex_lock (&helper->mutex);
+	helper->action = action;
+	g_free (helper->action_hint);
+	helper->action_hint = g_strdup (action_hint);
+	helper->action_changed = TRUE;
+	g_cond_signal (&helper->cond);
+	g_mutex_unlock (&helper->mutex);
+}
+
+static void
+dnf_refresh_worker (gpointer data, gpointer user_data)
+{
+	DnfRefreshHelper *helper = user_data;
+	DnfRefreshItem item;
+	DnfRepo *repo;
+	gboolean skip;
+	g_autoptr(DnfState) state = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	item.helper = helper;
+	item.idx = GPOINTER_TO_UINT (data) - 1;
+	repo = g_ptr_array_index (helper->repos, item.idx);
+
+	/* another repo already failed */
+	g_mutex_lock (&helper->mutex);
+	skip = helper->error != NULL;
+	g_mutex_unlock (&helper->mutex);
+	if (skip)
+		goto out;
+
+	/* DnfState is not thread-safe, so each repo gets its own */
+	state = dnf_state_new ();
+	dnf_state_set_cancellable (state, helper->cancellable);
+	g_signal_connect (state, "percentage-changed",
+			  G_CALLBACK (dnf_refresh_percentage_changed_cb),
+			  &item);
+	g_signal_connect (state, "action-changed",
+			  G_CALLBACK (dnf_refresh_action_changed_cb),
+			  &item);
+	helper->func (repo, state, helper->user_data, &error_local);
+out:
+	g_mutex_lock (&helper->mutex);
+	if (error_local != NULL && helper->error == NULL)
+		helper->error = g_steal_pointer (&error_local);
+	helper->percentages[item.idx] = 100;
+	helper->pending--;
+	g_cond_signal (&helper->cond);
+	g_mutex_unlock (&helper->mutex);
+
+	/* the callback data is on our stack */
+	if (state != NULL)
+		g_signal_handlers_disconnect_by_data (state, &item);
+}
+
+/* media and local repos are used where they are */
+static gboolean
+dnf_refresh_repo_is_remote (DnfRepo *repo)
+{
+	if (dnf_repo_get_enabled (repo) == DNF_REPO_ENABLED_NONE)
+		return FALSE;
+	if (dnf_repo_get_kind (repo) == DNF_REPO_KIND_MEDIA)
+		return FALSE;
+	if (dnf_repo_get_kind (repo) == DNF_REPO_KIND_LOCAL)
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * dnf_refresh_get_stale_repos:
+ * @repos: (element-type DnfRepo): all the repos
+ * @cache_age: the maximum age of the metadata in seconds
+ * @force: if all the enabled remote repos should be refreshed
+ * @state: a #DnfState
+ * @error: a #GError, or %NULL
+ *
+ * Checks the metadata of every enabled remote repo.
+ *
+ * Return value: (transfer container) (element-type DnfRepo): the repos
+ * that need refreshing, or %NULL for error
+ **/
+GPtrArray *
+dnf_refresh_get_stale_repos (GPtrArray *repos,
+			     guint cache_age,
+			     gboolean force,
+			     DnfState *state,
+			     GError **error)
+{
+	DnfRepo *repo;
+	guint cnt = 0;
+	guint i;
+	g_autoptr(GPtrArray) stale = g_ptr_array_new ();
+
+	for (i = 0; i < repos->len; i++) {
+		if (dnf_refresh_repo_is_remote (g_ptr_array_index (repos, i)))
+			cnt++;
+	}
+	dnf_state_set_number_steps (state, cnt);
+	for (i = 0; i < repos->len; i++) {
+		DnfState *state_local;
+
+		repo = g_ptr_array_index (repos, i);
+		if (!dnf_refresh_repo_is_remote (repo))
+			continue;
+
+		/* is the repo up to date? */
+		state_local = dnf_state_get_child (state);
+		if (force || !dnf_repo_check (repo, cache_age, state_local, NULL))
+			g_ptr_array_add (stale, repo);
+
+		/* done */
+		if (!dnf_state_done (state, error))
+			return NULL;
+	}
+	return g_steal_pointer (&stale);
+}
+
+/**
+ * dnf_refresh_repo:
+ * @repo: the repo to refresh
+ * @cache_age: the maximum age of the metadata in seconds
+ * @state: a #DnfState
+ * @error: a #GError, or %NULL
+ *
+ * Downloads the metadata of @repo unless it is up to date. A repo that
+ * cannot be reached is skipped with a warning, as the old metadata can
+ * still be used.
+ *
+ * Return value: %TRUE for success
+ **/
+gboolean
+dnf_refresh_repo (DnfRepo *repo,
+		  guint cache_age,
+		  DnfState *state,
+		  GError **error)
+{
+	gboolean repo_okay;
+	DnfState *state_local;
+	g_autoptr(GError) error_local = NULL;
+
+	/* set state */
+	if (!dnf_state_set_steps (state, error,
+				  2, /* check */
+				  98, /* download */
+				  -1))
+		return FALSE;
+
+	/* is the repo up to date? */
+	state_local = dnf_state_get_child (state);
+	repo_okay = dnf_repo_check (repo, cache_age, state_local, &error_local);
+	if (!repo_okay) {
+		g_debug ("repo %s not okay [%s], refreshing",
+			 dnf_repo_get_id (repo), error_local->message);
+		g_clear_error (&error_local);
+		if (!dnf_state_finished (state_local, error))
+			return FALSE;
+	}
+
+	/* done */
+	if (!dnf_state_done (state, error))
+		return FALSE;
+
+	/* update repo, TODO: if we have network access */
+	if (!repo_okay) {
+		state_local = dnf_state_get_child (state);
+		if (!dnf_repo_update (repo,
+				      DNF_REPO_UPDATE_FLAG_IMPORT_PUBKEY,
+				      state_local,
+				      &error_local)) {
+			if (!g_error_matches (error_local,
+					      DNF_ERROR,
+					      DNF_ERROR_CANNOT_FETCH_SOURCE)) {
+				g_propagate_error (error, g_steal_pointer (&error_local));
+				return FALSE;
+			}
+			g_warning ("Skipping refresh of %s: %s",
+				   dnf_repo_get_id (repo),
+				   error_local->message);
+			if (!dnf_state_finished (state_local, error))
+				return FALSE;
+		}
+	}
+
+	/* done */
+	return dnf_state_done (state, error);
+}
+
+/**
+ * dnf_refresh_repos:
+ * @repos: (element-type DnfRepo): the repos to refresh
+ * @max_parallel: how many repos are refreshed at the same time
+ * @func: the function that refreshes one repo
+ * @user_data: data to pass to @func
+ * @cancellable: a #GCancellable, or %NULL
+ * @state: a #DnfState
+ * @error: a #GError, or %NULL
+ *
+ * Calls @func for each repo from a pool of worker threads. The progress
+ * and the actions of the workers are reported on @state from the calling
+ * thread, the progress being the average of all the repos. After the first
+ * error no more repos are started, and that error is returned.
+ *
+ * Return value: %TRUE for success
+ **/
+gboolean
+dnf_refresh_repos (GPtrArray *repos,
+		   guint max_parallel,
+		   DnfRefreshRepoFunc func,
+		   gpointer user_data,
+		   GCancellable *cancellable,
+		   DnfState *state,
+		   GError **error)
+{
+	DnfRefreshHelper helper = { 0 };
+	GThreadPool *pool;
+	gboolean action_started = FALSE;
+	gboolean ret = FALSE;
+	guint percentage = 0;
+	guint i;
+
+	g_return_val_if_fail (repos != NULL, FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+
+	if (repos->len == 0)
+		return dnf_state_finished (state, error);
+
+	helper.repos = repos;
+	helper.func = func;
+	helper.user_data = user_data;
+	helper.cancellable = cancellable;
+	helper.percentages = g_new0 (guint, repos->len);
+	helper.pending = repos->len;
+	g_mutex_init (&helper.mutex);
+	g_cond_init (&helper.cond);
+
+	pool = g_thread_pool_new (dnf_refresh_worker, &helper,
+				  MAX (MIN (repos->len, max_parallel), 1),
+				  TRUE, error);
+	if (pool == NULL)
+		goto out;
+	for (i = 0; i < repos->len; i++)
+		g_thread_pool_push (pool, GUINT_TO_POINTER (i + 1), NULL);
+
+	g_mutex_lock (&helper.mutex);
+	while (helper.pending > 0) {
+		DnfStateAction action = DNF_STATE_ACTION_UNKNOWN;
+		guint percentage_new = 0;
+		guint total = 0;
+		g_autofree gchar *action_hint = NULL;
+
+		g_cond_wait (&helper.cond, &helper.mutex);
+		if (helper.action_changed) {
+			action = helper.action;
+			action_hint = g_steal_pointer (&helper.action_hint);
+			helper.action_changed = FALSE;
+		}
+		for (i = 0; i < repos->len; i++)
+			total += helper.percentages[i];
+		if (helper.pending > 0 && total / repos->len > percentage)
+			percentage_new = total / repos->len;
+		g_mutex_unlock (&helper.mutex);
+
+		/* the job shows what the repos are doing, e.g. downloading */
+		if (action != DNF_STATE_ACTION_UNKNOWN) {
+			dnf_state_action_start (state, action, action_hint);
+			action_started = TRUE;
+		}
+		if (percentage_new > 0) {
+			percentage = percentage_new;
+			dnf_state_set_percentage (state, percentage);
+		}
+		g_mutex_lock (&helper.mutex);
+	}
+	g_mutex_unlock (&helper.mutex);
+	g_thread_pool_free (pool, FALSE, TRUE);
+	if (action_started)
+		dnf_state_action_stop (state);
+
+	if (helper.error != NULL) {
+		g_propagate_error (error, g_steal_pointer (&helper.error));
+		goto out;
+	}
+	ret = dnf_state_finished (state, error);
+out:
+	g_free (helper.action_hint);
+	g_free (helper.percentages);
+	g_mutex_clear (&helper.mutex);
+	g_cond_clear (&helper.cond);
+	return ret;
+}
@@ -0,0 +1,67 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __DNF_REFRESH_H
+#define __DNF_REFRESH_H
+
+#include <glib.h>
+
+#include <libdnf/libdnf.h>
+
+G_BEGIN_DECLS
+
+/**
+ * DnfRefreshRepoFunc:
+ * @repo: the repo to refresh
+ * @state: a #DnfState that only this call uses
+ * @user_data: the data passed to dnf_refresh_repos()
+ * @error: a #GError, or %NULL
+ *
+ * Refreshes one repo. This is called from a worker thread, and several
+ * repos may be refreshed at the same time.
+ *
+ * Return value: %TRUE for success
+ **/
+typedef gboolean (*DnfRefreshRepoFunc)		(DnfRepo		*repo,
+						 DnfState		*state,
+						 gpointer		 user_data,
+						 GError			**error);
+
+GPtrArray	*dnf_refresh_get_stale_repos	(GPtrArray		*repos,
+						 guint			 cache_age,
+						 gboolean		 force,
+						 DnfState		*state,
+						 GError			**error);
+gboolean	 dnf_refresh_repo		(DnfRepo		*repo,
+						 guint			 cache_age,
+						 DnfState		*state,
+						 GError			**error);
+gboolean	 dnf_refresh_repos		(GPtrArray		*repos,
+						 guint			 max_parallel,
+						 DnfRefreshRepoFunc	 func,
+						 gpointer		 user_data,
+						 GCancellable		*cancellable,
+						 DnfState		*state,
+						 GError			**error);
+
+G_END_DECLS
+
+#endif /* __DNF_REFRESH_H */
@@ -0,0 +1,535 @@
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <libdnf/libdnf.h>
+#include <libdnf/hy-query.h>
+#include <libdnf/hy-repo.h>
+
+#include "dnf-filter.h"
+#include "dnf-plan-cache.h"
+#include "dnf-refresh.h"
+
+#define DNF_TEST_REPOS	4
+
+/* the synthetic sack has this many packages, some in both repos */
+#define DNF_TEST_FILTER_PACKAGES_A	60000
+#define DNF_TEST_FILTER_PACKAGES_B	40000
+
+/* every worker waits here until all of them have started */
+typedef struct {
+	GMutex		 mutex;
+	GCond		 cond;
+	guint		 active;
+	gboolean	 timed_out;
+} DnfTestRefresh;
+
+static gboolean
+dnf_test_refresh_repo_cb (DnfRepo *repo,
+			  DnfState *state,
+			  gpointer user_data,
+			  GError **error)
+{
+	DnfTestRefresh *refresh = user_data;
+	gint64 end_time = g_get_monotonic_time () + 10 * G_TIME_SPAN_SECOND;
+
+	g_mutex_lock (&refresh->mutex);
+	refresh->active++;
+	g_cond_broadcast (&refresh->cond);
+	while (refresh->active < DNF_TEST_REPOS && !refresh->timed_out) {
+		if (!g_cond_wait_until (&refresh->cond, &refresh->mutex, end_time))
+			refresh->timed_out = TRUE;
+	}
+	g_mutex_unlock (&refresh->mutex);
+
+	/* what the backend does for each repo, apart from appstream */
+	return dnf_refresh_repo (repo, G_MAXUINT, state, error);
+}
+
+/* serves the files below a directory, one request at a time */
+typedef struct {
+	GSocket		*socket;
+	GCancellable	*cancellable;
+	GThread		*thread;
+	gchar		*root;
+	guint16		 port;
+} DnfTestHttp;
+
+static void
+dnf_test_http_serve (DnfTestHttp *http, GSocket *socket)
+{
+	GOutputStream *output;
+	gsize len = 0;
+	g_autofree gchar *data = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *header = NULL;
+	g_autofree gchar *request = NULL;
+	g_auto(GStrv) split = NULL;
+	g_autoptr(GDataInputStream) input = NULL;
+	g_autoptr(GSocketConnection) connection = NULL;
+
+	connection = g_socket_connection_factory_create_connection (socket);
+	input = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+	output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+	/* only the request line matters */
+	request = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+	if (request == NULL)
+		return;
+	for (;;) {
+		g_autofree gchar *line = g_data_input_stream_read_line (input, NULL, NULL, NULL);
+		if (line == NULL || line[0] == '\0' || g_strcmp0 (line, "\r") == 0)
+			break;
+	}
+	split = g_strsplit (request, " ", 3);
+	if (g_strv_length (split) == 3 &&
+	    g_strcmp0 (split[0], "GET") == 0 &&
+	    strstr (split[1], "..") == NULL) {
+		filename = g_build_filename (http->root, split[1], NULL);
+		g_file_get_contents (filename, &data, &len, NULL);
+	}
+	if (data == NULL) {
+		header = g_strdup ("HTTP/1.1 404 Not Found\r\n"
+				   "Content-Length: 0\r\n"
+				   "Connection: close\r\n\r\n");
+	} else {
+		header = g_strdup_printf ("HTTP/1.1 200 OK\r\n"
+					  "Content-Length: %" G_GSIZE_FORMAT "\r\n"
+					  "Connection: close\r\n\r\n", len);
+	}
+	g_output_stream_write_all (output, header, strlen (header), NULL, NULL, NULL);
+	if (data != NULL)
+		g_output_stream_write_all (output, data, len, NULL, NULL, NULL);
+	g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+}
+
+static gpointer
+dnf_test_http_thread (gpointer user_data)
+{
+	DnfTestHttp *http = user_data;
+
+	for (;;) {
+		g_autoptr(GSocket) socket = g_socket_accept (http->socket,
+							     http->cancellable,
+							     NULL);
+		if (socket == NULL)
+			break;
+		dnf_test_http_serve (http, socket);
+	}
+	return NULL;
+}
+
+static DnfTestHttp *
+dnf_test_http_new (const gchar *root)
+{
+	DnfTestHttp *http = g_new0 (DnfTestHttp, 1);
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GSocketAddress) address = NULL;
+	g_autoptr(GSocketAddress) address_local = NULL;
+
+	http->root = g_strdup (root);
+	http->cancellable = g_cancellable_new ();
+	http->socket = g_socket_new (G_SOCKET_FAMILY_IPV4,
+				     G_SOCKET_TYPE_STREAM,
+				     G_SOCKET_PROTOCOL_TCP,
+				     &error);
+	g_assert_no_error (error);
+	address = g_inet_socket_address_new_from_string ("127.0.0.1", 0);
+	ret = g_socket_bind (http->socket, address, TRUE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = g_socket_listen (http->socket, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	address_local = g_socket_get_local_address (http->socket, &error);
+	g_assert_no_error (error);
+	http->port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (address_local));
+	http->thread = g_thread_new ("dnf-test-http", dnf_test_http_thread, http);
+	return http;
+}
+
+static void
+dnf_test_http_free (DnfTestHttp *http)
+{
+	g_cancellable_cancel (http->cancellable);
+	g_thread_join (http->thread);
+	g_object_unref (http->socket);
+	g_object_unref (http->cancellable);
+	g_free (http->root);
+	g_free (http);
+}
+
+static void
+dnf_test_refresh_action_changed_cb (DnfState *state,
+				    DnfStateAction action,
+				    const gchar *action_hint,
+				    gboolean *seen)
+{
+	if (action == DNF_STATE_ACTION_DOWNLOAD_METADATA)
+		*seen = TRUE;
+}
+
+static void
+dnf_test_refresh_percentage_changed_cb (DnfState *state,
+					guint value,
+					guint *percentage)
+{
+	g_assert_cmpint (value, >=, *percentage);
+	*percentage = value;
+}
+
+static void
+dnf_test_refresh_repos_func (void)
+{
+	const gchar *createrepo = g_getenv ("DNF_TEST_CREATEREPO");
+	DnfTestRefresh refresh = { 0 };
+	DnfTestHttp *http;
+	GPtrArray *repos;
+	gboolean ret;
+	gboolean seen = FALSE;
+	guint percentage = 0;
+	guint i;
+	g_autofree gchar *cache_dir = NULL;
+	g_autofree gchar *local_dir = NULL;
+	g_autofree gchar *local_fn = NULL;
+	g_autofree gchar *local_data = NULL;
+	g_autofree gchar *repos_dir = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(DnfContext) context = NULL;
+	g_autoptr(DnfState) state = NULL;
+	g_autoptr(DnfState) state_stale = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) stale = NULL;
+	const gchar *repos_dirs[] = { NULL, NULL };
+
+	if (createrepo == NULL) {
+		g_test_skip ("createrepo_c is needed to create the repos");
+		return;
+	}
+
+	/* create some empty repos, served over HTTP so the backend treats
+	 * them as remote, and the files that point at them */
+	tmp_dir = g_dir_make_tmp ("dnf-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	http = dnf_test_http_new (tmp_dir);
+	g_setenv ("no_proxy", "127.0.0.1", TRUE);
+	repos_dir = g_build_filename (tmp_dir, "yum.repos.d", NULL);
+	g_assert_cmpint (g_mkdir (repos_dir, 0755), ==, 0);
+	for (i = 0; i < DNF_TEST_REPOS; i++) {
+		const gchar *argv[] = { createrepo, "--quiet", NULL, NULL };
+		gint exit_status;
+		g_autofree gchar *id = g_strdup_printf ("test%u", i);
+		g_autofree gchar *filename = NULL;
+		g_autofree gchar *repo_dir = g_build_filename (tmp_dir, id, NULL);
+		g_autofree gchar *data = NULL;
+
+		g_assert_cmpint (g_mkdir (repo_dir, 0755), ==, 0);
+		argv[2] = repo_dir;
+		ret = g_spawn_sync (NULL, (gchar **) argv, NULL,
+				    G_SPAWN_STDOUT_TO_DEV_NULL,
+				    NULL, NULL, NULL, NULL,
+				    &exit_status, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+		g_assert_cmpint (exit_status, ==, 0);
+
+		data = g_strdup_printf ("[%s]\nname=%s\nbaseurl=http://127.0.0.1:%u/%s\n"
+					"enabled=1\ngpgcheck=0\n",
+					id, id, (guint) http->port, id);
+		filename = g_strdup_printf ("%s/%s.repo", repos_dir, id);
+		ret = g_file_set_contents (filename, data, -1, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+
+	/* a local repo is never refreshed */
+	local_dir = g_build_filename (tmp_dir, "local", NULL);
+	g_assert_cmpint (g_mkdir (local_dir, 0755), ==, 0);
+	local_data = g_strdup_printf ("[local]\nname=local\nbaseurl=file://%s\n"
+				      "enabled=1\ngpgcheck=0\n", local_dir);
+	local_fn = g_build_filename (repos_dir, "local.repo", NULL);
+	ret = g_file_set_contents (local_fn, local_data, -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* load them */
+	context = dnf_context_new ();
+	repos_dirs[0] = repos_dir;
+	dnf_context_set_repos_dir (context, repos_dirs);
+	cache_dir = g_build_filename (tmp_dir, "metadata", NULL);
+	dnf_context_set_cache_dir (context, cache_dir);
+	dnf_context_set_solv_dir (context, tmp_dir);
+	dnf_context_set_lock_dir (context, tmp_dir);
+	dnf_context_set_install_root (context, tmp_dir);
+	dnf_context_set_release_ver (context, "1");
+	ret = dnf_context_setup (context, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	repos = dnf_context_get_repos (context);
+	g_assert_cmpint (repos->len, ==, DNF_TEST_REPOS + 1);
+
+	/* only the remote repos need refreshing, as in the backend */
+	state_stale = dnf_state_new ();
+	stale = dnf_refresh_get_stale_repos (repos, G_MAXUINT, FALSE, state_stale, &error);
+	g_assert_no_error (error);
+	g_assert (stale != NULL);
+	g_assert_cmpint (stale->len, ==, DNF_TEST_REPOS);
+	for (i = 0; i < stale->len; i++) {
+		DnfRepo *repo = g_ptr_array_index (stale, i);
+		g_assert_cmpstr (dnf_repo_get_id (repo), !=, "local");
+	}
+
+	/* refresh them all at once */
+	state = dnf_state_new ();
+	g_signal_connect (state, "action-changed",
+			  G_CALLBACK (dnf_test_refresh_action_changed_cb), &seen);
+	g_signal_connect (state, "percentage-changed",
+			  G_CALLBACK (dnf_test_refresh_percentage_changed_cb), &percentage);
+	g_mutex_init (&refresh.mutex);
+	g_cond_init (&refresh.cond);
+	ret = dnf_refresh_repos (stale, DNF_TEST_REPOS,
+				 dnf_test_refresh_repo_cb, &refresh,
+				 NULL, state, &error);
+	g_cond_clear (&refresh.cond);
+	g_mutex_clear (&refresh.mutex);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* every worker was running before any of them finished */
+	g_assert (!refresh.timed_out);
+	g_assert_cmpint (refresh.active, ==, DNF_TEST_REPOS);
+	g_assert_cmpint (percentage, ==, 100);
+
+	/* the actions of the workers reach the caller */
+	g_assert (seen);
+
+	/* all the metadata is there */
+	for (i = 0; i < stale->len; i++) {
+		DnfRepo *repo = g_ptr_array_index (stale, i);
+		g_autoptr(DnfState) state_local = dnf_state_new ();
+
+		ret = dnf_repo_check (repo, G_MAXUINT, state_local, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+	g_ptr_array_unref (stale);
+	dnf_state_reset (state_stale);
+	stale = dnf_refresh_get_stale_repos (repos, G_MAXUINT, FALSE, state_stale, &error);
+	g_assert_no_error (error);
+	g_assert (stale != NULL);
+	g_assert_cmpint (stale->len, ==, 0);
+
+	dnf_test_http_free (http);
+	ret = dnf_remove_recursive (tmp_dir, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+}
+
+/* every 10th package is devel, and every 4th needs GTK */
+static void
+dnf_test_filter_load_repo (DnfSack *sack,
+			   const gchar *tmp_dir,
+			   const gchar *name,
+			   guint packages,
+			   gint cost)
+{
+	HyRepo repo;
+	gboolean ret;
+	g_autofree gchar *primary_fn = NULL;
+	g_autofree gchar *repomd_fn = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GString) primary = g_string_new (NULL);
+
+	g_string_append_printf (primary,
+				"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+				"<metadata xmlns=\"http://linux.duke.edu/metadata/common\" "
+				"xmlns:rpm=\"http://linux.duke.edu/metadata/rpm\" "
+				"packages=\"%u\">\n", packages);
+	for (guint i = 0; i < packages; i++) {
+		g_string_append_printf (primary,
+					"<package type=\"rpm\">"
+					"<name>pkg%u%s</name><arch>noarch</arch>"
+					"<version epoch=\"0\" ver=\"1\" rel=\"1\"/>"
+					"<summary>test</summary><description>test</description>"
+					"<location href=\"pkg%u-1-1.noarch.rpm\"/><format>",
+					i, i % 10 == 0 ? "-devel" : "", i);
+		if (i % 4 == 0) {
+			g_string_append (primary,
+					 "<rpm:requires>"
+					 "<rpm:entry name=\"libgtk-3.so.0()(64bit)\"/>"
+					 "</rpm:requires>");
+		}
+		g_string_append (primary, "</format></package>\n");
+	}
+	g_string_append (primary, "</metadata>\n");
+
+	primary_fn = g_strdup_printf ("%s/%s-primary.xml", tmp_dir, name);
+	ret = g_file_set_contents (primary_fn, primary->str, primary->len, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	repomd_fn = g_strdup_printf ("%s/%s-repomd.xml", tmp_dir, name);
+	ret = g_file_set_contents (repomd_fn,
+				   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+				   "<repomd xmlns=\"http://linux.duke.edu/metadata/repo\">"
+				   "<revision>1</revision></repomd>\n",
+				   -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	repo = hy_repo_create (name);
+	hy_repo_set_string (repo, HY_REPO_MD_FN, repomd_fn);
+	hy_repo_set_string (repo, HY_REPO_PRIMARY_FN, primary_fn);
+	hy_repo_set_cost (repo, cost);
+	ret = dnf_sack_load_repo (sack, repo, DNF_SACK_LOAD_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+}
+
+static guint
+dnf_test_filter_count (DnfSack *sack, PkBitfield filters, GPtrArray *pkglist)
+{
+	guint len;
+	g_autoptr(GPtrArray) filtered = NULL;
+
+	g_test_timer_start ();
+	filtered = dnf_package_list_filter (sack, filters, pkglist);
+	len = filtered->len;
+	g_test_message ("filtered %u packages down to %u in %.1f ms",
+			pkglist->len, len, g_test_timer_elapsed () * 1000);
+	return len;
+}
+
+static void
+dnf_test_filter_func (void)
+{
+	gboolean ret;
+	guint unique = DNF_TEST_FILTER_PACKAGES_A;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(DnfSack) sack = dnf_sack_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) filtered = NULL;
+	g_autoptr(GPtrArray) pkglist = NULL;
+	HyQuery query;
+
+	tmp_dir = g_dir_make_tmp ("dnf-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	dnf_sack_set_cachedir (sack, tmp_dir);
+
+	/* the packages in both repos are cheaper from the second */
+	dnf_test_filter_load_repo (sack, tmp_dir, "test-a",
+				   DNF_TEST_FILTER_PACKAGES_A, 1000);
+	dnf_test_filter_load_repo (sack, tmp_dir, "test-b",
+				   DNF_TEST_FILTER_PACKAGES_B, 500);
+	query = hy_query_create (sack);
+	pkglist = hy_query_run (query);
+	hy_query_free (query);
+	g_assert_cmpint (pkglist->len, ==, DNF_TEST_FILTER_PACKAGES_A +
+					  DNF_TEST_FILTER_PACKAGES_B);
+
+	/* only the cheapest copy is shown */
+	filtered = dnf_package_list_filter (sack, pk_bitfield_value (PK_FILTER_ENUM_NONE), pkglist);
+	g_assert_cmpint (filtered->len, ==, unique);
+	for (guint i = 0; i < filtered->len; i++) {
+		DnfPackage *pkg = g_ptr_array_index (filtered, i);
+		guint64 idx = g_ascii_strtoull (dnf_package_get_name (pkg) + 3, NULL, 10);
+		g_assert_cmpstr (dnf_package_get_reponame (pkg), ==,
+				 idx < DNF_TEST_FILTER_PACKAGES_B ? "test-b" : "test-a");
+	}
+
+	/* the first runs look at the requires, the second ones use the bits
+	 * remembered for each solvable */
+	for (guint i = 0; i < 2; i++) {
+		g_assert_cmpint (dnf_test_filter_count (sack,
+							pk_bitfield_value (PK_FILTER_ENUM_NOT_DEVELOPMENT),
+							pkglist), ==, unique - unique / 10);
+		g_assert_cmpint (dnf_test_filter_count (sack,
+							pk_bitfield_value (PK_FILTER_ENUM_GUI),
+							pkglist), ==, unique / 4);
+		g_assert_cmpint (dnf_test_filter_count (sack,
+							pk_bitfield_from_enums (PK_FILTER_ENUM_GUI,
+										PK_FILTER_ENUM_NOT_DEVELOPMENT,
+										-1),
+							pkglist), ==, unique / 4 - unique / 20);
+	}
+
+	ret = dnf_remove_recursive (tmp_dir, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+}
+
+static void
+dnf_test_plan_cache_func (void)
+{
+	DnfPlanCache *cache = dnf_plan_cache_new ();
+	HyGoal goal;
+	HyGoal tmp;
+	g_autoptr(DnfSack) sack = dnf_sack_new ();
+	g_autoptr(DnfSack) sack_other = dnf_sack_new ();
+
+	/* nothing saved */
+	g_assert_null (dnf_plan_cache_take (cache, "1", "install:0", "db1", sack));
+
+	/* reused by the transaction with the same token, and only once */
+	goal = hy_goal_create (sack);
+	dnf_plan_cache_save (cache, "1", "install:0", "db1", goal);
+	g_assert_null (dnf_plan_cache_take (cache, "2", "install:0", "db1", sack));
+	tmp = dnf_plan_cache_take (cache, "1", "install:0", "db1", sack);
+	g_assert (tmp == goal);
+	hy_goal_free (tmp);
+	g_assert_null (dnf_plan_cache_take (cache, "1", "install:0", "db1", sack));
+
+	/* a newer simulation replaces the plan */
+	dnf_plan_cache_save (cache, "1", "install:0", "db1",
+			     hy_goal_create (sack));
+	goal = hy_goal_create (sack);
+	dnf_plan_cache_save (cache, "2", "install:0", "db1", goal);
+	g_assert_null (dnf_plan_cache_take (cache, "1", "install:0", "db1", sack));
+	tmp = dnf_plan_cache_take (cache, "2", "install:0", "db1", sack);
+	g_assert (tmp == goal);
+	hy_goal_free (tmp);
+
+	/* a different request, such as the weak deps setting, drops it */
+	dnf_plan_cache_save (cache, "1", "install:0:weak-deps=1", "db1",
+			     hy_goal_create (sack));
+	g_assert_null (dnf_plan_cache_take (cache, "1", "install:0:weak-deps=0", "db1", sack));
+	g_assert_null (dnf_plan_cache_take (cache, "1", "install:0:weak-deps=1", "db1", sack));
+
+	/* so does a change to the rpmdb */
+	dnf_plan_cache_save (cache, "1", "install:0", "db1",
+			     hy_goal_create (sack));
+	g_assert_null (dnf_plan_cache_take (cache, "1", "install:0", "db2", sack));
+
+	/* or a different sack */
+	dnf_plan_cache_save (cache, "1", "install:0", "db1",
+			     hy_goal_create (sack));
+	g_assert_null (dnf_plan_cache_take (cache, "1", "install:0", "db1", sack_other));
+
+	/* or the sack cache being invalidated */
+	dnf_plan_cache_save (cache, "1", "install:0", "db1",
+			     hy_goal_create (sack));
+	dnf_plan_cache_invalidate (cache, "yum.repos.d changed");
+	g_assert_null (dnf_plan_cache_take (cache, "1", "install:0", "db1", sack));
+
+	/* the plan kept when freeing the cache is freed too */
+	dnf_plan_cache_save (cache, "1", "install:0", "db1",
+			     hy_goal_create (sack));
+	dnf_plan_cache_free (cache);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/dnf/package-list-filter", dnf_test_filter_func);
+	g_test_add_func ("/dnf/plan-cache", dnf_test_plan_cache_func);
+	g_test_add_func ("/dnf/refresh-repos", dnf_test_refresh_repos_func);
+
+	return g_test_run ();
+}
@@ -37,6 +37,7 @@
 #include <libdnf/dnf-db.h>
 #include <libdnf/hy-packageset.h>
 #include <libdnf/hy-query.h>
+#include <libdnf/hy-repo.h>
 #include <libdnf/dnf-version.h>
 #include <libdnf/dnf-sack.h>
 #include <libdnf/hy-util.h>
@@ -45,11 +46,16 @@
 
 #include "dnf-backend-vendor.h"
 #include "dnf-backend.h"
+#include "dnf-plan-cache.h"
+#include "dnf-refresh.h"
 
 typedef struct {
 	DnfSack		*sack;
 	gboolean	 valid;
 	gchar		*key;
+	GPtrArray	*updates;	/* of DnfPackage, or NULL if not solved */
+	DnfGoalActions	 updates_flags;
+	GHashTable	*advisories;	/* of "name;evr;arch":DnfAdvisory */
 } DnfSackCacheItem;
 
 typedef struct {
@@ -57,6 +63,7 @@ typedef struct {
 	DnfContext	*context;
 	GHashTable	*sack_cache;	/* of DnfSackCacheItem */
 	GMutex		 sack_mutex;
+	DnfPlanCache	*plan_cache;
 	GTimer		*repos_timer;
 	gchar		*release_ver;
 } PkBackendDnfPrivate;
@@ -88,6 +95,13 @@ pk_backend_supports_parallelization (PkBackend *backend)
 	return FALSE;
 }
 
+gboolean
+pk_backend_supports_results_cache (PkBackend *backend)
+{
+	/* the rpmdb and yum.repos.d monitors report changes made by other tools */
+	return TRUE;
+}
+
 static void
 pk_backend_sack_cache_invalidate (PkBackend *backend, const gchar *why)
 {
@@ -106,6 +120,9 @@ pk_backend_sack_cache_invalidate (PkBackend *backend, const gchar *why)
 			cache_item->valid = FALSE;
 		}
 	}
+
+	/* the simulations were solved against those sacks */
+	dnf_plan_cache_invalidate (priv->plan_cache, why);
 }
 
 static void
@@ -118,6 +135,11 @@ pk_backend_yum_repos_changed_cb (DnfRepoLoader *repo_loader, PkBackend *backend)
 static void
 dnf_sack_cache_item_free (DnfSackCacheItem *cache_item)
 {
+	/* these point into the sack */
+	if (cache_item->updates != NULL)
+		g_ptr_array_unref (cache_item->updates);
+	if (cache_item->advisories != NULL)
+		g_hash_table_unref (cache_item->advisories);
 	g_object_unref (cache_item->sack);
 	g_free (cache_item->key);
 	g_slice_free (DnfSackCacheItem, cache_item);
@@ -311,6 +333,7 @@ pk_backend_initialize (GKeyFile *conf, PkBackend *backend)
 						  g_str_equal,
 						  g_free,
 						  (GDestroyNotify) dnf_sack_cache_item_free);
+	priv->plan_cache = dnf_plan_cache_new ();
 
 	if (!pk_backend_ensure_default_dnf_context (backend, &error))
 		g_warning ("failed to setup context: %s", error->message);
@@ -327,6 +350,7 @@ pk_backend_destroy (PkBackend *backend)
 	g_timer_destroy (priv->repos_timer);
 	g_mutex_clear (&priv->sack_mutex);
 	g_hash_table_unref (priv->sack_cache);
+	dnf_plan_cache_free (priv->plan_cache);
 	g_free (priv->release_ver);
 	g_free (priv);
 }
@@ -544,16 +568,295 @@ dnf_utils_refresh_repo_appstream (DnfRepo *repo, GError **error)
 	return TRUE;
 }
 
+/*
+ * A snapshot records where the metadata of each repo added to a sack was
+ * found, with the mtime and size of every file and of the rpmdb. When
+ * nothing changed, the next daemon can load the repos straight from the
+ * solv cache without checking the metadata of each one again.
+ */
+#define DNF_SACK_SNAPSHOT_VERSION	1
+
+static const struct {
+	gint		 which;
+	const gchar	*key;
+} dnf_sack_snapshot_files[] = {
+	{ HY_REPO_MD_FN,		"repomd" },
+	{ HY_REPO_PRIMARY_FN,		"primary" },
+	{ HY_REPO_FILELISTS_FN,		"filelists" },
+	{ HY_REPO_UPDATEINFO_FN,	"updateinfo" },
+	{ 0,				NULL }
+};
+
+static gchar *
+dnf_utils_snapshot_filename (DnfContext *context, const gchar *cache_key)
+{
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *checksum = NULL;
+
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, cache_key, -1);
+	basename = g_strdup_printf ("%s.snapshot", checksum);
+	return g_build_filename (dnf_context_get_solv_dir (context), basename, NULL);
+}
+
+static gchar *
+dnf_utils_snapshot_stat (const gchar *filename)
+{
+	GStatBuf buf;
+	if (g_stat (filename, &buf) != 0)
+		return NULL;
+	return g_strdup_printf ("%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT,
+				(gint64) buf.st_mtime,
+				(gint64) buf.st_size);
+}
+
+static gchar *
+dnf_utils_snapshot_stat_rpmdb (DnfContext *context)
+{
+	const gchar *names[] = { "rpmdb.sqlite", "Packages.db", "Packages", NULL };
+
+	for (guint i = 0; names[i] != NULL; i++) {
+		g_autofree gchar *filename = NULL;
+		gchar *tmp;
+
+		filename = g_build_filename (dnf_context_get_install_root (context),
+					     "var", "lib", "rpm", names[i], NULL);
+		tmp = dnf_utils_snapshot_stat (filename);
+		if (tmp != NULL)
+			return tmp;
+	}
+	return g_strdup ("");
+}
+
+/* the same repos dnf_sack_add_repos() adds */
+static gboolean
+dnf_utils_snapshot_repo_is_added (DnfRepo *repo, DnfSackAddFlags flags)
+{
+	if (dnf_repo_get_enabled (repo) == DNF_REPO_ENABLED_NONE)
+		return FALSE;
+	if ((flags & DNF_SACK_ADD_FLAG_UNAVAILABLE) == 0 &&
+	    dnf_repo_get_enabled (repo) == DNF_REPO_ENABLED_METADATA)
+		return FALSE;
+	return TRUE;
+}
+
+static void
+dnf_utils_snapshot_save (PkBackendJob *job,
+			 GPtrArray *repos,
+			 DnfSackAddFlags flags,
+			 const gchar *cache_key)
+{
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *rpmdb = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GKeyFile) snapshot = g_key_file_new ();
+
+	g_key_file_set_integer (snapshot, "snapshot", "Version", DNF_SACK_SNAPSHOT_VERSION);
+	g_key_file_set_string (snapshot, "snapshot", "Key", cache_key);
+	rpmdb = dnf_utils_snapshot_stat_rpmdb (job_data->context);
+	g_key_file_set_string (snapshot, "snapshot", "Rpmdb", rpmdb);
+
+	for (guint i = 0; i < repos->len; i++) {
+		DnfRepo *repo = g_ptr_array_index (repos, i);
+		HyRepo hrepo;
+		const gchar *id = dnf_repo_get_id (repo);
+
+		if (!dnf_utils_snapshot_repo_is_added (repo, flags))
+			continue;
+
+		/* the repo was skipped when adding */
+		hrepo = dnf_repo_get_repo (repo);
+		if (hrepo == NULL)
+			return;
+
+		for (guint j = 0; dnf_sack_snapshot_files[j].key != NULL; j++) {
+			const gchar *fn = hy_repo_get_string (hrepo, dnf_sack_snapshot_files[j].which);
+			g_autofree gchar *key = NULL;
+			g_autofree gchar *tmp = NULL;
+
+			if (fn == NULL)
+				continue;
+			tmp = dnf_utils_snapshot_stat (fn);
+			if (tmp == NULL)
+				return;
+			key = g_strdup_printf ("%sStat", dnf_sack_snapshot_files[j].key);
+			g_key_file_set_string (snapshot, id, dnf_sack_snapshot_files[j].key, fn);
+			g_key_file_set_string (snapshot, id, key, tmp);
+		}
+	}
+
+	filename = dnf_utils_snapshot_filename (job_data->context, cache_key);
+	if (!g_key_file_save_to_file (snapshot, filename, &error))
+		g_warning ("failed to save sack snapshot: %s", error->message);
+}
+
+/* returns FALSE without an error if the snapshot is missing or stale, and
+ * with one if it failed part way, leaving some of the repos in the sack */
+static gboolean
+dnf_utils_snapshot_load (PkBackendJob *job,
+			 DnfSack *sack,
+			 GPtrArray *repos,
+			 DnfSackAddFlags flags,
+			 const gchar *cache_key,
+			 GError **error)
+{
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	gint load_flags = DNF_SACK_LOAD_FLAG_BUILD_CACHE;
+	guint added = 0;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *key = NULL;
+	g_autofree gchar *rpmdb = NULL;
+	g_autofree gchar *rpmdb_snapshot = NULL;
+	g_auto(GStrv) groups = NULL;
+	g_autoptr(GKeyFile) snapshot = g_key_file_new ();
+
+	filename = dnf_utils_snapshot_filename (job_data->context, cache_key);
+	if (!g_key_file_load_from_file (snapshot, filename, G_KEY_FILE_NONE, NULL))
+		return FALSE;
+	if (g_key_file_get_integer (snapshot, "snapshot", "Version", NULL) != DNF_SACK_SNAPSHOT_VERSION)
+		return FALSE;
+	key = g_key_file_get_string (snapshot, "snapshot", "Key", NULL);
+	if (g_strcmp0 (key, cache_key) != 0)
+		return FALSE;
+	rpmdb = dnf_utils_snapshot_stat_rpmdb (job_data->context);
+	rpmdb_snapshot = g_key_file_get_string (snapshot, "snapshot", "Rpmdb", NULL);
+	if (g_strcmp0 (rpmdb, rpmdb_snapshot) != 0) {
+		g_debug ("sack snapshot %s is stale as the rpmdb changed", filename);
+		return FALSE;
+	}
+
+	/* check all the metadata is still the same before touching the sack */
+	for (guint i = 0; i < repos->len; i++) {
+		DnfRepo *repo = g_ptr_array_index (repos, i);
+		const gchar *id = dnf_repo_get_id (repo);
+
+		if (!dnf_utils_snapshot_repo_is_added (repo, flags))
+			continue;
+		if (!g_key_file_has_group (snapshot, id)) {
+			g_debug ("sack snapshot %s is stale as %s was added", filename, id);
+			return FALSE;
+		}
+		for (guint j = 0; dnf_sack_snapshot_files[j].key != NULL; j++) {
+			g_autofree gchar *fn = NULL;
+			g_autofree gchar *stat_key = NULL;
+			g_autofree gchar *tmp = NULL;
+			g_autofree gchar *stat_snapshot = NULL;
+
+			fn = g_key_file_get_string (snapshot, id, dnf_sack_snapshot_files[j].key, NULL);
+			if (fn == NULL)
+				continue;
+			stat_key = g_strdup_printf ("%sStat", dnf_sack_snapshot_files[j].key);
+			stat_snapshot = g_key_file_get_string (snapshot, id, stat_key, NULL);
+			tmp = dnf_utils_snapshot_stat (fn);
+			if (g_strcmp0 (tmp, stat_snapshot) != 0) {
+				g_debug ("sack snapshot %s is stale as %s changed", filename, fn);
+				return FALSE;
+			}
+		}
+		added++;
+	}
+	groups = g_key_file_get_groups (snapshot, NULL);
+	if (added + 1 != g_strv_length (groups)) {
+		g_debug ("sack snapshot %s is stale as a repo was removed", filename);
+		return FALSE;
+	}
+
+	/* load the repos in the same way dnf_sack_add_repo() does */
+	if (flags & DNF_SACK_ADD_FLAG_FILELISTS)
+		load_flags |= DNF_SACK_LOAD_FLAG_USE_FILELISTS;
+	if (flags & DNF_SACK_ADD_FLAG_UPDATEINFO)
+		load_flags |= DNF_SACK_LOAD_FLAG_USE_UPDATEINFO;
+	for (guint i = 0; i < repos->len; i++) {
+		DnfRepo *repo = g_ptr_array_index (repos, i);
+		HyRepo hrepo;
+		const gchar *id = dnf_repo_get_id (repo);
+		gboolean ret;
+
+		if (!dnf_utils_snapshot_repo_is_added (repo, flags))
+			continue;
+		hrepo = hy_repo_create (id);
+		hy_repo_set_cost (hrepo, dnf_repo_get_cost (repo));
+		hy_repo_set_priority (hrepo, dnf_repo_get_priority (repo));
+		for (guint j = 0; dnf_sack_snapshot_files[j].key != NULL; j++) {
+			g_autofree gchar *fn = NULL;
+			fn = g_key_file_get_string (snapshot, id, dnf_sack_snapshot_files[j].key, NULL);
+			if (fn != NULL)
+				hy_repo_set_string (hrepo, dnf_sack_snapshot_files[j].which, fn);
+		}
+
+		/* the sack keeps its own reference */
+		ret = dnf_sack_load_repo (sack, hrepo, load_flags, error);
+		hy_repo_free (hrepo);
+		if (!ret) {
+			g_prefix_error (error, "failed to load %s from snapshot: ", id);
+			g_unlink (filename);
+			return FALSE;
+		}
+	}
+	g_debug ("loaded %u repos from sack snapshot %s", added, filename);
+	return TRUE;
+}
+
+static gchar *
+dnf_utils_real_path (const gchar *path)
+{
+	gchar *real = NULL;
+	char *temp;
+
+	/* don't trust realpath one little bit */
+	if (path == NULL)
+		return NULL;
+
+	/* glibc allocates us a buffer to try and fix some brain damage */
+	temp = realpath (path, NULL);
+	if (temp == NULL)
+		return NULL;
+	real = g_strdup (temp);
+	free (temp);
+	return real;
+}
+
+/* an empty sack with the installed packages */
+static DnfSack *
+dnf_utils_new_sack (PkBackendJob *job, GError **error)
+{
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	g_autofree gchar *install_root = NULL;
+	g_autofree gchar *solv_dir = NULL;
+	g_autoptr(DnfSack) sack = NULL;
+
+	solv_dir = dnf_utils_real_path (dnf_context_get_solv_dir (job_data->context));
+	install_root = dnf_utils_real_path (dnf_context_get_install_root (job_data->context));
+	sack = dnf_sack_new ();
+	dnf_sack_set_cachedir (sack, solv_dir);
+	dnf_sack_set_rootdir (sack, install_root);
+	if (!dnf_sack_setup (sack, DNF_SACK_SETUP_FLAG_MAKE_CACHE_DIR, error)) {
+		g_prefix_error (error, "failed to create sack in %s for %s: ",
+				dnf_context_get_solv_dir (job_data->context),
+				dnf_context_get_install_root (job_data->context));
+		return NULL;
+	}
+
+	/* add installed packages */
+	if (!dnf_sack_load_system_repo (sack, NULL, DNF_SACK_LOAD_FLAG_BUILD_CACHE, error)) {
+		g_prefix_error (error, "Failed to load system repo: ");
+		return NULL;
+	}
+	return g_steal_pointer (&sack);
+}
+
 static gboolean
 dnf_utils_add_remote (PkBackendJob *job,
-		      DnfSack *sack,
+		      DnfSack **sack,
 		      DnfSackAddFlags flags,
+		      const gchar *cache_key,
 		      DnfState *state,
 		      GError **error)
 {
 	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
 	gboolean ret;
 	DnfState *state_local;
+	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) repos = NULL;
 
 	/* set state */
@@ -573,9 +876,26 @@ dnf_utils_add_remote (PkBackendJob *job,
 	if (!dnf_state_done (state, error))
 		return FALSE;
 
+	/* nothing changed since a sack was last created for this key, a
+	 * specific cache age means the metadata has to be checked though */
+	if (pk_backend_job_get_cache_age (job) == G_MAXUINT) {
+		if (dnf_utils_snapshot_load (job, *sack, repos, flags, cache_key, &error_local))
+			return dnf_state_finished (state, error);
+
+		/* the snapshot is gone, start again without it on a sack
+		 * that does not have half of the repos */
+		if (error_local != NULL) {
+			g_warning ("ignoring sack snapshot: %s", error_local->message);
+			g_object_unref (*sack);
+			*sack = dnf_utils_new_sack (job, error);
+			if (*sack == NULL)
+				return FALSE;
+		}
+	}
+
 	/* add each repo */
 	state_local = dnf_state_get_child (state);
-	ret = dnf_sack_add_repos (sack,
+	ret = dnf_sack_add_repos (*sack,
 	                          repos,
 	                          pk_backend_job_get_cache_age (job),
 	                          flags,
@@ -583,6 +903,7 @@ dnf_utils_add_remote (PkBackendJob *job,
 	                          error);
 	if (!ret)
 		return FALSE;
+	dnf_utils_snapshot_save (job, repos, flags, cache_key);
 
 	/* done */
 	if (!dnf_state_done (state, error))
@@ -620,25 +941,6 @@ dnf_utils_create_cache_key (const gchar *release_ver, DnfSackAddFlags flags)
 	return g_string_free (key, FALSE);
 }
 
-static gchar *
-dnf_utils_real_path (const gchar *path)
-{
-	gchar *real = NULL;
-	char *temp;
-
-	/* don't trust realpath one little bit */
-	if (path == NULL)
-		return NULL;
-
-	/* glibc allocates us a buffer to try and fix some brain damage */
-	temp = realpath (path, NULL);
-	if (temp == NULL)
-		return NULL;
-	real = g_strdup (temp);
-	free (temp);
-	return real;
-}
-
 static DnfSack *
 dnf_utils_create_sack_for_filters (PkBackendJob *job,
 				   PkBitfield filters,
@@ -655,7 +957,6 @@ dnf_utils_create_sack_for_filters (PkBackendJob *job,
 	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
 	g_autofree gchar *cache_key = NULL;
 	g_autofree gchar *install_root = NULL;
-	g_autofree gchar *solv_dir = NULL;
 	g_autoptr(DnfSack) sack = NULL;
 
 	/* don't add if we're going to filter out anyway */
@@ -730,25 +1031,10 @@ dnf_utils_create_sack_for_filters (PkBackendJob *job,
 	}
 
 	/* create empty sack */
-	solv_dir = dnf_utils_real_path (dnf_context_get_solv_dir (job_data->context));
 	install_root = dnf_utils_real_path (dnf_context_get_install_root (job_data->context));
-	sack = dnf_sack_new ();
-	dnf_sack_set_cachedir (sack, solv_dir);
-	dnf_sack_set_rootdir (sack, install_root);
-	ret = dnf_sack_setup (sack, DNF_SACK_SETUP_FLAG_MAKE_CACHE_DIR, error);
-	if (!ret) {
-		g_prefix_error (error, "failed to create sack in %s for %s: ",
-				dnf_context_get_solv_dir (job_data->context),
-				dnf_context_get_install_root (job_data->context));
+	sack = dnf_utils_new_sack (job, error);
+	if (sack == NULL)
 		return NULL;
-	}
-
-	/* add installed packages */
-	ret = dnf_sack_load_system_repo (sack, NULL, DNF_SACK_LOAD_FLAG_BUILD_CACHE, error);
-	if (!ret) {
-		g_prefix_error (error, "Failed to load system repo: ");
-		return NULL;
-	}
 
 	/* done */
 	ret = dnf_state_done (state, error);
@@ -758,7 +1044,7 @@ dnf_utils_create_sack_for_filters (PkBackendJob *job,
 	/* add remote packages */
 	if ((flags & DNF_SACK_ADD_FLAG_REMOTE) > 0) {
 		state_local = dnf_state_get_child (state);
-		ret = dnf_utils_add_remote (job, sack, flags,
+		ret = dnf_utils_add_remote (job, &sack, flags, cache_key,
 					    state_local, error);
 		if (!ret)
 			return NULL;
@@ -773,7 +1059,7 @@ dnf_utils_create_sack_for_filters (PkBackendJob *job,
 
 	/* save in cache */
 	g_mutex_lock (&priv->sack_mutex);
-	cache_item = g_slice_new (DnfSackCacheItem);
+	cache_item = g_slice_new0 (DnfSackCacheItem);
 	cache_item->key = g_strdup (cache_key);
 	cache_item->sack = g_object_ref (sack);
 	cache_item->valid = TRUE;
@@ -974,14 +1260,123 @@ pk_backend_dnf_get_advisory (GHashTable *advisories_hash,
 #endif
 }
 
+/* must be called with sack_mutex held */
+static DnfSackCacheItem *
+dnf_utils_find_sack_cache_item (PkBackendDnfPrivate *priv, DnfSack *sack)
+{
+	GHashTableIter iter;
+	DnfSackCacheItem *cache_item;
+
+	g_hash_table_iter_init (&iter, priv->sack_cache);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &cache_item)) {
+		if (cache_item->sack == sack && cache_item->valid)
+			return cache_item;
+	}
+	return NULL;
+}
+
+static GHashTable *
+pk_backend_dnf_get_cached_advisories (PkBackend *backend, DnfSack *sack)
+{
+#ifdef HAVE_HY_QUERY_GET_ADVISORY_PKGS
+	DnfSackCacheItem *cache_item;
+	GHashTable *hash;
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
+
+	g_mutex_lock (&priv->sack_mutex);
+	cache_item = dnf_utils_find_sack_cache_item (priv, sack);
+	if (cache_item != NULL && cache_item->advisories != NULL) {
+		hash = g_hash_table_ref (cache_item->advisories);
+		g_mutex_unlock (&priv->sack_mutex);
+		return hash;
+	}
+	g_mutex_unlock (&priv->sack_mutex);
+
+	hash = pk_backend_dnf_cache_advisories (sack);
+
+	/* the sack may have been invalidated while we were busy */
+	g_mutex_lock (&priv->sack_mutex);
+	cache_item = dnf_utils_find_sack_cache_item (priv, sack);
+	if (cache_item != NULL && cache_item->advisories == NULL)
+		cache_item->advisories = g_hash_table_ref (hash);
+	g_mutex_unlock (&priv->sack_mutex);
+	return hash;
+#else
+	return NULL;
+#endif
+}
+
+static GPtrArray *
+pk_backend_dnf_get_updates (PkBackendJob *job, DnfSack *sack, GError **error)
+{
+	DnfGoalActions flags;
+	DnfSackCacheItem *cache_item;
+	GPtrArray *installs;
+	GPtrArray *pkglist;
+	PkBackend *backend = pk_backend_job_get_backend (job);
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
+
+	/* set up the sack for packages that should only ever be installed, never updated */
+	dnf_sack_set_installonly (sack, dnf_context_get_installonly_pkgs (job_data->context));
+	dnf_sack_set_installonly_limit (sack, dnf_context_get_installonly_limit (job_data->context));
+
+	flags = DNF_ALLOW_UNINSTALL;
+	if (!dnf_context_get_install_weak_deps ())
+		flags |= DNF_IGNORE_WEAK_DEPS;
+
+	/* the sack has already been solved */
+	g_mutex_lock (&priv->sack_mutex);
+	cache_item = dnf_utils_find_sack_cache_item (priv, sack);
+	if (cache_item != NULL &&
+	    cache_item->updates != NULL &&
+	    cache_item->updates_flags == flags) {
+		g_debug ("using cached updates for %s", cache_item->key);
+		pkglist = g_ptr_array_ref (cache_item->updates);
+		g_mutex_unlock (&priv->sack_mutex);
+		return pkglist;
+	}
+	g_mutex_unlock (&priv->sack_mutex);
+
+	job_data->goal = hy_goal_create (sack);
+	if (dnf_utils_force_distupgrade_on_upgrade (sack)) {
+		hy_goal_distupgrade_all (job_data->goal);
+	} else {
+		hy_goal_upgrade_all (job_data->goal);
+	}
+	if (!dnf_goal_depsolve (job_data->goal, flags, error))
+		return NULL;
+
+	/* get packages marked for upgrade */
+	pkglist = hy_goal_list_upgrades (job_data->goal, NULL);
+	/* add any packages marked for install */
+	installs = hy_goal_list_installs (job_data->goal, NULL);
+	if (installs != NULL) {
+		guint i;
+		for (i = 0; i < installs->len; i++)
+			g_ptr_array_add (pkglist, g_object_ref (g_ptr_array_index (installs, i)));
+		g_ptr_array_unref (installs);
+	}
+
+	/* the sack may have been invalidated while we were solving */
+	g_mutex_lock (&priv->sack_mutex);
+	cache_item = dnf_utils_find_sack_cache_item (priv, sack);
+	if (cache_item != NULL) {
+		if (cache_item->updates != NULL)
+			g_ptr_array_unref (cache_item->updates);
+		cache_item->updates = g_ptr_array_ref (pkglist);
+		cache_item->updates_flags = flags;
+	}
+	g_mutex_unlock (&priv->sack_mutex);
+	return pkglist;
+}
+
 static void
 pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 {
 	gboolean ret;
 	DnfDb *db;
 	DnfState *state_local;
-	DnfGoalActions flags;
-	GPtrArray *installs = NULL;
 	GPtrArray *pkglist = NULL;
 	HyQuery query = NULL;
 	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
@@ -1067,37 +1462,11 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 		pkglist = dnf_utils_run_query_with_filters (job, sack, query, filters);
 		break;
 	case PK_ROLE_ENUM_GET_UPDATES:
-		/* set up the sack for packages that should only ever be installed, never updated */
-		dnf_sack_set_installonly (sack, dnf_context_get_installonly_pkgs (job_data->context));
-		dnf_sack_set_installonly_limit (sack, dnf_context_get_installonly_limit (job_data->context));
-
-		job_data->goal = hy_goal_create (sack);
-		if (dnf_utils_force_distupgrade_on_upgrade (sack)) {
-			hy_goal_distupgrade_all (job_data->goal);
-		} else {
-			hy_goal_upgrade_all (job_data->goal);
-		}
-		flags = DNF_ALLOW_UNINSTALL;
-		if (!dnf_context_get_install_weak_deps ())
-			flags |= DNF_IGNORE_WEAK_DEPS;
-		ret = dnf_goal_depsolve (job_data->goal, flags, &error);
-		if (!ret) {
+		pkglist = pk_backend_dnf_get_updates (job, sack, &error);
+		if (pkglist == NULL) {
 			pk_backend_job_error_code (job, error->code, "%s", error->message);
 			goto out;
 		}
-		/* get packages marked for upgrade */
-		pkglist = hy_goal_list_upgrades (job_data->goal, NULL);
-		/* add any packages marked for install */
-		installs = hy_goal_list_installs (job_data->goal, NULL);
-		if (installs != NULL) {
-			guint i;
-			DnfPackage *pkg;
-
-			for (i = 0; i < installs->len; i++) {
-				pkg = g_ptr_array_index (installs, i);
-				g_ptr_array_add (pkglist, g_object_ref (pkg));
-			}
-		}
 		break;
 	default:
 		g_assert_not_reached ();
@@ -1139,7 +1508,10 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 		DnfAdvisory *advisory;
 		DnfAdvisoryKind kind;
 		PkInfoEnum info_enum;
-		g_autoptr(GHashTable) advisories_hash = pk_backend_dnf_cache_advisories (sack);
+		g_autoptr(GHashTable) advisories_hash = NULL;
+
+		/* this is idempotent, so fine to repeat on cached updates */
+		advisories_hash = pk_backend_dnf_get_cached_advisories (pk_backend_job_get_backend (job), sack);
 		for (i = 0; i < pkglist->len; i++) {
 			pkg = g_ptr_array_index (pkglist, i);
 			advisory = pk_backend_dnf_get_advisory (advisories_hash, pkg);
@@ -1156,7 +1528,7 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 		}
 	}
 
-	dnf_emit_package_list_filter (job, filters, pkglist);
+	dnf_emit_package_list_filter (job, sack, filters, pkglist);
 
 	/* done */
 	if (!dnf_state_done (job_data->state, &error)) {
@@ -1164,8 +1536,6 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 		goto out;
 	}
 out:
-	if (installs != NULL)
-		g_ptr_array_unref (installs);
 	if (pkglist != NULL)
 		g_ptr_array_unref (pkglist);
 	if (query != NULL)
@@ -1567,61 +1937,23 @@ pk_backend_refresh_repo (PkBackendJob *job,
                          DnfState *state,
                          GError **error)
 {
-	gboolean ret;
-	gboolean repo_okay;
-	DnfState *state_local;
-	GError *error_local = NULL;
-
 	/* set state */
-	ret = dnf_state_set_steps (state, error,
-				   2, /* check */
-				   98, /* download */
-				   -1);
-	if (!ret)
+	if (!dnf_state_set_steps (state, error,
+				  99, /* check and download */
+				  1, /* appstream */
+				  -1))
 		return FALSE;
 
-	/* is the repo up to date? */
-	state_local = dnf_state_get_child (state);
-	repo_okay = dnf_repo_check (repo,
-	                            pk_backend_job_get_cache_age (job),
-	                            state_local,
-	                            &error_local);
-	if (!repo_okay) {
-		g_debug ("repo %s not okay [%s], refreshing",
-			 dnf_repo_get_id (repo), error_local->message);
-		g_clear_error (&error_local);
-		if (!dnf_state_finished (state_local, error))
-			return FALSE;
-	}
+	if (!dnf_refresh_repo (repo,
+			       pk_backend_job_get_cache_age (job),
+			       dnf_state_get_child (state),
+			       error))
+		return FALSE;
 
 	/* done */
 	if (!dnf_state_done (state, error))
 		return FALSE;
 
-	/* update repo, TODO: if we have network access */
-	if (!repo_okay) {
-		state_local = dnf_state_get_child (state);
-		ret = dnf_repo_update (repo,
-		                       DNF_REPO_UPDATE_FLAG_IMPORT_PUBKEY,
-		                       state_local,
-		                       &error_local);
-		if (!ret) {
-			if (g_error_matches (error_local,
-					     DNF_ERROR,
-					     DNF_ERROR_CANNOT_FETCH_SOURCE)) {
-				g_warning ("Skipping refresh of %s: %s",
-					   dnf_repo_get_id (repo),
-					   error_local->message);
-				g_clear_error (&error_local);
-				if (!dnf_state_finished (state_local, error))
-					return FALSE;
-			} else {
-				g_propagate_error (error, error_local);
-				return FALSE;
-			}
-		}
-	}
-
 	/* copy the appstream files somewhere that the GUI will pick them up */
 	if (!dnf_utils_refresh_repo_appstream (repo, error))
 		return FALSE;
@@ -1630,6 +1962,51 @@ pk_backend_refresh_repo (PkBackendJob *job,
 	return dnf_state_done (state, error);
 }
 
+/* how many repos are downloaded at the same time */
+#define DNF_REFRESH_REPOS_PARALLEL_MAX	4
+
+typedef struct {
+	PkBackendJob	*job;
+	gboolean	 force;
+} DnfRefreshData;
+
+static gboolean
+pk_backend_refresh_repo_cb (DnfRepo *repo,
+			    DnfState *state,
+			    gpointer user_data,
+			    GError **error)
+{
+	DnfRefreshData *data = user_data;
+
+	/* delete content even if up to date */
+	if (data->force) {
+		g_debug ("Deleting contents of %s as forced", dnf_repo_get_id (repo));
+		if (!dnf_repo_clean (repo, error))
+			return FALSE;
+	}
+
+	/* check and download */
+	return pk_backend_refresh_repo (data->job, repo, state, error);
+}
+
+static gboolean
+pk_backend_refresh_repos (PkBackendJob *job,
+			  GPtrArray *repos,
+			  gboolean force,
+			  DnfState *state,
+			  GError **error)
+{
+	DnfRefreshData data = { job, force };
+
+	return dnf_refresh_repos (repos,
+				  DNF_REFRESH_REPOS_PARALLEL_MAX,
+				  pk_backend_refresh_repo_cb,
+				  &data,
+				  pk_backend_job_get_cancellable (job),
+				  state,
+				  error);
+}
+
 static void
 pk_backend_refresh_subman (PkBackendJob *job)
 {
@@ -1662,13 +2039,9 @@ pk_backend_refresh_cache_thread (PkBackendJob *job,
 {
 	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
 	PkBackend *backend = pk_backend_job_get_backend (job);
-	DnfRepo *repo;
 	DnfState *state_local;
-	DnfState *state_loop;
 	gboolean force;
 	gboolean ret;
-	guint cnt = 0;
-	guint i;
 	g_autoptr(DnfSack) sack = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) refresh_repos = NULL;
@@ -1695,49 +2068,16 @@ pk_backend_refresh_cache_thread (PkBackendJob *job,
 		return;
 	}
 
-	/* count the enabled repos */
-	for (i = 0; i < repos->len; i++) {
-		repo = g_ptr_array_index (repos, i);
-		if (dnf_repo_get_enabled (repo) == DNF_REPO_ENABLED_NONE)
-			continue;
-		if (dnf_repo_get_kind (repo) == DNF_REPO_KIND_MEDIA)
-			continue;
-		if (dnf_repo_get_kind (repo) == DNF_REPO_KIND_LOCAL)
-			continue;
-		cnt++;
-	}
-
 	/* figure out which repos need refreshing */
-	refresh_repos = g_ptr_array_new ();
 	state_local = dnf_state_get_child (job_data->state);
-	dnf_state_set_number_steps (state_local, cnt);
-	for (i = 0; i < repos->len; i++) {
-		gboolean repo_okay;
-
-		repo = g_ptr_array_index (repos, i);
-		if (dnf_repo_get_enabled (repo) == DNF_REPO_ENABLED_NONE)
-			continue;
-		if (dnf_repo_get_kind (repo) == DNF_REPO_KIND_MEDIA)
-			continue;
-		if (dnf_repo_get_kind (repo) == DNF_REPO_KIND_LOCAL)
-			continue;
-
-		/* is the repo up to date? */
-		state_loop = dnf_state_get_child (state_local);
-		repo_okay = dnf_repo_check (repo,
-		                            pk_backend_job_get_cache_age (job),
-		                            state_loop,
-		                            NULL);
-		if (!repo_okay || force)
-			g_ptr_array_add (refresh_repos,
-			                 g_ptr_array_index (repos, i));
-
-		/* done */
-		ret = dnf_state_done (state_local, &error);
-		if (!ret) {
-			pk_backend_job_error_code (job, error->code, "%s", error->message);
-			return;
-		}
+	refresh_repos = dnf_refresh_get_stale_repos (repos,
+						     pk_backend_job_get_cache_age (job),
+						     force,
+						     state_local,
+						     &error);
+	if (refresh_repos == NULL) {
+		pk_backend_job_error_code (job, error->code, "%s", error->message);
+		return;
 	}
 
 	/* done */
@@ -1754,36 +2094,11 @@ pk_backend_refresh_cache_thread (PkBackendJob *job,
 		return;
 	}
 
-	/* refresh each repo */
+	/* refresh the repos in parallel */
 	state_local = dnf_state_get_child (job_data->state);
-	dnf_state_set_number_steps (state_local, refresh_repos->len);
-	for (i = 0; i < refresh_repos->len; i++) {
-		repo = g_ptr_array_index (refresh_repos, i);
-
-		/* delete content even if up to date */
-		if (force) {
-			g_debug ("Deleting contents of %s as forced", dnf_repo_get_id (repo));
-			ret = dnf_repo_clean (repo, &error);
-			if (!ret) {
-				pk_backend_job_error_code (job, error->code, "%s", error->message);
-				return;
-			}
-		}
-
-		/* check and download */
-		state_loop = dnf_state_get_child (state_local);
-		ret = pk_backend_refresh_repo (job, repo, state_loop, &error);
-		if (!ret) {
-			pk_backend_job_error_code (job, error->code, "%s", error->message);
-			return;
-		}
-
-		/* done */
-		ret = dnf_state_done (state_local, &error);
-		if (!ret) {
-			pk_backend_job_error_code (job, error->code, "%s", error->message);
-			return;
-		}
+	if (!pk_backend_refresh_repos (job, refresh_repos, force, state_local, &error)) {
+		pk_backend_job_error_code (job, error->code, "%s", error->message);
+		return;
 	}
 
 	/* done */
@@ -1831,6 +2146,89 @@ pk_backend_refresh_cache (PkBackend *backend,
 	pk_backend_job_thread_create (job, pk_backend_refresh_cache_thread, NULL, NULL);
 }
 
+/*
+ * Every package in a sack by name;evr;arch;reponame, and the installed ones
+ * by name;arch, so resolving a package-id does not need a query each time.
+ * It is built on first use and rebuilt if packages were added to the sack.
+ */
+#define PK_DNF_SACK_INDEX_KEY		"pk-dnf-sack-index"
+
+typedef struct {
+	gint		 count;
+	GHashTable	*ids;		/* of GPtrArray of solvable Ids */
+	GHashTable	*installed;	/* of "name;arch" */
+} DnfSackIndex;
+
+static GMutex dnf_sack_index_mutex;
+
+static void
+dnf_sack_index_free (DnfSackIndex *sack_index)
+{
+	g_hash_table_unref (sack_index->ids);
+	g_hash_table_unref (sack_index->installed);
+	g_slice_free (DnfSackIndex, sack_index);
+}
+
+static gchar *
+dnf_sack_index_key (const gchar *name,
+		    const gchar *evr,
+		    const gchar *arch,
+		    const gchar *reponame)
+{
+	return g_strdup_printf ("%s;%s;%s;%s", name, evr, arch, reponame);
+}
+
+/* must be called with dnf_sack_index_mutex held */
+static DnfSackIndex *
+dnf_sack_index_ensure (DnfSack *sack)
+{
+	DnfSackIndex *sack_index;
+	HyQuery query;
+	guint i;
+	g_autoptr(GPtrArray) pkglist = NULL;
+
+	sack_index = g_object_get_data (G_OBJECT (sack), PK_DNF_SACK_INDEX_KEY);
+	if (sack_index != NULL && sack_index->count == dnf_sack_count (sack))
+		return sack_index;
+
+	sack_index = g_slice_new0 (DnfSackIndex);
+	sack_index->count = dnf_sack_count (sack);
+	sack_index->ids = g_hash_table_new_full (g_str_hash, g_str_equal,
+						 g_free, (GDestroyNotify) g_ptr_array_unref);
+	sack_index->installed = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, NULL);
+	query = hy_query_create (sack);
+	pkglist = hy_query_run (query);
+	hy_query_free (query);
+	for (i = 0; i < pkglist->len; i++) {
+		DnfPackage *pkg = g_ptr_array_index (pkglist, i);
+		GPtrArray *matches;
+		g_autofree gchar *key = NULL;
+
+		key = dnf_sack_index_key (dnf_package_get_name (pkg),
+					  dnf_package_get_evr (pkg),
+					  dnf_package_get_arch (pkg),
+					  dnf_package_get_reponame (pkg));
+		matches = g_hash_table_lookup (sack_index->ids, key);
+		if (matches == NULL) {
+			matches = g_ptr_array_new ();
+			g_hash_table_insert (sack_index->ids, g_steal_pointer (&key), matches);
+		}
+		g_ptr_array_add (matches, GUINT_TO_POINTER (dnf_package_get_id (pkg)));
+
+		if (dnf_package_installed (pkg)) {
+			g_hash_table_add (sack_index->installed,
+					  g_strdup_printf ("%s;%s",
+							   dnf_package_get_name (pkg),
+							   dnf_package_get_arch (pkg)));
+		}
+	}
+	g_debug ("indexed %u packages", pkglist->len);
+	g_object_set_data_full (G_OBJECT (sack), PK_DNF_SACK_INDEX_KEY, sack_index,
+				(GDestroyNotify) dnf_sack_index_free);
+	return sack_index;
+}
+
 /**
  * dnf_utils_find_package_ids:
  *
@@ -1848,65 +2246,62 @@ dnf_utils_find_package_ids (DnfSack *sack, gchar **package_ids, GError **error)
 	gboolean ret = TRUE;
 	GHashTable *hash;
 	guint i;
-	GPtrArray *pkglist = NULL;
+	GPtrArray *matches;
 	DnfPackage *pkg;
-	HyQuery query = NULL;
+	DnfSackIndex *sack_index;
 
-	/* run query */
 	hash = g_hash_table_new_full (g_str_hash, g_str_equal,
 				      g_free, (GDestroyNotify) g_object_unref);
-	query = hy_query_create (sack);
+	g_mutex_lock (&dnf_sack_index_mutex);
+	sack_index = dnf_sack_index_ensure (sack);
 	for (i = 0; package_ids[i] != NULL; i++) {
+		g_autofree gchar *key = NULL;
 		g_auto(GStrv) split = NULL;
-		hy_query_clear (query);
 		split = pk_package_id_split (package_ids[i]);
+		if (split == NULL)
+			continue;
 		reponame = split[PK_PACKAGE_ID_DATA];
 		if (g_strcmp0 (reponame, "installed") == 0 ||
 		    g_str_has_prefix (reponame, "installed:"))
 			reponame = HY_SYSTEM_REPO_NAME;
 		else if (g_strcmp0 (reponame, "local") == 0)
 			reponame = HY_CMDLINE_REPO_NAME;
-		hy_query_filter (query, HY_PKG_NAME, HY_EQ, split[PK_PACKAGE_ID_NAME]);
-		hy_query_filter (query, HY_PKG_EVR, HY_EQ, split[PK_PACKAGE_ID_VERSION]);
-		hy_query_filter (query, HY_PKG_ARCH, HY_EQ, split[PK_PACKAGE_ID_ARCH]);
-		hy_query_filter (query, HY_PKG_REPONAME, HY_EQ, reponame);
-		pkglist = hy_query_run (query);
+		key = dnf_sack_index_key (split[PK_PACKAGE_ID_NAME],
+					  split[PK_PACKAGE_ID_VERSION],
+					  split[PK_PACKAGE_ID_ARCH],
+					  reponame);
+		matches = g_hash_table_lookup (sack_index->ids, key);
 
 		/* no matches */
-		if (pkglist->len == 0) {
-			g_ptr_array_unref (pkglist);
+		if (matches == NULL)
 			continue;
-		}
 
 		/* multiple matches */
-		if (pkglist->len > 1) {
+		if (matches->len > 1) {
 			ret = FALSE;
 			g_set_error (error,
 				     DNF_ERROR,
 				     PK_ERROR_ENUM_PACKAGE_CONFLICTS,
 				     "Multiple matches of %s", package_ids[i]);
-			for (i = 0; i < pkglist->len; i++) {
-				pkg = g_ptr_array_index (pkglist, i);
+			for (i = 0; i < matches->len; i++) {
+				pkg = dnf_package_new (sack, GPOINTER_TO_UINT (g_ptr_array_index (matches, i)));
 				g_debug ("possible matches: %s",
 					 dnf_package_get_package_id (pkg));
+				g_object_unref (pkg);
 			}
 			goto out;
 		}
 
 		/* add to results */
-		pkg = g_ptr_array_index (pkglist, 0);
-		g_hash_table_insert (hash,
-				     g_strdup (package_ids[i]),
-				     g_object_ref (pkg));
-		g_ptr_array_unref (pkglist);
+		pkg = dnf_package_new (sack, GPOINTER_TO_UINT (g_ptr_array_index (matches, 0)));
+		g_hash_table_insert (hash, g_strdup (package_ids[i]), pkg);
 	}
 out:
+	g_mutex_unlock (&dnf_sack_index_mutex);
 	if (!ret && hash != NULL) {
 		g_hash_table_unref (hash);
 		hash = NULL;
 	}
-	if (query != NULL)
-		hy_query_free (query);
 	return hash;
 }
 
@@ -2593,6 +2988,73 @@ pk_backend_get_download_rpms (HyGoal goal)
 	return g_steal_pointer (&download_rpms);
 }
 
+/* describes everything that went into the goal apart from the sack */
+static gchar *
+pk_backend_simulate_plan_request (PkBackendJob *job)
+{
+	GVariant *params = pk_backend_job_get_parameters (job);
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	PkBitfield flags = job_data->transaction_flags;
+	GString *str = g_string_new (pk_role_enum_to_string (pk_backend_job_get_role (job)));
+
+	/* the flags are the first parameter, and are compared on their own */
+	pk_bitfield_remove (flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE);
+	pk_bitfield_remove (flags, PK_TRANSACTION_FLAG_ENUM_ONLY_DOWNLOAD);
+	g_string_append_printf (str, ":%" G_GUINT64_FORMAT, flags);
+	for (gsize i = 1; params != NULL && i < g_variant_n_children (params); i++) {
+		g_autoptr(GVariant) child = g_variant_get_child_value (params, i);
+		g_autofree gchar *tmp = g_variant_print (child, FALSE);
+		g_string_append_printf (str, ":%s", tmp);
+	}
+
+	/* the goal is solved with DNF_IGNORE_WEAK_DEPS when this is unset */
+	g_string_append_printf (str, ":weak-deps=%i",
+				dnf_context_get_install_weak_deps ());
+	return g_string_free (str, FALSE);
+}
+
+/* keeps the goal of a successful simulation, taking it from the job */
+static void
+pk_backend_simulate_plan_save (PkBackendJob *job)
+{
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (job_data->backend);
+	const gchar *token = pk_backend_job_get_plan_token (job);
+	g_autofree gchar *request = NULL;
+	g_autofree gchar *rpmdb = NULL;
+
+	if (token == NULL)
+		return;
+	request = pk_backend_simulate_plan_request (job);
+	rpmdb = dnf_utils_snapshot_stat_rpmdb (job_data->context);
+	dnf_plan_cache_save (priv->plan_cache, token, request, rpmdb,
+			     g_steal_pointer (&job_data->goal));
+}
+
+/* swaps in the goal of the simulation, if nothing changed since */
+static gboolean
+pk_backend_simulate_plan_take (PkBackendJob *job)
+{
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (job_data->backend);
+	const gchar *token = pk_backend_job_get_plan_token (job);
+	g_autofree gchar *request = NULL;
+	g_autofree gchar *rpmdb = NULL;
+	HyGoal goal;
+
+	if (token == NULL)
+		return FALSE;
+	request = pk_backend_simulate_plan_request (job);
+	rpmdb = dnf_utils_snapshot_stat_rpmdb (job_data->context);
+	goal = dnf_plan_cache_take (priv->plan_cache, token, request, rpmdb,
+				    hy_goal_get_sack (job_data->goal));
+	if (goal == NULL)
+		return FALSE;
+	hy_goal_free (job_data->goal);
+	job_data->goal = goal;
+	return TRUE;
+}
+
 static gboolean
 pk_backend_transaction_run (PkBackendJob *job,
 			    DnfState *state,
@@ -2633,9 +3095,11 @@ pk_backend_transaction_run (PkBackendJob *job,
 	dnf_transaction_set_dont_solve_goal (job_data->transaction, TRUE);
 	if (!dnf_context_get_install_weak_deps ())
 		dnf_flags |= DNF_IGNORE_WEAK_DEPS;
-	ret = dnf_goal_depsolve (job_data->goal, dnf_flags, error);
-	if (!ret)
-		return FALSE;
+	if (!pk_backend_simulate_plan_take (job)) {
+		ret = dnf_goal_depsolve (job_data->goal, dnf_flags, error);
+		if (!ret)
+			return FALSE;
+	}
 
 	ret = dnf_transaction_depsolve (job_data->transaction,
 					job_data->goal,
@@ -2657,6 +3121,7 @@ pk_backend_transaction_run (PkBackendJob *job,
 						       error);
 		if (!ret)
 			return FALSE;
+		pk_backend_simulate_plan_save (job);
 		return dnf_state_done (state, error);
 	}
 
@@ -2889,23 +3354,18 @@ static gboolean
 dnf_is_installed_package_id_name_arch (DnfSack *sack, const gchar *package_id)
 {
 	gboolean ret;
-	GPtrArray *pkglist = NULL;
-	HyQuery query = NULL;
+	g_autofree gchar *key = NULL;
 	g_auto(GStrv) split = NULL;
 
-	/* run query */
-	query = hy_query_create (sack);
 	split = pk_package_id_split (package_id);
-	hy_query_filter (query, HY_PKG_NAME, HY_EQ, split[PK_PACKAGE_ID_NAME]);
-	hy_query_filter (query, HY_PKG_ARCH, HY_EQ, split[PK_PACKAGE_ID_ARCH]);
-	hy_query_filter (query, HY_PKG_REPONAME, HY_EQ, HY_SYSTEM_REPO_NAME);
-	pkglist = hy_query_run (query);
-
-	/* any matches? */
-	ret = pkglist->len > 0;
-
-	g_ptr_array_unref (pkglist);
-	hy_query_free (query);
+	if (split == NULL)
+		return FALSE;
+	key = g_strdup_printf ("%s;%s",
+			       split[PK_PACKAGE_ID_NAME],
+			       split[PK_PACKAGE_ID_ARCH]);
+	g_mutex_lock (&dnf_sack_index_mutex);
+	ret = g_hash_table_contains (dnf_sack_index_ensure (sack)->installed, key);
+	g_mutex_unlock (&dnf_sack_index_mutex);
 	return ret;
 }
 
@@ -3791,7 +4251,7 @@ pk_backend_get_update_detail_thread (PkBackendJob *job, GVariant *params, gpoint
 		return;
 	}
 
-	advisories_hash = pk_backend_dnf_cache_advisories (sack);
+	advisories_hash = pk_backend_dnf_get_cached_advisories (pk_backend_job_get_backend (job), sack);
 
 	/* emit details for each */
 	for (i = 0; package_ids[i] != NULL; i++) {
@@ -885,6 +885,9 @@ class PackageKitEntropyBackend(PackageKitBaseBackend, PackageKitEntropyMixin):
 
     _log_fname = os.path.join(etpConst['syslogdir'], "packagekit.log")
 
+    # all the library output goes to the log
+    framed_output = True
+
     # Entropy <-> PackageKit groups map
     GROUP_MAP = {
         'accessibility': GROUP_ACCESSIBILITY,
@@ -802,6 +802,9 @@ class PackageKitPortageBackend(PackageKitPortageMixin, PackageKitBaseBackend):
         'unknown': GROUP_UNKNOWN,
     }
 
+    # portage output is blocked while it runs
+    framed_output = True
+
     def __sigquit(self, signum, frame):
         raise SystemExit(1)
 
@@ -35,6 +35,8 @@
 #include <string>
 #include <sys/vfs.h>
 #include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <glib.h>
@@ -46,6 +48,7 @@
 #include <packagekit-glib2/packagekit.h>
 #include <packagekit-glib2/pk-enum.h>
 
+#include <zypp/Date.h>
 #include <zypp/Digest.h>
 #include <zypp/KeyRing.h>
 #include <zypp/Package.h>
@@ -109,6 +112,19 @@ typedef enum {
         EQUAL_VERSION
 } VersionRelation;
 
+/**
+ * Holds the zypp lock for the lifetime of a job.
+ *
+ * Every job has zypp to itself, even the ones that only query. Reading
+ * the pool still changes it: building an IdString or Capability from a
+ * user string adds it to the string pool, and PoolQuery and
+ * sat::Pool::prepare() use shared scratch space and rebuild the
+ * whatprovides index lazily. Downloading metadata does not touch the
+ * pool, but the zypp report receivers are process wide and the
+ * EventDirector sends them to one job, so a refresh that dropped the
+ * lock while downloading would report its progress, key and media
+ * requests to whichever job took the lock next.
+ */
 class ZyppJob {
  public:
 	ZyppJob(PkBackendJob *job);
@@ -1153,6 +1169,41 @@ zypp_backend_package (PkBackendJob *job, PkInfoEnum info,
 	g_free (id);
 }
 
+/*
+ * What sameNVRA() compares, plus whether it is a source package, as pool ids
+ * so installed and available solvables can be matched with a hash lookup.
+ */
+struct ZyppNVRAKey {
+	sat::detail::IdType ident;
+	sat::detail::IdType edition;
+	sat::detail::IdType arch;
+	bool source;
+
+	ZyppNVRAKey (const sat::Solvable &item) :
+		ident (item.ident ().id ()),
+		edition (item.edition ().id ()),
+		arch (item.arch ().idStr ().id ()),
+		source (isKind<SrcPackage>(item)) {}
+
+	bool operator== (const ZyppNVRAKey &other) const
+	{
+		return ident == other.ident &&
+			edition == other.edition &&
+			arch == other.arch &&
+			source == other.source;
+	}
+};
+
+struct ZyppNVRAKeyHash {
+	size_t operator() (const ZyppNVRAKey &key) const
+	{
+		size_t hash = key.ident;
+		hash = hash * 31 + key.edition;
+		hash = hash * 31 + key.arch;
+		return hash * 2 + key.source;
+	}
+};
+
 /*
  * Emit signals for the packages, -but- if we have an installed package
  * we don't notify the client that the package is also available, since
@@ -1163,37 +1214,42 @@ zypp_emit_filtered_packages_in_list (PkBackendJob *job, PkBitfield filters, cons
 {
 	typedef vector<sat::Solvable>::const_iterator sat_it_t;
 
-	vector<sat::Solvable> installed;
+	// the filters look at the provides and the file system, so only
+	// check each solvable once even if it is in the list many times
+	unordered_map<sat::detail::IdType, bool> filtered;
+	unordered_set<ZyppNVRAKey, ZyppNVRAKeyHash> installed;
+	vector<bool> emit (v.size (), false);
+	size_t idx = 0;
+
+	for (sat_it_t it = v.begin (); it != v.end (); ++it, ++idx) {
+		auto cached = filtered.find (it->id ());
+		if (cached == filtered.end ())
+			cached = filtered.emplace (it->id (), zypp_filter_solvable (filters, *it)).first;
+		if (cached->second)
+			continue;
+		emit[idx] = true;
+		if (it->isSystem ())
+			installed.insert (ZyppNVRAKey (*it));
+	}
 
 	// always emit system installed packages first
-	for (sat_it_t it = v.begin (); it != v.end (); ++it) {
-		if (!it->isSystem() ||
-		    zypp_filter_solvable (filters, *it))
+	idx = 0;
+	for (sat_it_t it = v.begin (); it != v.end (); ++it, ++idx) {
+		if (!emit[idx] || !it->isSystem ())
 			continue;
-
 		zypp_backend_package (job, PK_INFO_ENUM_INSTALLED, *it,
 				      make<ResObject>(*it)->summary().c_str());
-		installed.push_back (*it);
 	}
 
 	// then available packages later
-	for (sat_it_t it = v.begin (); it != v.end (); ++it) {
-		gboolean match;
-
-		if (it->isSystem() ||
-		    zypp_filter_solvable (filters, *it))
+	idx = 0;
+	for (sat_it_t it = v.begin (); it != v.end (); ++it, ++idx) {
+		if (!emit[idx] || it->isSystem ())
 			continue;
-
-		match = FALSE;
-		for (sat_it_t i = installed.begin (); !match && i != installed.end (); i++) {
-			match = it->sameNVRA (*i) &&
-				!(!isKind<SrcPackage>(*it) ^
-				  !isKind<SrcPackage>(*i));
-		}
-		if (!match) {
-			zypp_backend_package (job, PK_INFO_ENUM_AVAILABLE, *it,
-					      make<ResObject>(*it)->summary().c_str());
-		}
+		if (installed.find (ZyppNVRAKey (*it)) != installed.end ())
+			continue;
+		zypp_backend_package (job, PK_INFO_ENUM_AVAILABLE, *it,
+				      make<ResObject>(*it)->summary().c_str());
 	}
 }
 
@@ -1645,6 +1701,38 @@ zypp_build_package_id_capabilities (Capabilities caps, gboolean terminate = TRUE
 	return package_ids;
 }
 
+/**
+  * are all the enabled repositories loaded and no older than the cache age
+  * the job asked for, so there is no need to refresh them
+  */
+static gboolean
+zypp_repos_within_cache_age (PkBackendJob *job)
+{
+	guint cache_age = pk_backend_job_get_cache_age (job);
+
+	if (cache_age == 0 || sat::Pool::instance ().reposEmpty ())
+		return FALSE;
+
+	try {
+		RepoManager manager;
+		Date now = Date::now ();
+
+		for (RepoManager::RepoConstIterator it = manager.repoBegin (); it != manager.repoEnd (); ++it) {
+			if (!it->enabled () || !it->autorefresh ())
+				continue;
+			if (sat::Pool::instance ().reposFind (it->alias ()) == Repository::noRepository)
+				return FALSE;
+			if (cache_age == G_MAXUINT)
+				continue;
+			if (now - manager.metadataStatus (*it).timestamp () > (Date::ValueType) cache_age)
+				return FALSE;
+		}
+	} catch (const Exception &ex) {
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /**
   * refresh the enabled repositories
   */
@@ -1798,7 +1886,8 @@ zypp_backend_finished_error (PkBackendJob  *job, PkErrorEnum err_code,
 
 
 /**
- * We do not pretend we're thread safe when all we do is having a huge mutex
+ * We do not pretend we're thread safe when all we do is having a huge mutex,
+ * see ZyppJob for why the queries cannot share it
  */
 gboolean
 pk_backend_supports_parallelization (PkBackend *backend)
@@ -3079,7 +3168,6 @@ static void
 backend_find_packages_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 {
 	MIL << endl;
-	const gchar *search;
 	PkRoleEnum role;
 
 	PkBitfield _filters;
@@ -3088,7 +3176,7 @@ backend_find_packages_thread (PkBackendJob *job, GVariant *params, gpointer user
 		&_filters,
 		&values);
 
-	if (values == NULL && values[0] == NULL) {
+	if (values == NULL || values[0] == NULL) {
 		pk_backend_job_error_code (job, PK_ERROR_ENUM_PACKAGE_ID_INVALID,
 					   "Empty search string is not supported.");
 		return;
@@ -3101,12 +3189,15 @@ backend_find_packages_thread (PkBackendJob *job, GVariant *params, gpointer user
 		return;
 	}
 
-	// refresh the repos before searching
-	if (!zypp_refresh_cache (job, zypp, FALSE)) {
+	// refresh the repos before searching, unless they are recent enough
+	if (zypp_repos_within_cache_age (job)) {
+		Target_Ptr target = zypp->getTarget ();
+		if (target)
+			target->load ();
+	} else if (!zypp_refresh_cache (job, zypp, FALSE)) {
 		return;
 	}
 
-	search = values[0];  //Fixme - support the possible multiple values (logical OR search)
 	role = pk_backend_job_get_role(job);
 
 	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
@@ -3114,8 +3205,10 @@ backend_find_packages_thread (PkBackendJob *job, GVariant *params, gpointer user
 
 	vector<sat::Solvable> v;
 
+	// all the terms are OR'ed, and each solvable is only returned once
 	PoolQuery q;
-	q.addString( search ); // may be called multiple times (OR'ed)
+	for (guint i = 0; values[i] != NULL; i++)
+		q.addString( values[i] );
 	q.setCaseSensitive( false ); // [<>] We want to be case insensitive for the name and description searches...
 	q.setMatchSubstring();
 
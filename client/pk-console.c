@@ -834,13 +834,48 @@ out:
 }
 
 static gchar *
-pk_console_resolve_package (PkConsoleCtx *ctx, const gchar *package_name, GError **error)
+pk_console_choose_package (GPtrArray *array, GError **error)
 {
 	const gchar *package_id_tmp;
-	gchar *package_id = NULL;
-	gboolean valid;
 	guint i;
 	PkPackage *package;
+
+	/* just one thing found */
+	if (array->len == 1) {
+		package = g_ptr_array_index (array, 0);
+		return g_strdup (pk_package_get_id (package));
+	}
+
+	/* TRANSLATORS: more than one package could be found that matched,
+	 * to follow is a list of possible packages  */
+	g_print ("%s\n", _("More than one package matches:"));
+	for (i = 0; i < array->len; i++) {
+		g_autofree gchar *printable = NULL;
+		g_auto(GStrv) split = NULL;
+		package = g_ptr_array_index (array, i);
+		package_id_tmp = pk_package_get_id (package);
+		split = pk_package_id_split (package_id_tmp);
+		printable = pk_package_id_to_printable (package_id_tmp);
+		g_print ("%i. %s [%s]\n", i+1, printable, split[PK_PACKAGE_ID_DATA]);
+	}
+
+	/* TRANSLATORS: This finds out which package in the list to use */
+	i = pk_console_get_number (_("Please choose the correct package: "), array->len);
+	if (i == 0) {
+		g_set_error_literal (error,
+				     PK_CONSOLE_ERROR,
+				     PK_ERROR_ENUM_TRANSACTION_CANCELLED,
+				     "User aborted selection");
+		return NULL;
+	}
+	package = g_ptr_array_index (array, i - 1);
+	return g_strdup (pk_package_get_id (package));
+}
+
+static gchar *
+pk_console_resolve_package (PkConsoleCtx *ctx, const gchar *package_name, GError **error)
+{
+	gboolean valid;
 	g_autoptr(GPtrArray) array = NULL;
 	g_autoptr(PkError) error_code = NULL;
 	g_autoptr(PkResults) results = NULL;
@@ -882,40 +917,32 @@ pk_console_resolve_package (PkConsoleCtx *ctx, const gchar *package_name, GError
 			     "could not find %s", package_name);
 		return NULL;
 	}
+	return pk_console_choose_package (array, error);
+}
 
-	/* just one thing found */
-	if (array->len == 1) {
-		package = g_ptr_array_index (array, 0);
-		g_object_get (package,
-			      "package-id", &package_id,
-			      NULL);
-		return g_strdup (pk_package_get_id (package));
-	}
+/* resolves all the plain package names in one transaction */
+static GHashTable *
+pk_console_resolve_names (PkConsoleCtx *ctx, gchar **packages, GError **error)
+{
+	guint i;
+	g_autoptr(GPtrArray) names = g_ptr_array_new ();
 
-	/* TRANSLATORS: more than one package could be found that matched,
-	 * to follow is a list of possible packages  */
-	g_print ("%s\n", _("More than one package matches:"));
-	for (i = 0; i < array->len; i++) {
-		g_autofree gchar *printable = NULL;
-		g_auto(GStrv) split = NULL;
-		package = g_ptr_array_index (array, i);
-		package_id_tmp = pk_package_get_id (package);
-		split = pk_package_id_split (package_id_tmp);
-		printable = pk_package_id_to_printable (package_id_tmp);
-		g_print ("%i. %s [%s]\n", i+1, printable, split[PK_PACKAGE_ID_DATA]);
+	for (i = 0; packages[i] != NULL; i++) {
+		if (pk_package_id_check (packages[i]))
+			continue;
+		if (g_strstr_len (packages[i], -1, ",") != NULL)
+			continue;
+		g_ptr_array_add (names, packages[i]);
 	}
-
-	/* TRANSLATORS: This finds out which package in the list to use */
-	i = pk_console_get_number (_("Please choose the correct package: "), array->len);
-	if (i == 0) {
-		g_set_error_literal (error,
-				     PK_CONSOLE_ERROR,
-				     PK_ERROR_ENUM_TRANSACTION_CANCELLED,
-				     "User aborted selection");
+	if (names->len < 2)
 		return NULL;
-	}
-	package = g_ptr_array_index (array, i - 1);
-	return g_strdup (pk_package_get_id (package));
+	g_ptr_array_add (names, NULL);
+	return pk_task_resolve_names_sync (PK_TASK (ctx->task),
+					   ctx->filters,
+					   (gchar **) names->pdata,
+					   ctx->cancellable,
+					   pk_console_progress_cb, ctx,
+					   error);
 }
 
 static gchar **
@@ -925,18 +952,41 @@ pk_console_resolve_packages (PkConsoleCtx *ctx, gchar **packages, GError **error
 	guint len;
 	gchar *package_id;
 	GError *error_local = NULL;
+	g_autoptr(GHashTable) resolved = NULL;
 	g_autoptr(GPtrArray) array = NULL;
 
 	/* get length */
 	len = g_strv_length (packages);
 	g_debug ("resolving %i packages", len);
 
+	/* try to resolve all the names at once */
+	resolved = pk_console_resolve_names (ctx, packages, &error_local);
+	if (error_local != NULL) {
+		if (g_cancellable_is_cancelled (ctx->cancellable)) {
+			g_propagate_error (error, error_local);
+			return NULL;
+		}
+		g_debug ("falling back to resolving each package: %s",
+			 error_local->message);
+		g_clear_error (&error_local);
+	}
+
 	/* resolve each package */
 	array = g_ptr_array_new ();
 	for (i = 0; i < len; i++) {
-		package_id = pk_console_resolve_package (ctx,
-							 packages[i],
-							 &error_local);
+		GPtrArray *matches = NULL;
+
+		/* names without an exact match get resolved on their own */
+		if (resolved != NULL)
+			matches = g_hash_table_lookup (resolved, packages[i]);
+		if (matches != NULL && matches->len > 0) {
+			package_id = pk_console_choose_package (matches,
+								&error_local);
+		} else {
+			package_id = pk_console_resolve_package (ctx,
+								 packages[i],
+								 &error_local);
+		}
 		if (package_id == NULL) {
 			if (g_error_matches (error_local,
 					     PK_CONSOLE_ERROR,
@@ -0,0 +1,14 @@
+#!/bin/sh
+# Licensed under the GNU General Public License Version 2
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+# the frame for "percentage	50", then a stray line where a frame should
+# be, and then hang around so the daemon has to kill us
+echo "framed-output"
+printf '\376\004\000\000\000\00750\000'
+echo "some library said hello"
+printf '\376\001\000\000\000\003'
+sleep 10
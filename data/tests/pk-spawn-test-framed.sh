@@ -0,0 +1,13 @@
+#!/bin/sh
+# Licensed under the GNU General Public License Version 2
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+# a line, then the frames for "percentage	50" and "finished"
+echo "status	query"
+echo "framed-output"
+printf '\376\004\000\000\000\00750\000'
+sleep 0.1
+printf '\376\001\000\000\000\003'
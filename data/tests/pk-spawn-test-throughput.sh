@@ -0,0 +1,12 @@
+#!/bin/sh
+# Licensed under the GNU General Public License Version 2
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+# write as many lines as possible, as fast as possible
+for i in `seq 1 20000`
+do
+	echo "package	available	polkit;0.0.$i;i386;data	PolicyKit daemon"
+done
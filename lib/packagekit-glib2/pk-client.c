@@ -38,6 +38,8 @@
 
 #include <packagekit-glib2/pk-client.h>
 #include <packagekit-glib2/pk-client-helper.h>
+#include <packagekit-glib2/pk-client-private.h>
+#include <packagekit-glib2/pk-package-private.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-control.h>
 #include <packagekit-glib2/pk-debug.h>
@@ -66,6 +68,11 @@ struct _PkClientPrivate
 	gboolean		 interactive;
 	gboolean		 idle;
 	guint			 cache_age;
+	gchar			*plan_token;
+	guint			 items_batch_size;
+	PkClientItemsCallback	 items_callback;
+	gpointer		 items_user_data;
+	GDestroyNotify		 items_destroy_func;
 };
 
 enum {
@@ -151,8 +158,9 @@ struct _PkClientState
 	gchar				**search;
 	gchar				*tid;
 	gchar				*distro_id;
-	gchar				*transaction_id;
+	gchar				*transaction_id;	/* a GRefString */
 	gchar				*value;
+	gchar				*plan_token;
 	gpointer			 progress_user_data;
 	gpointer			 user_data;
 	guint				 number;
@@ -173,6 +181,7 @@ struct _PkClientState
 	guint				 refcount;
 	PkClientHelper			*client_helper;
 	gboolean			 waiting_for_finished;
+	GPtrArray			*items;		/* of PkSource, when streaming */
 };
 
 G_DEFINE_TYPE (PkClientState, pk_client_state, G_TYPE_OBJECT)
@@ -208,6 +217,45 @@ pk_client_state_remove (PkClient *client, PkClientState *state)
 	}
 }
 
+/*
+ * pk_client_state_flush_items:
+ *
+ * Hands the streamed results to the client callback.
+ */
+static void
+pk_client_state_flush_items (PkClientState *state)
+{
+	PkClientPrivate *priv = state->client->priv;
+	g_autoptr(GPtrArray) items = NULL;
+
+	if (state->items == NULL || state->items->len == 0)
+		return;
+
+	/* the callback may start another transaction */
+	items = g_steal_pointer (&state->items);
+	state->items = g_ptr_array_new_with_free_func (g_object_unref);
+	if (priv->items_callback != NULL)
+		priv->items_callback (items, priv->items_user_data);
+}
+
+/*
+ * pk_client_state_add_item:
+ *
+ * Returns %TRUE if the item was streamed rather than added to the results.
+ */
+static gboolean
+pk_client_state_add_item (PkClientState *state, gpointer item)
+{
+	guint batch_size = state->client->priv->items_batch_size;
+
+	if (state->items == NULL)
+		return FALSE;
+	g_ptr_array_add (state->items, g_object_ref (item));
+	if (state->items->len >= MAX (batch_size, 1))
+		pk_client_state_flush_items (state);
+	return TRUE;
+}
+
 static void
 pk_client_state_finish (PkClientState *state, const GError *error)
 {
@@ -217,6 +265,9 @@ pk_client_state_finish (PkClientState *state, const GError *error)
 	if (state->res == NULL)
 		return;
 
+	/* whatever is still queued arrives before the transaction completes */
+	pk_client_state_flush_items (state);
+
 	/* force finished (if not already set) so clients can update the UI's */
 	ret = pk_progress_set_status (state->progress, PK_STATUS_ENUM_FINISHED);
 	if (ret && state->progress_callback != NULL) {
@@ -279,9 +330,11 @@ pk_client_state_finalize (GObject *object)
 	g_free (state->repo_id);
 	g_strfreev (state->search);
 	g_free (state->value);
+	g_free (state->plan_token);
 	g_free (state->tid);
 	g_free (state->distro_id);
-	g_free (state->transaction_id);
+	g_clear_pointer (&state->transaction_id, g_ref_string_release);
+	g_clear_pointer (&state->items, g_ptr_array_unref);
 	g_strfreev (state->files);
 	g_strfreev (state->package_ids);
 	/* results will not exist if the CreateTransaction fails */
@@ -378,6 +431,7 @@ pk_client_state_new (PkClient *client,
 	state->res = g_simple_async_result_new (G_OBJECT (client), callback_ready, user_data, source_tag);
 	state->client = g_object_ref (client);
 	state->cancellable = g_cancellable_new ();
+	state->plan_token = g_strdup (client->priv->plan_token);
 
 	if (cancellable != NULL) {
 		state->cancellable_client = g_object_ref (cancellable);
@@ -870,21 +924,21 @@ pk_client_signal_package (PkClientState *state,
 	g_autoptr(PkPackage) package = NULL;
 
 	/* create virtual package */
-	package = pk_package_new ();
-	if (!pk_package_set_id (package, package_id, &error)) {
+	package = pk_package_new_for_results (info_enum,
+					      update_severity,
+					      package_id,
+					      summary,
+					      state->role,
+					      state->transaction_id,
+					      &error);
+	if (package == NULL) {
 		g_warning ("failed to set package id for %s", package_id);
 		return;
 	}
-	g_object_set (package,
-		      "info", info_enum,
-		      "summary", summary,
-		      "update-severity", update_severity,
-		      "role", state->role,
-		      "transaction-id", state->transaction_id,
-		      NULL);
 
 	/* add to results */
-	if (state->results != NULL && info_enum != PK_INFO_ENUM_FINISHED)
+	if (state->results != NULL && info_enum != PK_INFO_ENUM_FINISHED &&
+	    !pk_client_state_add_item (state, package))
 		pk_results_add_package (state->results, package);
 
 	/* only emit progress for verb packages */
@@ -1208,6 +1262,22 @@ pk_client_signal_cb (GDBusProxy *proxy,
 					  tmp_str[2]);
 		return;
 	}
+	if (g_strcmp0 (signal_name, "Packages") == 0) {
+		GVariantIter *iter;
+		g_variant_get (parameters, "(a(uss))", &iter);
+		while (g_variant_iter_next (iter, "(u&s&s)",
+					    &tmp_uint,
+					    &tmp_str[1],
+					    &tmp_str[2])) {
+			pk_client_signal_package (state,
+						  tmp_uint & 0xFFFF,
+						  (tmp_uint >> 16) & 0xFFFF,
+						  tmp_str[1],
+						  tmp_str[2]);
+		}
+		g_variant_iter_free (iter);
+		return;
+	}
 	if (g_strcmp0 (signal_name, "Details") == 0) {
 		gchar *key;
 		GVariantIter *dictionary;
@@ -1249,7 +1319,8 @@ pk_client_signal_cb (GDBusProxy *proxy,
 				      "transaction-id", state->transaction_id,
 				      NULL);
 		}
-		pk_results_add_details (state->results, item);
+		if (!pk_client_state_add_item (state, item))
+			pk_results_add_details (state->results, item);
 		return;
 	}
 	if (g_strcmp0 (signal_name, "UpdateDetail") == 0) {
@@ -1285,7 +1356,8 @@ pk_client_signal_cb (GDBusProxy *proxy,
 			      "role", state->role,
 			      "transaction-id", state->transaction_id,
 			      NULL);
-		pk_results_add_update_detail (state->results, item);
+		if (!pk_client_state_add_item (state, item))
+			pk_results_add_update_detail (state->results, item);
 		g_free (tmp_strv[0]);
 		g_free (tmp_strv[1]);
 		g_free (tmp_strv[2]);
@@ -1318,7 +1390,8 @@ pk_client_signal_cb (GDBusProxy *proxy,
 			      "PkSource::role", state->role,
 			      "transaction-id", state->transaction_id,
 			      NULL);
-		pk_results_add_transaction (state->results, item);
+		if (!pk_client_state_add_item (state, item))
+			pk_results_add_transaction (state->results, item);
 		return;
 	}
 	if (g_strcmp0 (signal_name, "DistroUpgrade") == 0) {
@@ -1336,7 +1409,8 @@ pk_client_signal_cb (GDBusProxy *proxy,
 			      "role", state->role,
 			      "transaction-id", state->transaction_id,
 			      NULL);
-		pk_results_add_distro_upgrade (state->results, item);
+		if (!pk_client_state_add_item (state, item))
+			pk_results_add_distro_upgrade (state->results, item);
 		return;
 	}
 	if (g_strcmp0 (signal_name, "RequireRestart") == 0) {
@@ -1374,7 +1448,8 @@ pk_client_signal_cb (GDBusProxy *proxy,
 			      "role", state->role,
 			      "transaction-id", state->transaction_id,
 			      NULL);
-		pk_results_add_category (state->results, item);
+		if (!pk_client_state_add_item (state, item))
+			pk_results_add_category (state->results, item);
 		return;
 	}
 	if (g_strcmp0 (signal_name, "Files") == 0) {
@@ -1391,7 +1466,8 @@ pk_client_signal_cb (GDBusProxy *proxy,
 			      "role", state->role,
 			      "transaction-id", state->transaction_id,
 			      NULL);
-		pk_results_add_files (state->results, item);
+		if (!pk_client_state_add_item (state, item))
+			pk_results_add_files (state->results, item);
 		return;
 	}
 	if (g_strcmp0 (signal_name, "RepoSignatureRequired") == 0) {
@@ -1457,7 +1533,8 @@ pk_client_signal_cb (GDBusProxy *proxy,
 			      "role", state->role,
 			      "transaction-id", state->transaction_id,
 			      NULL);
-		pk_results_add_repo_detail (state->results, item);
+		if (!pk_client_state_add_item (state, item))
+			pk_results_add_repo_detail (state->results, item);
 		return;
 	}
 	if (g_strcmp0 (signal_name, "ErrorCode") == 0) {
@@ -2180,6 +2257,14 @@ pk_client_get_proxy_cb (GObject *object,
 	/* connect */
 	pk_client_proxy_connect (state);
 
+	/* stream the results if asked to, unless we need them ourselves */
+	if (state->client->priv->items_callback != NULL &&
+	    !pk_bitfield_contain (state->transaction_flags,
+				  PK_TRANSACTION_FLAG_ENUM_SIMULATE) &&
+	    !(state->role == PK_ROLE_ENUM_DOWNLOAD_PACKAGES &&
+	      state->directory != NULL))
+		state->items = g_ptr_array_new_with_free_func (g_object_unref);
+
 	/* get hints */
 	array = g_ptr_array_new_with_free_func (g_free);
 
@@ -2199,6 +2284,9 @@ pk_client_get_proxy_cb (GObject *object,
 				pk_client_bool_to_string (state->client->priv->interactive));
 	g_ptr_array_add (array, hint);
 
+	/* we can decode coalesced ::Packages() */
+	g_ptr_array_add (array, g_strdup ("batch-packages=true"));
+
 	/* cache-age */
 	if (state->client->priv->cache_age > 0) {
 		hint = g_strdup_printf ("cache-age=%u",
@@ -2206,6 +2294,12 @@ pk_client_get_proxy_cb (GObject *object,
 		g_ptr_array_add (array, hint);
 	}
 
+	/* ties a simulation to the transaction that follows it */
+	if (state->plan_token != NULL) {
+		hint = g_strdup_printf ("plan-token=%s", state->plan_token);
+		g_ptr_array_add (array, hint);
+	}
+
 	/* create socket for roles that need interaction */
 	if (state->role == PK_ROLE_ENUM_INSTALL_FILES ||
 	    state->role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
@@ -2246,6 +2340,8 @@ pk_client_get_tid_cb (GObject *object, GAsyncResult *res, PkClientState *state)
 		return;
 	}
 
+	/* shared by everything in the results */
+	state->transaction_id = g_ref_string_new (state->tid);
 	pk_progress_set_transaction_id (state->progress, state->tid);
 
 	/* get a connection to the transaction interface */
@@ -4167,6 +4263,7 @@ pk_client_adopt_async (PkClient *client,
 	/* save state */
 	state = pk_client_state_new (client, callback_ready, user_data, pk_client_adopt_async, PK_ROLE_ENUM_UNKNOWN, cancellable);
 	state->tid = g_strdup (transaction_id);
+	state->transaction_id = g_ref_string_new (transaction_id);
 	state->progress_callback = progress_callback;
 	state->progress_user_data = progress_user_data;
 	state->progress = pk_progress_new ();
@@ -4547,6 +4644,62 @@ pk_client_get_cache_age (PkClient *client)
 	return client->priv->cache_age;
 }
 
+/**
+ * pk_client_set_items_callback:
+ * @client: a valid #PkClient instance
+ * @batch_size: how many results to collect before calling @callback, or 0 for each one
+ * @callback: (scope notified) (nullable): the function to call, or %NULL to stop streaming
+ * @user_data: data to pass to @callback
+ * @destroy_func: (nullable): the function to free @user_data
+ *
+ * Streams the results of transactions started from now on to @callback
+ * instead of keeping them in the #PkResults, so the memory used stays
+ * bounded however many results a transaction returns.
+ *
+ * Packages, details, update details, files, categories, repo details,
+ * distro upgrades and old transactions are streamed. Everything else,
+ * such as the error code and restart requirements, stays in the
+ * #PkResults. Simulations and downloads into a directory are never
+ * streamed, as their results are needed to finish the transaction.
+ *
+ * Since: 1.2.6
+ **/
+void
+pk_client_set_items_callback (PkClient *client,
+			      guint batch_size,
+			      PkClientItemsCallback callback,
+			      gpointer user_data,
+			      GDestroyNotify destroy_func)
+{
+	PkClientPrivate *priv;
+
+	g_return_if_fail (PK_IS_CLIENT (client));
+
+	priv = client->priv;
+	if (priv->items_destroy_func != NULL)
+		priv->items_destroy_func (priv->items_user_data);
+	priv->items_batch_size = batch_size;
+	priv->items_callback = callback;
+	priv->items_user_data = user_data;
+	priv->items_destroy_func = destroy_func;
+}
+
+/*
+ * pk_client_set_plan_token:
+ * @client: a valid #PkClient instance
+ * @plan_token: an opaque token, or %NULL to unset
+ *
+ * Sets the token sent with transactions created from now on, so the
+ * backend can reuse the plan of a simulation for the real transaction.
+ **/
+void
+pk_client_set_plan_token (PkClient *client, const gchar *plan_token)
+{
+	g_return_if_fail (PK_IS_CLIENT (client));
+	g_free (client->priv->plan_token);
+	client->priv->plan_token = g_strdup (plan_token);
+}
+
 /*
  * pk_client_class_init:
  **/
@@ -4645,6 +4798,9 @@ pk_client_finalize (GObject *object)
 	pk_client_cancel_all_dbus_methods (client);
 
 	g_free (client->priv->locale);
+	g_free (client->priv->plan_token);
+	if (priv->items_destroy_func != NULL)
+		priv->items_destroy_func (priv->items_user_data);
 	g_object_unref (priv->control);
 	g_ptr_array_unref (priv->calls);
 
@@ -107,6 +107,18 @@ struct _PkClientClass
 	void (*_pk_reserved5) (void);
 };
 
+/**
+ * PkClientItemsCallback:
+ * @items: (element-type PkSource): the results that arrived, e.g. #PkPackage
+ * @user_data: the data passed to pk_client_set_items_callback()
+ *
+ * Receives the results of a transaction as they arrive.
+ *
+ * Since: 1.2.6
+ */
+typedef void	(*PkClientItemsCallback)		(GPtrArray		*items,
+							 gpointer		 user_data);
+
 GQuark		 pk_client_error_quark			(void);
 GType		 pk_client_get_type		  	(void);
 PkClient	*pk_client_new				(void);
@@ -431,6 +443,11 @@ gboolean	 pk_client_get_idle			(PkClient		*client);
 void		 pk_client_set_cache_age		(PkClient		*client,
 							 guint			 cache_age);
 guint		 pk_client_get_cache_age		(PkClient		*client);
+void		 pk_client_set_items_callback		(PkClient		*client,
+							 guint			 batch_size,
+							 PkClientItemsCallback	 callback,
+							 gpointer		 user_data,
+							 GDestroyNotify		 destroy_func);
 
 G_END_DECLS
 
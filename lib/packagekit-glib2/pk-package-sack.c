@@ -42,6 +42,13 @@
 
 static void     pk_package_sack_finalize	(GObject     *object);
 
+/* secondary indexes, built lazily on the first lookup */
+typedef enum {
+	PK_PACKAGE_SACK_INDEX_NAME,
+	PK_PACKAGE_SACK_INDEX_NAME_ARCH,
+	PK_PACKAGE_SACK_INDEX_LAST
+} PkPackageSackIndex;
+
 #define PK_PACKAGE_SACK_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_PACKAGE_SACK, PkPackageSackPrivate))
 
 /**
@@ -53,6 +60,7 @@ struct _PkPackageSackPrivate
 {
 	GHashTable		*table;
 	GPtrArray		*array;
+	GHashTable		*index[PK_PACKAGE_SACK_INDEX_LAST];
 	PkClient		*client;
 };
 
@@ -63,6 +71,163 @@ enum {
 
 G_DEFINE_TYPE (PkPackageSack, pk_package_sack, G_TYPE_OBJECT)
 
+/*
+ * pk_package_sack_index_key:
+ **/
+static gchar *
+pk_package_sack_index_key (PkPackageSackIndex idx,
+			   const gchar *name,
+			   const gchar *arch)
+{
+	if (name == NULL)
+		return NULL;
+	if (idx == PK_PACKAGE_SACK_INDEX_NAME_ARCH)
+		return g_strdup_printf ("%s;%s", name, arch != NULL ? arch : "");
+	return g_strdup (name);
+}
+
+/*
+ * pk_package_sack_index_key_for_package:
+ **/
+static gchar *
+pk_package_sack_index_key_for_package (PkPackageSackIndex idx, PkPackage *package)
+{
+	return pk_package_sack_index_key (idx,
+					  pk_package_get_name (package),
+					  pk_package_get_arch (package));
+}
+
+/*
+ * pk_package_sack_index_insert:
+ **/
+static void
+pk_package_sack_index_insert (GHashTable *idx_table,
+			      PkPackageSackIndex idx,
+			      PkPackage *package)
+{
+	GPtrArray *bucket;
+	gchar *key;
+
+	key = pk_package_sack_index_key_for_package (idx, package);
+	if (key == NULL)
+		return;
+	bucket = g_hash_table_lookup (idx_table, key);
+	if (bucket == NULL) {
+		/* the packages are owned by priv->array */
+		bucket = g_ptr_array_new ();
+		g_hash_table_insert (idx_table, key, bucket);
+	} else {
+		g_free (key);
+	}
+	g_ptr_array_add (bucket, package);
+}
+
+/*
+ * pk_package_sack_index_invalidate:
+ **/
+static void
+pk_package_sack_index_invalidate (PkPackageSack *sack, PkPackageSackIndex idx)
+{
+	g_clear_pointer (&sack->priv->index[idx], g_hash_table_unref);
+}
+
+/*
+ * pk_package_sack_index_invalidate_all:
+ **/
+static void
+pk_package_sack_index_invalidate_all (PkPackageSack *sack)
+{
+	guint i;
+	for (i = 0; i < PK_PACKAGE_SACK_INDEX_LAST; i++)
+		pk_package_sack_index_invalidate (sack, i);
+}
+
+/*
+ * pk_package_sack_index_ensure:
+ **/
+static GHashTable *
+pk_package_sack_index_ensure (PkPackageSack *sack, PkPackageSackIndex idx)
+{
+	GHashTable *idx_table;
+	PkPackageSackPrivate *priv = sack->priv;
+	guint i;
+
+	if (priv->index[idx] != NULL)
+		return priv->index[idx];
+
+	/* build from the array so each bucket is in sack order */
+	idx_table = g_hash_table_new_full (g_str_hash, g_str_equal,
+				       g_free, (GDestroyNotify) g_ptr_array_unref);
+	for (i = 0; i < priv->array->len; i++) {
+		pk_package_sack_index_insert (idx_table, idx,
+					      g_ptr_array_index (priv->array, i));
+	}
+	priv->index[idx] = idx_table;
+	return idx_table;
+}
+
+/*
+ * pk_package_sack_index_add:
+ **/
+static void
+pk_package_sack_index_add (PkPackageSack *sack, PkPackage *package)
+{
+	guint i;
+	for (i = 0; i < PK_PACKAGE_SACK_INDEX_LAST; i++) {
+		if (sack->priv->index[i] != NULL)
+			pk_package_sack_index_insert (sack->priv->index[i], i, package);
+	}
+}
+
+/*
+ * pk_package_sack_index_remove:
+ **/
+static void
+pk_package_sack_index_remove (PkPackageSack *sack, PkPackage *package)
+{
+	GPtrArray *bucket;
+	guint i;
+
+	for (i = 0; i < PK_PACKAGE_SACK_INDEX_LAST; i++) {
+		g_autofree gchar *key = NULL;
+
+		if (sack->priv->index[i] == NULL)
+			continue;
+		key = pk_package_sack_index_key_for_package (i, package);
+		if (key == NULL)
+			continue;
+		bucket = g_hash_table_lookup (sack->priv->index[i], key);
+
+		/* the package was changed after it was indexed, so we
+		 * cannot find the stale entry; drop the whole index */
+		if (bucket == NULL || !g_ptr_array_remove (bucket, package)) {
+			pk_package_sack_index_invalidate (sack, i);
+			continue;
+		}
+		if (bucket->len == 0)
+			g_hash_table_remove (sack->priv->index[i], key);
+	}
+}
+
+/*
+ * pk_package_sack_index_lookup:
+ **/
+static GPtrArray *
+pk_package_sack_index_lookup (PkPackageSack *sack,
+			      PkPackageSackIndex idx,
+			      const gchar *name,
+			      const gchar *arch)
+{
+	GHashTable *idx_table;
+	g_autofree gchar *key = NULL;
+
+	key = pk_package_sack_index_key (idx, name, arch);
+	if (key == NULL)
+		return NULL;
+	idx_table = pk_package_sack_index_ensure (sack, idx);
+	return g_hash_table_lookup (idx_table, key);
+}
+
 /**
  * pk_package_sack_clear:
  * @sack: a valid #PkPackageSack instance
@@ -76,6 +241,7 @@ pk_package_sack_clear (PkPackageSack *sack)
 {
 	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
 
+	pk_package_sack_index_invalidate_all (sack);
 	g_ptr_array_set_size (sack->priv->array, 0);
 	g_hash_table_remove_all (sack->priv->table);
 }
@@ -240,6 +406,7 @@ pk_package_sack_add_package (PkPackageSack *sack, PkPackage *package)
 	g_hash_table_insert (sack->priv->table,
 			     (gpointer) pk_package_get_id (package),
 			     (gpointer) package);
+	pk_package_sack_index_add (sack, package);
 
 	return TRUE;
 }
@@ -411,12 +578,18 @@ pk_package_sack_to_file (PkPackageSack *sack, GFile *file, GError **error)
 gboolean
 pk_package_sack_remove_package (PkPackageSack *sack, PkPackage *package)
 {
+	guint idx;
+
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (PK_IS_PACKAGE (package), FALSE);
 
 	/* remove from array */
+	if (!g_ptr_array_find (sack->priv->array, package, &idx))
+		return FALSE;
+	pk_package_sack_index_remove (sack, package);
 	g_hash_table_remove (sack->priv->table, pk_package_get_id (package));
-	return g_ptr_array_remove (sack->priv->array, package);
+	g_ptr_array_remove_index (sack->priv->array, idx);
+	return TRUE;
 }
 
 /**
@@ -471,26 +644,34 @@ pk_package_sack_remove_by_filter (PkPackageSack *sack,
 				  PkPackageSackFilterFunc filter_cb,
 				  gpointer user_data)
 {
-	gboolean ret = FALSE;
 	PkPackage *package;
-	gint i;
+	guint i;
+	guint j = 0;
 	PkPackageSackPrivate *priv = sack->priv;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (filter_cb != NULL, FALSE);
 
-	/* add each that matches the info enum */
-	for (i = 0; i < (gint) priv->array->len; i++) {
+	/* compact the retained packages in one pass rather than removing
+	 * each one from the middle of the array */
+	for (i = 0; i < priv->array->len; i++) {
 		package = g_ptr_array_index (priv->array, i);
-		if (!filter_cb (package, user_data)) {
-			ret = TRUE;
-			pk_package_sack_remove_package (sack, package);
-
-			/* ensure we pick up subsequent matches */
-			i--;
+		if (filter_cb (package, user_data)) {
+			priv->array->pdata[j++] = package;
+			continue;
 		}
+		pk_package_sack_index_invalidate_all (sack);
+		g_hash_table_remove (priv->table, pk_package_get_id (package));
+		g_object_unref (package);
 	}
-	return ret;
+	if (j == priv->array->len)
+		return FALSE;
+
+	/* the tail now only holds moved or released pointers */
+	g_ptr_array_set_free_func (priv->array, NULL);
+	g_ptr_array_set_size (priv->array, j);
+	g_ptr_array_set_free_func (priv->array, g_object_unref);
+	return TRUE;
 }
 
 /**
@@ -535,8 +716,7 @@ pk_package_sack_find_by_id (PkPackageSack *sack, const gchar *package_id)
 PkPackage *
 pk_package_sack_find_by_id_name_arch (PkPackageSack *sack, const gchar *package_id)
 {
-	PkPackage *pkg_tmp;
-	guint i;
+	GPtrArray *bucket;
 	g_auto(GStrv) split = NULL;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
@@ -546,16 +726,116 @@ pk_package_sack_find_by_id_name_arch (PkPackageSack *sack, const gchar *package_
 	split = pk_package_id_split (package_id);
 	if (split == NULL)
 		return NULL;
+	bucket = pk_package_sack_index_lookup (sack, PK_PACKAGE_SACK_INDEX_NAME_ARCH,
+					       split[PK_PACKAGE_ID_NAME],
+					       split[PK_PACKAGE_ID_ARCH]);
+	if (bucket == NULL)
+		return NULL;
+	return g_object_ref (g_ptr_array_index (bucket, 0));
+}
+
+/*
+ * pk_package_sack_index_copy:
+ **/
+static GPtrArray *
+pk_package_sack_index_copy (GPtrArray *bucket)
+{
+	GPtrArray *array;
+	guint i;
+
+	array = g_ptr_array_new_with_free_func (g_object_unref);
+	for (i = 0; bucket != NULL && i < bucket->len; i++)
+		g_ptr_array_add (array, g_object_ref (g_ptr_array_index (bucket, i)));
+	return array;
+}
+
+/**
+ * pk_package_sack_find_by_name:
+ * @sack: a valid #PkPackageSack instance
+ * @name: a package name, e.g. "powertop"
+ *
+ * Finds all the packages in a sack with the given name. The lookup uses an
+ * index that is built on first use, so repeated calls are cheap.
+ *
+ * Return value: (element-type PkPackage) (transfer container): the matching
+ * packages in sack order, free with g_ptr_array_unref()
+ *
+ * Since: 1.2.6
+ **/
+GPtrArray *
+pk_package_sack_find_by_name (PkPackageSack *sack, const gchar *name)
+{
+	GPtrArray *bucket;
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
+	g_return_val_if_fail (name != NULL, NULL);
+
+	bucket = pk_package_sack_index_lookup (sack, PK_PACKAGE_SACK_INDEX_NAME,
+					       name, NULL);
+	return pk_package_sack_index_copy (bucket);
+}
+
+/**
+ * pk_package_sack_find_by_name_arch:
+ * @sack: a valid #PkPackageSack instance
+ * @name: a package name, e.g. "powertop"
+ * @arch: a package architecture, e.g. "i386"
+ *
+ * Finds all the packages in a sack with the given name and architecture.
+ *
+ * Return value: (element-type PkPackage) (transfer container): the matching
+ * packages in sack order, free with g_ptr_array_unref()
+ *
+ * Since: 1.2.6
+ **/
+GPtrArray *
+pk_package_sack_find_by_name_arch (PkPackageSack *sack,
+				   const gchar *name,
+				   const gchar *arch)
+{
+	GPtrArray *bucket;
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
+	g_return_val_if_fail (name != NULL, NULL);
+	g_return_val_if_fail (arch != NULL, NULL);
+
+	bucket = pk_package_sack_index_lookup (sack, PK_PACKAGE_SACK_INDEX_NAME_ARCH,
+					       name, arch);
+	return pk_package_sack_index_copy (bucket);
+}
+
+/**
+ * pk_package_sack_find_by_info:
+ * @sack: a valid #PkPackageSack instance
+ * @info: a #PkInfoEnum value to match
+ *
+ * Finds all the packages in a sack with the given info enum value. Unlike
+ * pk_package_sack_filter_by_info() no new sack is created.
+ *
+ * The info of a package can be changed at any time without the sack being
+ * told, so this is always a scan rather than an index lookup.
+ *
+ * Return value: (element-type PkPackage) (transfer container): the matching
+ * packages in sack order, free with g_ptr_array_unref()
+ *
+ * Since: 1.2.6
+ **/
+GPtrArray *
+pk_package_sack_find_by_info (PkPackageSack *sack, PkInfoEnum info)
+{
+	GPtrArray *array;
+	PkPackage *package;
+	guint i;
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
+
+	array = g_ptr_array_new_with_free_func (g_object_unref);
 	for (i = 0; i < sack->priv->array->len; i++) {
-		pkg_tmp = g_ptr_array_index (sack->priv->array, i);
-		if (g_strcmp0 (pk_package_get_name (pkg_tmp),
-			       split[PK_PACKAGE_ID_NAME]) == 0 &&
-		    g_strcmp0 (pk_package_get_arch (pkg_tmp),
-			       split[PK_PACKAGE_ID_ARCH]) == 0) {
-			return g_object_ref (pkg_tmp);
-		}
+		package = g_ptr_array_index (sack->priv->array, i);
+		if (pk_package_get_info (package) == info)
+			g_ptr_array_add (array, g_object_ref (package));
 	}
-	return NULL;
+	return array;
 }
 
 /*
@@ -632,6 +912,9 @@ void
 pk_package_sack_sort (PkPackageSack *sack, PkPackageSackSortType type)
 {
 	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
+
+	/* the index buckets are kept in sack order */
+	pk_package_sack_index_invalidate_all (sack);
 	if (type == PK_PACKAGE_SACK_SORT_TYPE_NAME)
 		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_name_func);
 	else if (type == PK_PACKAGE_SACK_SORT_TYPE_PACKAGE_ID)
@@ -1155,6 +1438,7 @@ pk_package_sack_finalize (GObject *object)
 	PkPackageSack *sack = PK_PACKAGE_SACK (object);
 	PkPackageSackPrivate *priv = sack->priv;
 
+	pk_package_sack_index_invalidate_all (sack);
 	g_ptr_array_unref (priv->array);
 	g_hash_table_unref (priv->table);
 	g_object_unref (priv->client);
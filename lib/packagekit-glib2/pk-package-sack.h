@@ -132,6 +132,13 @@ PkPackage	*pk_package_sack_find_by_id		(PkPackageSack		*sack,
 							 const gchar		*package_id);
 PkPackage	*pk_package_sack_find_by_id_name_arch	(PkPackageSack		*sack,
 							 const gchar		*package_id);
+GPtrArray	*pk_package_sack_find_by_name		(PkPackageSack		*sack,
+							 const gchar		*name);
+GPtrArray	*pk_package_sack_find_by_name_arch	(PkPackageSack		*sack,
+							 const gchar		*name,
+							 const gchar		*arch);
+GPtrArray	*pk_package_sack_find_by_info		(PkPackageSack		*sack,
+							 PkInfoEnum		 info);
 PkPackageSack	*pk_package_sack_filter_by_info		(PkPackageSack		*sack,
 							 PkInfoEnum		 info);
 PkPackageSack	*pk_package_sack_filter			(PkPackageSack		*sack,
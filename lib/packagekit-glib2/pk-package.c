@@ -31,8 +31,11 @@
 #include "config.h"
 
 #include <glib-object.h>
+#include <string.h>
 
 #include <packagekit-glib2/pk-package.h>
+#include <packagekit-glib2/pk-package-private.h>
+#include <packagekit-glib2/pk-source-private.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-enum-types.h>
@@ -164,20 +167,29 @@ pk_package_set_id (PkPackage *package, const gchar *package_id, GError **error)
 {
 	PkPackagePrivate *priv = package->priv;
 	gboolean ret;
+	gchar *buf;
+	gsize len;
 	guint cnt = 0;
 	guint i;
 
 	g_return_val_if_fail (PK_IS_PACKAGE (package), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-	/* free old data */
+	/* the package-id and the split copy share one allocation */
+	len = strlen (package_id);
+	buf = g_malloc (len * 2 + 2);
+	memcpy (buf, package_id, len + 1);
+	memcpy (buf + len + 1, package_id, len + 1);
+
+	/* free old data, which package_id may point into */
 	g_free (priv->package_id);
-	g_free (priv->package_id_data);
+	priv->package_id = buf;
+	package_id = buf;
 
-	/* copy the package-id into package_id_data, change the ';' into '\0'
-	 * and reference the pointers in the const gchar * array */
-	priv->package_id = g_strdup (package_id);
-	priv->package_id_data = g_strdup (package_id);
+	/* change the ';' into '\0' in package_id_data and reference the
+	 * pointers in the const gchar * array */
+	priv->package_id_data = buf + len + 1;
 	priv->package_id_split[0] = priv->package_id_data;
 	for (i = 0; priv->package_id_data[i] != '\0'; i++) {
 		if (package_id[i] == ';') {
@@ -864,7 +876,6 @@ pk_package_finalize (GObject *object)
 	g_free (priv->update_changelog);
 	g_free (priv->update_issued);
 	g_free (priv->update_updated);
-	g_free (priv->package_id_data);
 
 	G_OBJECT_CLASS (pk_package_parent_class)->finalize (object);
 }
@@ -884,6 +895,42 @@ pk_package_new (void)
 	return PK_PACKAGE (package);
 }
 
+/*
+ * pk_package_new_for_results:
+ * @info: the #PkInfoEnum
+ * @update_severity: the update severity, or %PK_INFO_ENUM_UNKNOWN
+ * @package_id: the package-id
+ * @summary: the package summary
+ * @role: the #PkRoleEnum of the transaction
+ * @transaction_id: a #GRefString shared by the transaction, or %NULL
+ * @error: a #GError, or %NULL
+ *
+ * Creates a package for a transaction result without going through the
+ * #GObject property machinery, as transactions can return many thousands.
+ *
+ * Return value: a new #PkPackage, or %NULL if @package_id is invalid
+ **/
+PkPackage *
+pk_package_new_for_results (PkInfoEnum info,
+			    PkInfoEnum update_severity,
+			    const gchar *package_id,
+			    const gchar *summary,
+			    PkRoleEnum role,
+			    const gchar *transaction_id,
+			    GError **error)
+{
+	g_autoptr(PkPackage) package = pk_package_new ();
+
+	if (!pk_package_set_id (package, package_id, error))
+		return NULL;
+	package->priv->info = info;
+	package->priv->summary = g_strdup (summary);
+	if (update_severity != PK_INFO_ENUM_UNKNOWN)
+		pk_package_set_update_severity (package, update_severity);
+	pk_source_set_transaction (PK_SOURCE (package), role, transaction_id);
+	return g_steal_pointer (&package);
+}
+
 /**
  * pk_package_get_update_severity:
  * @package: a #PkPackage
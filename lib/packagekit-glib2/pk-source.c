@@ -32,6 +32,7 @@
 #include <glib-object.h>
 
 #include <packagekit-glib2/pk-source.h>
+#include <packagekit-glib2/pk-source-private.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-enum-types.h>
 
@@ -47,7 +48,7 @@ static void     pk_source_finalize	(GObject     *object);
 struct _PkSourcePrivate
 {
 	PkRoleEnum			 role;
-	gchar				*transaction_id;
+	gchar				*transaction_id;	/* a GRefString */
 };
 
 enum {
@@ -95,8 +96,9 @@ pk_source_set_property (GObject *object, guint prop_id, const GValue *value, GPa
 		priv->role = g_value_get_enum (value);
 		break;
 	case PROP_TRANSACTION_ID:
-		g_free (priv->transaction_id);
-		priv->transaction_id = g_strdup (g_value_get_string (value));
+		g_clear_pointer (&priv->transaction_id, g_ref_string_release);
+		if (g_value_get_string (value) != NULL)
+			priv->transaction_id = g_ref_string_new (g_value_get_string (value));
 		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -104,6 +106,26 @@ pk_source_set_property (GObject *object, guint prop_id, const GValue *value, GPa
 	}
 }
 
+/*
+ * pk_source_set_transaction:
+ * @source: a valid #PkSource instance
+ * @role: the #PkRoleEnum
+ * @transaction_id: a #GRefString, or %NULL
+ *
+ * Sets the source without emitting notifications, sharing
+ * @transaction_id with every other object of the same transaction.
+ **/
+void
+pk_source_set_transaction (PkSource *source, PkRoleEnum role, const gchar *transaction_id)
+{
+	PkSourcePrivate *priv = source->priv;
+
+	priv->role = role;
+	g_clear_pointer (&priv->transaction_id, g_ref_string_release);
+	if (transaction_id != NULL)
+		priv->transaction_id = g_ref_string_acquire ((gchar *) transaction_id);
+}
+
 /*
  * pk_source_class_init:
  **/
@@ -157,7 +179,7 @@ pk_source_finalize (GObject *object)
 	PkSource *source = PK_SOURCE (object);
 	PkSourcePrivate *priv = source->priv;
 
-	g_free (priv->transaction_id);
+	g_clear_pointer (&priv->transaction_id, g_ref_string_release);
 
 	G_OBJECT_CLASS (pk_source_parent_class)->finalize (object);
 }
@@ -324,6 +324,85 @@ pk_task_resolve_sync (PkTask *task, PkBitfield filters, gchar **packages, GCance
 	return results;
 }
 
+/**
+ * pk_task_resolve_names_sync:
+ * @task: a valid #PkTask instance
+ * @filters: a bitfield of filters that can be used to limit the results
+ * @packages: (array zero-terminated=1): package names to find
+ * @cancellable: a #GCancellable or %NULL
+ * @progress_callback: (scope call): the function to run when the progress changes
+ * @progress_user_data: data to pass to @progress_callback
+ * @error: the #GError to store any failure, or %NULL
+ *
+ * Resolves several package names in one transaction, and groups the
+ * packages that were found by the name that was asked for. A name that
+ * matched nothing maps to an empty array, and a name that matched more
+ * than one package is left for the caller to choose from.
+ *
+ * Warning: this function is synchronous, and may block. Do not use it in GUI
+ * applications.
+ *
+ * Return value: (transfer full) (element-type utf8 GPtrArray): a
+ * hash table of package name to an array of #PkPackage, or %NULL for error
+ *
+ * Since: 1.2.6
+ **/
+GHashTable *
+pk_task_resolve_names_sync (PkTask *task, PkBitfield filters, gchar **packages, GCancellable *cancellable,
+			    PkProgressCallback progress_callback, gpointer progress_user_data,
+			    GError **error)
+{
+	GHashTable *hash;
+	guint i;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(PkError) error_code = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	g_return_val_if_fail (PK_IS_TASK (task), NULL);
+	g_return_val_if_fail (packages != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* one transaction for all the names */
+	results = pk_task_resolve_sync (task, filters, packages, cancellable,
+					progress_callback, progress_user_data,
+					error);
+	if (results == NULL)
+		return NULL;
+	error_code = pk_results_get_error_code (results);
+	if (error_code != NULL) {
+		g_set_error (error,
+			     PK_CLIENT_ERROR,
+			     PK_CLIENT_ERROR_FAILED,
+			     "failed to resolve: %s",
+			     pk_error_get_details (error_code));
+		return NULL;
+	}
+
+	/* every name gets an array, even if nothing matched */
+	hash = g_hash_table_new_full (g_str_hash, g_str_equal,
+				      g_free, (GDestroyNotify) g_ptr_array_unref);
+	for (i = 0; packages[i] != NULL; i++) {
+		if (g_hash_table_contains (hash, packages[i]))
+			continue;
+		g_hash_table_insert (hash, g_strdup (packages[i]),
+				     g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref));
+	}
+
+	/* reconcile the results with the names asked for */
+	array = pk_results_get_package_array (results);
+	for (i = 0; i < array->len; i++) {
+		PkPackage *package = g_ptr_array_index (array, i);
+		GPtrArray *matches = g_hash_table_lookup (hash, pk_package_get_name (package));
+		if (matches == NULL) {
+			g_debug ("ignoring %s as it was not asked for",
+				 pk_package_get_id (package));
+			continue;
+		}
+		g_ptr_array_add (matches, g_object_ref (package));
+	}
+	return hash;
+}
+
 /**
  * pk_task_search_names_sync:
  * @task: a valid #PkTask instance
@@ -71,6 +71,14 @@ PkResults	*pk_task_resolve_sync			(PkTask			*task,
 							 gpointer		 progress_user_data,
 							 GError			**error);
 
+GHashTable	*pk_task_resolve_names_sync		(PkTask			*task,
+							 PkBitfield		 filters,
+							 gchar			**packages,
+							 GCancellable		*cancellable,
+							 PkProgressCallback	 progress_callback,
+							 gpointer		 progress_user_data,
+							 GError			**error);
+
 PkResults	*pk_task_search_names_sync		(PkTask			*task,
 							 PkBitfield		 filters,
 							 gchar			**values,
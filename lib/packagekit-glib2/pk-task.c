@@ -30,6 +30,7 @@
 #include <gio/gio.h>
 
 #include <packagekit-glib2/pk-task.h>
+#include <packagekit-glib2/pk-client-private.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-results.h>
@@ -98,6 +99,7 @@ typedef struct {
 	gchar				**packages;
 	gchar				*repo_id;
 	gchar				*transaction_id;
+	gchar				*plan_token;
 	gchar				**values;
 	PkBitfield			 filters;
 	PkUpgradeKindEnum		 upgrade_kind;
@@ -175,6 +177,7 @@ pk_task_generic_state_finish (PkTaskState *state, const GError *error)
 	g_free (state->distro_id);
 	g_free (state->repo_id);
 	g_free (state->transaction_id);
+	g_free (state->plan_token);
 	g_strfreev (state->files);
 	g_strfreev (state->package_ids);
 	g_strfreev (state->packages);
@@ -210,6 +213,9 @@ pk_task_do_async_action (PkTaskState *state)
 				PK_TRANSACTION_FLAG_ENUM_ALLOW_DOWNGRADE);
 	}
 
+	/* let the backend reuse what it solved for the simulation */
+	pk_client_set_plan_token (PK_CLIENT (state->task), state->plan_token);
+
 	/* do the correct action */
 	if (state->role == PK_ROLE_ENUM_INSTALL_PACKAGES) {
 		pk_client_install_packages_async (PK_CLIENT(state->task), transaction_flags, state->package_ids,
@@ -316,6 +322,7 @@ pk_task_do_async_action (PkTaskState *state)
 	} else {
 		g_assert_not_reached ();
 	}
+	pk_client_set_plan_token (PK_CLIENT (state->task), NULL);
 }
 
 /*
@@ -433,6 +440,11 @@ pk_task_do_async_simulate_action (PkTaskState *state)
 	pk_bitfield_add (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE);
 	state->simulate = TRUE;
 
+	/* the backend keeps the plan under this token for the real action */
+	g_free (state->plan_token);
+	state->plan_token = g_uuid_string_random ();
+	pk_client_set_plan_token (PK_CLIENT (state->task), state->plan_token);
+
 	/* do the correct action */
 	if (state->role == PK_ROLE_ENUM_INSTALL_PACKAGES) {
 		/* simulate install async */
@@ -505,6 +517,7 @@ pk_task_do_async_simulate_action (PkTaskState *state)
 	} else {
 		g_assert_not_reached ();
 	}
+	pk_client_set_plan_token (PK_CLIENT (state->task), NULL);
 }
 
 /*
@@ -35,6 +35,7 @@
 #include "pk-package-ids.h"
 #include "pk-results.h"
 #include "pk-task.h"
+#include "pk-task-sync.h"
 #include "pk-task-text.h"
 #include "pk-task-wrapper.h"
 #include "pk-transaction-list.h"
@@ -303,6 +304,8 @@ pk_test_client_resolve_cb (GObject *object, GAsyncResult *res, gpointer user_dat
 	PkExitEnum exit_enum;
 	GPtrArray *packages;
 	gboolean idle;
+	g_autofree gchar *tid0 = NULL;
+	g_autofree gchar *tid1 = NULL;
 
 	/* get the results */
 	results = pk_client_generic_finish (client, res, &error);
@@ -320,6 +323,12 @@ pk_test_client_resolve_cb (GObject *object, GAsyncResult *res, gpointer user_dat
 	g_assert (idle);
 	g_assert_cmpint (packages->len, ==, 2);
 
+	/* the packages know which transaction they came from */
+	g_object_get (g_ptr_array_index (packages, 0), "transaction-id", &tid0, NULL);
+	g_object_get (g_ptr_array_index (packages, 1), "transaction-id", &tid1, NULL);
+	g_assert (tid0 != NULL);
+	g_assert_cmpstr (tid0, ==, tid1);
+
 	g_ptr_array_unref (packages);
 
 	g_debug ("results exit enum = %s", pk_exit_enum_to_string (exit_enum));
@@ -545,6 +554,14 @@ pk_test_client_update_system_socket_test_cb (GObject *object, GAsyncResult *res,
 	_g_test_loop_quit ();
 }
 
+static void
+pk_test_client_items_cb (GPtrArray *items, gpointer user_data)
+{
+	guint *streamed = (guint *) user_data;
+	g_assert_cmpint (items->len, <=, 2);
+	*streamed += items->len;
+}
+
 static void
 pk_test_client_func (void)
 {
@@ -557,7 +574,9 @@ pk_test_client_func (void)
 	gchar *tid;
 	PkRoleEnum role;
 	PkStatusEnum status;
-//	PkResults *results;
+	PkResults *results;
+	GPtrArray *packages;
+	guint streamed = 0;
 	g_autoptr(GCancellable) cancellable = NULL;
 	g_autoptr(PkClient) client = NULL;
 
@@ -714,6 +733,21 @@ pk_test_client_func (void)
 	_g_test_loop_run_with_timeout (15000);
 	g_debug ("downloaded and copied in %f", g_test_timer_elapsed ());
 
+	/* stream the packages rather than keeping them in the results */
+	pk_client_set_items_callback (client, 2,
+				      pk_test_client_items_cb, &streamed, NULL);
+	results = pk_client_get_packages (client,
+					  pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					  NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (results != NULL);
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 0);
+	g_assert_cmpint (streamed, >, 0);
+	pk_client_set_items_callback (client, 0, NULL, NULL, NULL);
+	g_ptr_array_unref (packages);
+	g_object_unref (results);
+
 	/* test recursive signal handling */
 #if 0
 	g_signal_connect (client->priv->control, "repo-list-changed", G_CALLBACK (pk_test_client_recursive_signal_cb), NULL);
@@ -1016,6 +1050,7 @@ pk_test_package_sack_func (void)
 {
 	gboolean ret;
 	PkPackageSack *sack;
+	GPtrArray *array;
 	PkPackage *package;
 	gchar *text;
 	gchar **strv;
@@ -1120,6 +1155,52 @@ pk_test_package_sack_func (void)
 	ret = pk_package_sack_remove_package_by_id (sack, "powertop;1.8-1.fc8;i386;fedora");
 	g_assert (!ret);
 
+	/* find using the secondary indexes */
+	pk_package_sack_add_package_by_id (sack, "powertop;1.8-1.fc8;i386;fedora", NULL);
+	array = pk_package_sack_find_by_name (sack, "powertop");
+	g_assert_cmpint (array->len, ==, 1);
+	g_ptr_array_unref (array);
+	pk_package_sack_add_package_by_id (sack, "powertop;1.8-1.fc8;x86_64;fedora", NULL);
+	array = pk_package_sack_find_by_name (sack, "powertop");
+	g_assert_cmpint (array->len, ==, 2);
+	g_ptr_array_unref (array);
+	array = pk_package_sack_find_by_name_arch (sack, "powertop", "x86_64");
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 0)), ==, "powertop;1.8-1.fc8;x86_64;fedora");
+	g_ptr_array_unref (array);
+	package = pk_package_sack_find_by_id_name_arch (sack, "powertop;1.9-1.fc9;i386;fedora");
+	g_assert (package != NULL);
+	g_assert_cmpstr (pk_package_get_id (package), ==, "powertop;1.8-1.fc8;i386;fedora");
+	g_object_unref (package);
+	array = pk_package_sack_find_by_info (sack, PK_INFO_ENUM_UNKNOWN);
+	g_assert_cmpint (array->len, ==, 2);
+	g_ptr_array_unref (array);
+
+	/* changing the info behind the sack's back is still seen */
+	package = pk_package_sack_find_by_id (sack, "powertop;1.8-1.fc8;x86_64;fedora");
+	g_assert (package != NULL);
+	pk_package_set_info (package, PK_INFO_ENUM_INSTALLED);
+	g_object_unref (package);
+	array = pk_package_sack_find_by_info (sack, PK_INFO_ENUM_UNKNOWN);
+	g_assert_cmpint (array->len, ==, 1);
+	g_ptr_array_unref (array);
+	array = pk_package_sack_find_by_info (sack, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpint (array->len, ==, 1);
+	g_ptr_array_unref (array);
+
+	/* the indexes follow removals */
+	ret = pk_package_sack_remove_package_by_id (sack, "powertop;1.8-1.fc8;i386;fedora");
+	g_assert (ret);
+	package = pk_package_sack_find_by_id_name_arch (sack, "powertop;1.8-1.fc8;i386;fedora");
+	g_assert (package == NULL);
+	array = pk_package_sack_find_by_name (sack, "powertop");
+	g_assert_cmpint (array->len, ==, 1);
+	g_ptr_array_unref (array);
+	pk_package_sack_clear (sack);
+	array = pk_package_sack_find_by_name (sack, "powertop");
+	g_assert_cmpint (array->len, ==, 0);
+	g_ptr_array_unref (array);
+
 	/* remove by filter */
 	pk_package_sack_add_package_by_id (sack, "powertop;1.8-1.fc8;i386;fedora", NULL);
 	pk_package_sack_add_package_by_id (sack, "powertop-debuginfo;1.8-1.fc8;i386;fedora", NULL);
@@ -1181,6 +1262,44 @@ pk_test_task_func (void)
 	g_object_unref (task);
 }
 
+static void
+pk_test_task_resolve_names_func (void)
+{
+	GPtrArray *matches;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GHashTable) hash = NULL;
+	g_autoptr(PkTask) task = NULL;
+	const gchar *names[] = { "glib2", "powertop", "notgoingtoexist", "glib2", NULL };
+
+	task = pk_task_new ();
+	hash = pk_task_resolve_names_sync (task,
+					   pk_bitfield_value (PK_FILTER_ENUM_INSTALLED),
+					   (gchar **) names, NULL,
+					   NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (hash != NULL);
+
+	/* one entry for each distinct name asked for */
+	g_assert_cmpint (g_hash_table_size (hash), ==, 3);
+
+	matches = g_hash_table_lookup (hash, "glib2");
+	g_assert (matches != NULL);
+	g_assert_cmpint (matches->len, ==, 1);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (matches, 0)), ==,
+			 "glib2;2.14.0;i386;fedora");
+
+	matches = g_hash_table_lookup (hash, "powertop");
+	g_assert (matches != NULL);
+	g_assert_cmpint (matches->len, ==, 1);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (matches, 0)), ==,
+			 "powertop;1.8-1.fc8;i386;fedora");
+
+	/* a missing name maps to an empty array rather than being absent */
+	matches = g_hash_table_lookup (hash, "notgoingtoexist");
+	g_assert (matches != NULL);
+	g_assert_cmpint (matches->len, ==, 0);
+}
+
 static void
 pk_test_task_text_install_packages_cb (GObject *object, GAsyncResult *res, gpointer user_data)
 {
@@ -1440,6 +1559,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit-glib2/client", pk_test_client_func);
 	g_test_add_func ("/packagekit-glib2/package-sack", pk_test_package_sack_func);
 	g_test_add_func ("/packagekit-glib2/task", pk_test_task_func);
+	g_test_add_func ("/packagekit-glib2/task-resolve-names", pk_test_task_resolve_names_func);
 	g_test_add_func ("/packagekit-glib2/task-wrapper", pk_test_task_wrapper_func);
 	g_test_add_func ("/packagekit-glib2/task-text", pk_test_task_text_func);
 	g_test_add_func ("/packagekit-glib2/console", pk_test_console_func);
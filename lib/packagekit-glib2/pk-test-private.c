@@ -31,6 +31,7 @@
 #include "pk-package.h"
 #include "pk-package-id.h"
 #include "pk-package-ids.h"
+#include "pk-package-private.h"
 #include "pk-progress-bar.h"
 #include "pk-results.h"
 
@@ -535,6 +536,54 @@ pk_test_results_func (void)
 	g_object_unref (results);
 }
 
+static void
+pk_test_results_benchmark_func (void)
+{
+	const guint n_packages = 60000;
+	gboolean ret;
+	gchar *tid;
+	gdouble elapsed;
+	guint i;
+	g_autofree gchar *tid_tmp = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(PkResults) results = pk_results_new ();
+
+	/* add packages the way PkClient does for each ::Package() */
+	tid = g_ref_string_new ("/1_abcdef");
+	g_test_timer_start ();
+	for (i = 0; i < n_packages; i++) {
+		g_autofree gchar *package_id = NULL;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(PkPackage) item = NULL;
+
+		package_id = g_strdup_printf ("package%u;0.1.2;x86_64;fedora", i);
+		item = pk_package_new_for_results (PK_INFO_ENUM_AVAILABLE,
+						   PK_INFO_ENUM_UNKNOWN,
+						   package_id,
+						   "Summary of the package",
+						   PK_ROLE_ENUM_GET_PACKAGES,
+						   tid,
+						   &error);
+		g_assert_no_error (error);
+		ret = pk_results_add_package (results, item);
+		g_assert (ret);
+	}
+	elapsed = g_test_timer_elapsed ();
+	g_test_maximized_result (n_packages / MAX (elapsed, 0.000001),
+				 "%u packages into PkResults in %.3fs",
+				 n_packages, elapsed);
+	g_ref_string_release (tid);
+
+	/* check data */
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, n_packages);
+	g_object_get (g_ptr_array_index (packages, 0),
+		      "transaction-id", &tid_tmp,
+		      NULL);
+	g_assert_cmpstr (tid_tmp, ==, "/1_abcdef");
+	g_assert_cmpint (pk_package_get_info (g_ptr_array_index (packages, 0)), ==, PK_INFO_ENUM_AVAILABLE);
+}
+
 static void
 pk_test_package_func (void)
 {
@@ -928,6 +977,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit-glib2/package-ids", pk_test_package_ids_func);
 	g_test_add_func ("/packagekit-glib2/progress", pk_test_progress_func);
 	g_test_add_func ("/packagekit-glib2/results", pk_test_results_func);
+	g_test_add_func ("/packagekit-glib2/results-benchmark", pk_test_results_benchmark_func);
 	g_test_add_func ("/packagekit-glib2/package", pk_test_package_func);
 	g_test_add_func ("/packagekit-glib2/progress-bar", pk_test_progress_bar);
 	g_test_add_func ("/packagekit-glib2/offline", pk_test_offline_func);
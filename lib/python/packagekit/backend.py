@@ -25,6 +25,7 @@
 from __future__ import print_function
 
 import sys
+import struct
 import traceback
 import os.path
 
@@ -33,6 +34,18 @@ from .enums import *
 PACKAGE_IDS_DELIM = '&'
 FILENAME_DELIM = '|'
 
+# the command ids of framed output, in the order of PkBackendSpawnCommand
+FRAMED_OUTPUT_COMMANDS = ['package', 'details', 'finished', 'files',
+                          'repo-detail', 'updatedetail', 'percentage',
+                          'item-progress', 'error', 'requirerestart', 'status',
+                          'speed', 'download-size-remaining', 'allow-cancel',
+                          'no-percentage-updates', 'repo-signature-required',
+                          'eula-required', 'media-change-required',
+                          'distro-upgrade', 'category']
+
+# the first byte of every frame, see PK_SPAWN_FRAME_MAGIC
+FRAME_MAGIC = 0xfe
+
 def _to_unicode(txt, encoding='utf-8'):
     if isinstance(txt, str):
         if not isinstance(txt, str):
@@ -46,6 +59,23 @@ def _to_utf8(txt, errors='replace'):
         return txt.encode('utf-8', errors=errors)
     return str(txt)
 
+def _to_frame(line):
+    '''
+    Convert a command line to a frame: the magic byte, the length as a
+    little endian 32 bit integer, the command id byte and then every
+    section after the command name terminated by a NUL byte.
+    Returns None for commands the daemon does not know about.
+    '''
+    if line.endswith('\n'):
+        line = line[:-1]
+    sections = line.split('\t')
+    if sections[0] not in FRAMED_OUTPUT_COMMANDS:
+        return None
+    payload = bytearray([FRAMED_OUTPUT_COMMANDS.index(sections[0]) + 1])
+    for section in sections[1:]:
+        payload += section.encode('utf-8', 'replace') + b'\0'
+    return struct.pack('<BI', FRAME_MAGIC, len(payload)) + bytes(payload)
+
 class PkError(Exception):
     def __init__(self, code, details):
         self.code = code
@@ -55,6 +85,10 @@ class PkError(Exception):
 
 class PackageKitBaseBackend:
 
+    # set in backends that never write anything else on stdout, so the
+    # daemon can be sent frames rather than lines
+    framed_output = False
+
     def __init__(self, cmds):
         # Setup a custom exception handler
         installExceptionHandler(self)
@@ -107,6 +141,33 @@ class PackageKitBaseBackend:
         except KeyError as e:
             pass
 
+        # switch to frames if the daemon can read them, this has to be
+        # the last line written
+        self._frames = None
+        if self.framed_output and os.environ.get('FRAMED_OUTPUT') == 'TRUE':
+            sys.stdout.write("framed-output\n")
+            sys.stdout.flush()
+
+            # keep a private copy of the pipe for the frames, and point
+            # fd 1 at stderr so a stray print() or a library writing to
+            # stdout can't corrupt the stream
+            self._frames = os.fdopen(os.dup(1), 'wb', 0)
+            os.dup2(2, 1)
+            sys.stdout = sys.stderr
+
+    def _write(self, line):
+        '''
+        Write a command to the daemon
+        @param line: the tab separated command, ending with a newline
+        '''
+        if self._frames is not None:
+            frame = _to_frame(line)
+            if frame is not None:
+                self._frames.write(frame)
+            return
+        sys.stdout.write(_to_utf8(line))
+        sys.stdout.flush()
+
     def doLock(self):
         ''' Generic locking, overide and extend in child class'''
         self._locked = True
@@ -124,19 +185,17 @@ class PackageKitBaseBackend:
         @param percent: Progress percentage (int preferred)
         '''
         if percent == None:
-            sys.stdout.write(_to_utf8("no-percentage-updates\n"))
+            self._write("no-percentage-updates\n")
         elif percent == 0 or percent > self.percentage_old:
-            sys.stdout.write(_to_utf8("percentage\t%i\n" % percent))
+            self._write("percentage\t%i\n" % percent)
             self.percentage_old = percent
-        sys.stdout.flush()
 
     def speed(self, bps=0):
         '''
         Write progress speed
         @param bps: Progress speed (int, bytes per second)
         '''
-        sys.stdout.write(_to_utf8("speed\t%i\n" % bps))
-        sys.stdout.flush()
+        self._write("speed\t%i\n" % bps)
 
     def item_progress(self, package_id, status, percent=None):
         '''
@@ -144,8 +203,7 @@ class PackageKitBaseBackend:
         @param package_id: The package ID name, e.g. openoffice-clipart;2.6.22;ppc64;fedora
         @param percent: percentage of the current item (int preferred)
         '''
-        sys.stdout.write(_to_utf8("item-progress\t%s\t%s\t%i\n" % (package_id, status, percent)))
-        sys.stdout.flush()
+        self._write("item-progress\t%s\t%s\t%i\n" % (package_id, status, percent))
 
     def error(self, err, description, exit=True):
         '''
@@ -159,8 +217,7 @@ class PackageKitBaseBackend:
             self.unLock()
 
         # this should be fast now
-        sys.stdout.write(_to_utf8("error\t%s\t%s\n" % (err, description)))
-        sys.stdout.flush()
+        self._write("error\t%s\t%s\n" % (err, description))
         if exit:
             # Paradoxically, we don't want to print "finished" to stdout here.
             # Python takes an _enormous_ amount of time to exit, and leaves a
@@ -174,8 +231,7 @@ class PackageKitBaseBackend:
         send 'message' signal
         @param typ: MESSAGE_BROKEN_MIRROR
         '''
-        sys.stdout.write(_to_utf8("message\t%s\t%s\n" % (typ, msg)))
-        sys.stdout.flush()
+        self._write("message\t%s\t%s\n" % (typ, msg))
 
     def package(self, package_id, status, summary):
         '''
@@ -184,8 +240,7 @@ class PackageKitBaseBackend:
         @param package_id: The package ID name, e.g. openoffice-clipart;2.6.22;ppc64;fedora
         @param summary: The package Summary
         '''
-        sys.stdout.write(_to_utf8("package\t%s\t%s\t%s\n" % (status, package_id, summary)))
-        sys.stdout.flush()
+        self._write("package\t%s\t%s\t%s\n" % (status, package_id, summary))
 
     def media_change_required(self, mtype, id, text):
         '''
@@ -194,8 +249,7 @@ class PackageKitBaseBackend:
         @param id: the localised label of the media
         @param text: the localised text describing the media
         '''
-        sys.stdout.write(_to_utf8("media-change-required\t%s\t%s\t%s\n" % (mtype, id, text)))
-        sys.stdout.flush()
+        self._write("media-change-required\t%s\t%s\t%s\n" % (mtype, id, text))
 
     def distro_upgrade(self, dtype, name, summary):
         '''
@@ -204,16 +258,14 @@ class PackageKitBaseBackend:
         @param name: The distro name, e.g. "fedora-9"
         @param summary: The localised distribution name and description
         '''
-        sys.stdout.write(_to_utf8("distro-upgrade\t%s\t%s\t%s\n" % (dtype, name, summary)))
-        sys.stdout.flush()
+        self._write("distro-upgrade\t%s\t%s\t%s\n" % (dtype, name, summary))
 
     def status(self, state):
         '''
         send 'status' signal
         @param state: STATUS_DOWNLOAD, STATUS_INSTALL, STATUS_UPDATE, STATUS_REMOVE, STATUS_WAIT
         '''
-        sys.stdout.write(_to_utf8("status\t%s\n" % state))
-        sys.stdout.flush()
+        self._write("status\t%s\n" % state)
 
     def repo_detail(self, repoid, name, state):
         '''
@@ -221,16 +273,14 @@ class PackageKitBaseBackend:
         @param repoid: The repo id tag
         @param state: false is repo is disabled else true.
         '''
-        sys.stdout.write(_to_utf8("repo-detail\t%s\t%s\t%s\n" % (repoid, name, _bool_to_string(state))))
-        sys.stdout.flush()
+        self._write("repo-detail\t%s\t%s\t%s\n" % (repoid, name, _bool_to_string(state)))
 
     def data(self, data):
         '''
         send 'data' signal:
         @param data:  The current worked on package
         '''
-        sys.stdout.write(_to_utf8("data\t%s\n" % data))
-        sys.stdout.flush()
+        self._write("data\t%s\n" % data)
 
     def details(self, package_id, summary, package_license, group, desc, url, bytes):
         '''
@@ -243,16 +293,14 @@ class PackageKitBaseBackend:
         @param url: The upstream project homepage
         @param bytes: The size of the package, in bytes
         '''
-        sys.stdout.write(_to_utf8("details\t%s\t%s\t%s\t%s\t%s\t%s\t%ld\n" % (package_id, summary, package_license, group, desc, url, bytes)))
-        sys.stdout.flush()
+        self._write("details\t%s\t%s\t%s\t%s\t%s\t%s\t%ld\n" % (package_id, summary, package_license, group, desc, url, bytes))
 
     def files(self, package_id, file_list):
         '''
         Send 'files' signal
         @param file_list: List of the files in the package, separated by ';'
         '''
-        sys.stdout.write(_to_utf8("files\t%s\t%s\n" % (package_id, file_list)))
-        sys.stdout.flush()
+        self._write("files\t%s\t%s\n" % (package_id, file_list))
 
     def category(self, parent_id, cat_id, name, summary, icon):
         '''
@@ -263,15 +311,13 @@ class PackageKitBaseBackend:
         summery   : a summary of the category in current locale.
         icon      : an icon name to represent the category
         '''
-        sys.stdout.write(_to_utf8("category\t%s\t%s\t%s\t%s\t%s\n" % (parent_id, cat_id, name, summary, icon)))
-        sys.stdout.flush()
+        self._write("category\t%s\t%s\t%s\t%s\t%s\n" % (parent_id, cat_id, name, summary, icon))
 
     def finished(self):
         '''
         Send 'finished' signal
         '''
-        sys.stdout.write(_to_utf8("finished\n"))
-        sys.stdout.flush()
+        self._write("finished\n")
 
     def update_detail(self, package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated):
         '''
@@ -289,8 +335,7 @@ class PackageKitBaseBackend:
         @param issued:
         @param updated:
         '''
-        sys.stdout.write(_to_utf8("updatedetail\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated)))
-        sys.stdout.flush()
+        self._write("updatedetail\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated))
 
     def require_restart(self, restart_type, details):
         '''
@@ -298,8 +343,7 @@ class PackageKitBaseBackend:
         @param restart_type: RESTART_SYSTEM, RESTART_APPLICATION, RESTART_SESSION
         @param details: Optional details about the restart
         '''
-        sys.stdout.write(_to_utf8("requirerestart\t%s\t%s\n" % (restart_type, details)))
-        sys.stdout.flush()
+        self._write("requirerestart\t%s\t%s\n" % (restart_type, details))
 
     def allow_cancel(self, allow):
         '''
@@ -310,8 +354,7 @@ class PackageKitBaseBackend:
             data = 'true'
         else:
             data = 'false'
-        sys.stdout.write(_to_utf8("allow-cancel\t%s\n" % data))
-        sys.stdout.flush()
+        self._write("allow-cancel\t%s\n" % data)
 
     def repo_signature_required(self, package_id, repo_name, key_url, key_userid, key_id, key_fingerprint, key_timestamp, sig_type):
         '''
@@ -325,10 +368,9 @@ class PackageKitBaseBackend:
         @param key_timestamp:   Key timestamp
         @param sig_type:        Key type (GPG)
         '''
-        sys.stdout.write(_to_utf8("repo-signature-required\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (
+        self._write("repo-signature-required\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (
             package_id, repo_name, key_url, key_userid, key_id, key_fingerprint, key_timestamp, sig_type
-            )))
-        sys.stdout.flush()
+            ))
 
     def eula_required(self, eula_id, package_id, vendor_name, license_agreement):
         '''
@@ -338,10 +380,9 @@ class PackageKitBaseBackend:
         @param vendor_name:     Name of the vendor that wrote the EULA
         @param license_agreement: The license text
         '''
-        sys.stdout.write(_to_utf8("eula-required\t%s\t%s\t%s\t%s\n" % (
+        self._write("eula-required\t%s\t%s\t%s\t%s\n" % (
             eula_id, package_id, vendor_name, license_agreement
-            )))
-        sys.stdout.flush()
+            ))
 
 #
 # Backend Action Methods
@@ -60,12 +60,24 @@
  */
 #define PK_BACKEND_CANCEL_ACTION_TIMEOUT	2000 /* ms */
 
+/**
+ * PK_BACKEND_JOB_QUEUE_BATCH:
+ *
+ * The maximum number of queued events delivered in one main loop
+ * iteration, so that a backend emitting thousands of packages cannot
+ * starve the D-Bus connection or other transactions.
+ */
+#define PK_BACKEND_JOB_QUEUE_BATCH		200
+
 typedef struct {
 	gboolean		 enabled;
 	PkBackendJobVFunc	 vfunc;
 	gpointer		 user_data;
 } PkBackendJobVFuncItem;
 
+/* number of package records allocated at once */
+#define PK_BACKEND_JOB_PACKAGE_BLOCK		1024
+
 struct PkBackendJobPrivate
 {
 	gboolean		 finished;
@@ -76,6 +88,7 @@ struct PkBackendJobPrivate
 	gchar			*cmdline;
 	gchar			*frontend_socket;
 	gchar			*locale;
+	gchar			*plan_token;
 	gchar			*no_proxy;
 	gchar			*pac;
 	gchar			*proxy_ftp;
@@ -102,11 +115,19 @@ struct PkBackendJobPrivate
 	gboolean		 interactive;
 	gboolean		 locked;
 	GHashTable		*emitted;
+	GStringChunk		*package_strings;
+	GPtrArray		*package_blocks;
+	guint			 package_block_used;
 	PkErrorEnum		 last_error_code;
 	PkRoleEnum		 role;
 	PkStatusEnum		 status;
 	GTimer			*timer;
 	gboolean		 started;
+	GAsyncQueue		*queue;
+	gint			 queue_scheduled;
+	guint			 queue_depth_max;
+	guint			 queue_dispatches;
+	guint			 queue_events;
 };
 
 G_DEFINE_TYPE (PkBackendJob, pk_backend_job, G_TYPE_OBJECT)
@@ -408,6 +429,34 @@ pk_backend_job_set_frontend_socket (PkBackendJob *job, const gchar *frontend_soc
 	job->priv->frontend_socket = g_strdup (frontend_socket);
 }
 
+/**
+ * pk_backend_job_get_plan_token:
+ *
+ * Gets the token the client used to tie a simulation to the transaction
+ * that follows it, so the backend can reuse the plan it already solved.
+ *
+ * Return value: the plan token, or %NULL for unset
+ **/
+const gchar *
+pk_backend_job_get_plan_token (PkBackendJob *job)
+{
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), NULL);
+	return job->priv->plan_token;
+}
+
+void
+pk_backend_job_set_plan_token (PkBackendJob *job, const gchar *plan_token)
+{
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+
+	if (g_strcmp0 (job->priv->plan_token, plan_token) == 0)
+		return;
+
+	g_debug ("plan-token changed to %s", plan_token);
+	g_free (job->priv->plan_token);
+	job->priv->plan_token = g_strdup (plan_token);
+}
+
 /**
  * pk_backend_job_get_cache_age:
  *
@@ -572,24 +621,90 @@ pk_backend_job_vfunc_event_free (PkBackendJobVFuncHelper *helper)
 {
 	if (helper->destroy_func != NULL)
 		helper->destroy_func (helper->object);
-	g_object_unref (helper->job);
+	if (helper->job != NULL)
+		g_object_unref (helper->job);
 	g_free (helper);
 }
 
-static gboolean
-pk_backend_job_call_vfunc_idle_cb (gpointer user_data)
+static void
+pk_backend_job_vfunc_event_dispatch (PkBackendJob *job,
+				     PkBackendJobVFuncHelper *helper)
 {
-	PkBackendJobVFuncHelper *helper = (PkBackendJobVFuncHelper *) user_data;
 	PkBackendJobVFuncItem *item;
 
 	/* call transaction vfunc on main thread */
-	item = &helper->job->priv->vfunc_items[helper->signal_kind];
+	item = &job->priv->vfunc_items[helper->signal_kind];
 	if (item != NULL && item->vfunc != NULL) {
-		item->vfunc (helper->job, helper->object, item->user_data);
+		item->vfunc (job, helper->object, item->user_data);
 	} else {
 		g_warning ("tried to do signal %s when no longer connected",
 			   pk_backend_job_signal_to_string (helper->signal_kind));
 	}
+}
+
+/*
+ * pk_backend_job_queue_drain:
+ *
+ * Delivers up to @max_events queued events in the order they were emitted,
+ * or all of them if @max_events is zero.
+ */
+static guint
+pk_backend_job_queue_drain (PkBackendJob *job, guint max_events)
+{
+	PkBackendJobVFuncHelper *helper;
+	guint cnt = 0;
+
+	while (max_events == 0 || cnt < max_events) {
+		helper = g_async_queue_try_pop (job->priv->queue);
+		if (helper == NULL)
+			break;
+		pk_backend_job_vfunc_event_dispatch (job, helper);
+		pk_backend_job_vfunc_event_free (helper);
+		cnt++;
+	}
+	job->priv->queue_events += cnt;
+	return cnt;
+}
+
+static gboolean
+pk_backend_job_queue_idle_cb (gpointer user_data)
+{
+	PkBackendJob *job = PK_BACKEND_JOB (user_data);
+	PkBackendJobPrivate *priv = job->priv;
+	guint depth;
+
+	/* record how far the main loop is behind the backend */
+	depth = pk_backend_job_get_queue_depth (job);
+	if (depth > priv->queue_depth_max)
+		priv->queue_depth_max = depth;
+	priv->queue_dispatches++;
+
+	pk_backend_job_queue_drain (job, PK_BACKEND_JOB_QUEUE_BATCH);
+	if (g_async_queue_length (priv->queue) > 0)
+		return G_SOURCE_CONTINUE;
+
+	/* an event may have been pushed before the flag was cleared */
+	g_atomic_int_set (&priv->queue_scheduled, 0);
+	if (g_async_queue_length (priv->queue) > 0 &&
+	    g_atomic_int_compare_and_exchange (&priv->queue_scheduled, 0, 1))
+		return G_SOURCE_CONTINUE;
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+pk_backend_job_call_vfunc_finished_cb (gpointer user_data)
+{
+	PkBackendJobVFuncHelper *helper = (PkBackendJobVFuncHelper *) user_data;
+	PkBackendJob *job = helper->job;
+
+	/* anything emitted before ::Finished() has to be delivered first */
+	pk_backend_job_queue_drain (job, 0);
+	g_debug ("delivered %u events in %u dispatches, max queue depth %u",
+		 job->priv->queue_events,
+		 job->priv->queue_dispatches,
+		 job->priv->queue_depth_max);
+
+	pk_backend_job_vfunc_event_dispatch (job, helper);
 	return FALSE;
 }
 
@@ -598,6 +713,9 @@ pk_backend_job_call_vfunc_idle_cb (gpointer user_data)
  *
  * This method can be called in any thread, and the vfunc is guaranteed
  * to be called idle in the main thread.
+ *
+ * Events are pushed onto a per-job queue which is drained by a single
+ * idle source, rather than one source being created for each event.
  **/
 static void
 pk_backend_job_call_vfunc (PkBackendJob *job,
@@ -607,7 +725,6 @@ pk_backend_job_call_vfunc (PkBackendJob *job,
 {
 	PkBackendJobVFuncHelper *helper;
 	PkBackendJobVFuncItem *item;
-	guint priority = G_PRIORITY_DEFAULT_IDLE;
 	g_autoptr(GSource) source = NULL;
 
 	/* call transaction vfunc if not disabled and set */
@@ -615,26 +732,67 @@ pk_backend_job_call_vfunc (PkBackendJob *job,
 	if (!item->enabled || item->vfunc == NULL)
 		return;
 
-	/* order this last if others are still pending */
-	if (signal_kind == PK_BACKEND_SIGNAL_FINISHED)
-		priority = G_PRIORITY_LOW;
-
-	/* emit idle */
 	helper = g_new0 (PkBackendJobVFuncHelper, 1);
-	helper->job = g_object_ref (job);
 	helper->signal_kind = signal_kind;
 	helper->object = object;
 	helper->destroy_func = destroy_func;
+
+	/* order this last, after the queue has been drained */
+	if (signal_kind == PK_BACKEND_SIGNAL_FINISHED) {
+		helper->job = g_object_ref (job);
+		source = g_idle_source_new ();
+		g_source_set_priority (source, G_PRIORITY_LOW);
+		g_source_set_callback (source,
+				       pk_backend_job_call_vfunc_finished_cb,
+				       helper,
+				       (GDestroyNotify) pk_backend_job_vfunc_event_free);
+		g_source_set_name (source, "[PkBackendJob] finished_cb");
+		g_source_attach (source, NULL);
+		return;
+	}
+
+	/* only the first event since the last drain needs to schedule one */
+	g_async_queue_push (job->priv->queue, helper);
+	if (!g_atomic_int_compare_and_exchange (&job->priv->queue_scheduled, 0, 1))
+		return;
 	source = g_idle_source_new ();
-	g_source_set_priority (source, priority);
+	g_source_set_priority (source, G_PRIORITY_DEFAULT_IDLE);
 	g_source_set_callback (source,
-			       pk_backend_job_call_vfunc_idle_cb,
-			       helper,
-			       (GDestroyNotify) pk_backend_job_vfunc_event_free);
-	g_source_set_name (source, "[PkBackendJob] idle_event_cb");
+			       pk_backend_job_queue_idle_cb,
+			       g_object_ref (job),
+			       (GDestroyNotify) g_object_unref);
+	g_source_set_name (source, "[PkBackendJob] queue_idle_cb");
 	g_source_attach (source, NULL);
 }
 
+/**
+ * pk_backend_job_get_queue_depth:
+ *
+ * Return value: the number of events emitted by the backend that have
+ * not yet been delivered in the main thread
+ **/
+guint
+pk_backend_job_get_queue_depth (PkBackendJob *job)
+{
+	gint len;
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), 0);
+	len = g_async_queue_length (job->priv->queue);
+	return len > 0 ? (guint) len : 0;
+}
+
+/**
+ * pk_backend_job_get_queue_depth_max:
+ *
+ * Return value: the largest number of undelivered events seen by the
+ * main thread, which is a measure of how far it fell behind the backend
+ **/
+guint
+pk_backend_job_get_queue_depth_max (PkBackendJob *job)
+{
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), 0);
+	return job->priv->queue_depth_max;
+}
+
 /**
  * pk_backend_job_set_vfunc:
  * @job: A valid PkBackendJob
@@ -955,6 +1113,70 @@ pk_backend_job_set_status (PkBackendJob *job, PkStatusEnum status)
 				   NULL);
 }
 
+/*
+ * pk_backend_job_package_alloc:
+ *
+ * Package records are allocated in fixed size blocks and their strings
+ * are stored in a per-job string chunk, so a large listing does not cost
+ * several small allocations per package. A record is never changed or
+ * freed once it has been emitted, as the vfunc may run after the backend
+ * has emitted the same package-id again.
+ */
+static PkBackendJobPackage *
+pk_backend_job_package_alloc (PkBackendJob *job)
+{
+	PkBackendJobPrivate *priv = job->priv;
+	PkBackendJobPackage *block;
+
+	if (priv->package_blocks->len == 0 ||
+	    priv->package_block_used == PK_BACKEND_JOB_PACKAGE_BLOCK) {
+		block = g_new (PkBackendJobPackage, PK_BACKEND_JOB_PACKAGE_BLOCK);
+		g_ptr_array_add (priv->package_blocks, block);
+		priv->package_block_used = 0;
+	}
+	block = g_ptr_array_index (priv->package_blocks,
+				   priv->package_blocks->len - 1);
+	return &block[priv->package_block_used++];
+}
+
+/* the same checks as pk_package_set_id(), without copying the string */
+static gboolean
+pk_backend_job_package_id_valid (const gchar *package_id)
+{
+	guint cnt = 0;
+
+	if (package_id[0] == ';')
+		return FALSE;
+	for (guint i = 0; package_id[i] != '\0'; i++) {
+		if (package_id[i] == ';')
+			cnt++;
+	}
+	return cnt == 3;
+}
+
+/**
+ * pk_backend_job_package_to_package:
+ * @item: a #PkBackendJobPackage
+ *
+ * Copies the record emitted by the backend, for keeping it in results.
+ *
+ * Return value: (transfer full): a new #PkPackage
+ **/
+PkPackage *
+pk_backend_job_package_to_package (const PkBackendJobPackage *item)
+{
+	PkPackage *package = pk_package_new ();
+	g_autoptr(GError) error = NULL;
+
+	/* the package-id was checked when it was emitted */
+	if (!pk_package_set_id (package, item->package_id, &error))
+		g_warning ("failed to set package-id: %s", error->message);
+	pk_package_set_info (package, item->info);
+	pk_package_set_update_severity (package, item->update_severity);
+	pk_package_set_summary (package, item->summary);
+	return package;
+}
+
 void
 pk_backend_job_package (PkBackendJob *job,
 			PkInfoEnum info,
@@ -971,35 +1193,40 @@ pk_backend_job_package_full (PkBackendJob *job,
 			     const gchar *summary,
 			     PkInfoEnum update_severity)
 {
-	PkPackage *emitted_item;
-	gboolean ret;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(PkPackage) item = NULL;
+	PkBackendJobPackage *emitted;
+	PkBackendJobPackage *item;
 
 	g_return_if_fail (PK_IS_BACKEND_JOB (job));
 	g_return_if_fail (package_id != NULL);
 
+	/* already emitted? */
+	emitted = g_hash_table_lookup (job->priv->emitted, package_id);
+	if (emitted != NULL &&
+	    emitted->info == info &&
+	    g_strcmp0 (emitted->summary, summary) == 0)
+		return;
+
 	/* check we are valid */
-	item = pk_package_new ();
-	ret = pk_package_set_id (item, package_id, &error);
-	if (!ret) {
-		g_warning ("package_id %s invalid and cannot be processed: %s",
-			   package_id, error->message);
+	if (emitted == NULL && !pk_backend_job_package_id_valid (package_id)) {
+		g_warning ("package_id %s invalid and cannot be processed",
+			   package_id);
 		return;
 	}
-	pk_package_set_info (item, info);
-	pk_package_set_update_severity (item, update_severity);
-	pk_package_set_summary (item, summary);
 
-	/* already emitted? */
-	emitted_item = g_hash_table_lookup (job->priv->emitted, pk_package_get_id (item));
-	if (emitted_item != NULL && pk_package_equal (emitted_item, item))
-		return;
+	item = pk_backend_job_package_alloc (job);
+	item->package_id = emitted != NULL ? emitted->package_id :
+			   g_string_chunk_insert (job->priv->package_strings, package_id);
+
+	/* summaries are often shared between subpackages */
+	item->summary = NULL;
+	if (summary != NULL)
+		item->summary = g_string_chunk_insert_const (job->priv->package_strings,
+							     summary);
+	item->info = info;
+	item->update_severity = update_severity;
 
 	/* update the emitted package table */
-	g_hash_table_insert (job->priv->emitted,
-	                     g_strdup (pk_package_get_id (item)),
-	                     g_object_ref (item));
+	g_hash_table_insert (job->priv->emitted, (gpointer) item->package_id, item);
 
 	/* have we already set an error? */
 	if (job->priv->set_error) {
@@ -1027,8 +1254,8 @@ pk_backend_job_package_full (PkBackendJob *job,
 	/* emit */
 	pk_backend_job_call_vfunc (job,
 				   PK_BACKEND_SIGNAL_PACKAGE,
-				   g_object_ref (item),
-				   g_object_unref);
+				   item,
+				   NULL);
 }
 
 void
@@ -1690,7 +1917,11 @@ pk_backend_job_finalize (GObject *object)
 	g_free (job->priv->cmdline);
 	g_free (job->priv->locale);
 	g_free (job->priv->frontend_socket);
+	g_free (job->priv->plan_token);
 	g_hash_table_unref (job->priv->emitted);
+	g_string_chunk_free (job->priv->package_strings);
+	g_ptr_array_unref (job->priv->package_blocks);
+	g_async_queue_unref (job->priv->queue);
 	if (job->priv->params != NULL)
 		g_variant_unref (job->priv->params);
 	g_timer_destroy (job->priv->timer);
@@ -1721,8 +1952,10 @@ pk_backend_job_init (PkBackendJob *job)
 	job->priv->exit = PK_EXIT_ENUM_UNKNOWN;
 	job->priv->role = PK_ROLE_ENUM_UNKNOWN;
 	job->priv->status = PK_STATUS_ENUM_UNKNOWN;
-	job->priv->emitted = g_hash_table_new_full (g_str_hash, g_str_equal,
-	                                            g_free, (GDestroyNotify) g_object_unref);
+	job->priv->emitted = g_hash_table_new (g_str_hash, g_str_equal);
+	job->priv->package_strings = g_string_chunk_new (64 * 1024);
+	job->priv->package_blocks = g_ptr_array_new_with_free_func (g_free);
+	job->priv->queue = g_async_queue_new_full ((GDestroyNotify) pk_backend_job_vfunc_event_free);
 }
 
 /**
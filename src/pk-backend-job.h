@@ -26,6 +26,7 @@
 
 #include "pk-shared.h"
 #include <packagekit-glib2/pk-bitfield.h>
+#include <packagekit-glib2/pk-package.h>
 
 G_BEGIN_DECLS
 
@@ -78,6 +79,24 @@ typedef struct
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(PkBackendJob, g_object_unref)
 #endif
 
+/**
+ * PkBackendJobPackage:
+ * @package_id: the package-id
+ * @summary: the summary, or %NULL
+ * @info: the #PkInfoEnum
+ * @update_severity: the #PkInfoEnum severity of the update
+ *
+ * A package emitted by the backend, passed to the
+ * %PK_BACKEND_SIGNAL_PACKAGE vfunc. The record and the strings belong to
+ * the job, so use pk_backend_job_package_to_package() to keep it.
+ **/
+typedef struct {
+	const gchar		*package_id;
+	const gchar		*summary;
+	PkInfoEnum		 info;
+	PkInfoEnum		 update_severity;
+} PkBackendJobPackage;
+
 GType		 pk_backend_job_get_type		(void);
 PkBackendJob	*pk_backend_job_new			(GKeyFile		*conf);
 
@@ -115,6 +134,8 @@ gboolean	 pk_backend_job_has_set_error_code	(PkBackendJob	*job);
 guint		 pk_backend_job_get_runtime		(PkBackendJob	*job);
 gboolean	 pk_backend_job_get_is_finished		(PkBackendJob	*job);
 gboolean	 pk_backend_job_get_is_error_set	(PkBackendJob	*job);
+guint		 pk_backend_job_get_queue_depth		(PkBackendJob	*job);
+guint		 pk_backend_job_get_queue_depth_max	(PkBackendJob	*job);
 gboolean	 pk_backend_job_get_allow_cancel	(PkBackendJob	*job);
 void		 pk_backend_job_set_proxy		(PkBackendJob	*job,
 							 const gchar	*proxy_http,
@@ -135,6 +156,8 @@ void		 pk_backend_job_set_frontend_socket	(PkBackendJob	*job,
 							 const gchar	*frontend_socket);
 void		 pk_backend_job_set_cache_age		(PkBackendJob	*job,
 							 guint		 cache_age);
+void		 pk_backend_job_set_plan_token		(PkBackendJob	*job,
+							 const gchar	*plan_token);
 const gchar	*pk_backend_job_get_proxy_ftp		(PkBackendJob	*job);
 const gchar	*pk_backend_job_get_proxy_http		(PkBackendJob	*job);
 const gchar	*pk_backend_job_get_proxy_https		(PkBackendJob	*job);
@@ -144,6 +167,7 @@ const gchar	*pk_backend_job_get_pac			(PkBackendJob	*job);
 const gchar	*pk_backend_job_get_locale		(PkBackendJob	*job);
 const gchar	*pk_backend_job_get_frontend_socket	(PkBackendJob	*job);
 guint		 pk_backend_job_get_cache_age		(PkBackendJob	*job);
+const gchar	*pk_backend_job_get_plan_token		(PkBackendJob	*job);
 
 /* transaction vfuncs */
 typedef void	 (*PkBackendJobVFunc)			(PkBackendJob	*job,
@@ -178,6 +202,7 @@ void		 pk_backend_job_package_full		(PkBackendJob	*job,
 							 const gchar	*package_id,
 							 const gchar	*summary,
 							 PkInfoEnum	 update_severity);
+PkPackage	*pk_backend_job_package_to_package	(const PkBackendJobPackage *item);
 void		 pk_backend_job_repo_detail		(PkBackendJob	*job,
 							 const gchar	*repo_id,
 							 const gchar	*description,
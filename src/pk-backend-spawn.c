@@ -124,14 +124,88 @@ pk_backend_spawn_start_kill_timer (PkBackendSpawn *backend_spawn)
 	g_source_set_name_by_id (priv->kill_id, "[PkBackendSpawn] exit");
 }
 
+/* the commands a helper can send, the values are used as the command id in
+ * framed output so new commands must only ever be appended */
+typedef enum {
+	PK_BACKEND_SPAWN_COMMAND_UNKNOWN,
+	PK_BACKEND_SPAWN_COMMAND_PACKAGE,
+	PK_BACKEND_SPAWN_COMMAND_DETAILS,
+	PK_BACKEND_SPAWN_COMMAND_FINISHED,
+	PK_BACKEND_SPAWN_COMMAND_FILES,
+	PK_BACKEND_SPAWN_COMMAND_REPO_DETAIL,
+	PK_BACKEND_SPAWN_COMMAND_UPDATEDETAIL,
+	PK_BACKEND_SPAWN_COMMAND_PERCENTAGE,
+	PK_BACKEND_SPAWN_COMMAND_ITEM_PROGRESS,
+	PK_BACKEND_SPAWN_COMMAND_ERROR,
+	PK_BACKEND_SPAWN_COMMAND_REQUIRERESTART,
+	PK_BACKEND_SPAWN_COMMAND_STATUS,
+	PK_BACKEND_SPAWN_COMMAND_SPEED,
+	PK_BACKEND_SPAWN_COMMAND_DOWNLOAD_SIZE_REMAINING,
+	PK_BACKEND_SPAWN_COMMAND_ALLOW_CANCEL,
+	PK_BACKEND_SPAWN_COMMAND_NO_PERCENTAGE_UPDATES,
+	PK_BACKEND_SPAWN_COMMAND_REPO_SIGNATURE_REQUIRED,
+	PK_BACKEND_SPAWN_COMMAND_EULA_REQUIRED,
+	PK_BACKEND_SPAWN_COMMAND_MEDIA_CHANGE_REQUIRED,
+	PK_BACKEND_SPAWN_COMMAND_DISTRO_UPGRADE,
+	PK_BACKEND_SPAWN_COMMAND_CATEGORY,
+	PK_BACKEND_SPAWN_COMMAND_LAST
+} PkBackendSpawnCommand;
+
+static const gchar *pk_backend_spawn_command_names[] = {
+	NULL,
+	"package",
+	"details",
+	"finished",
+	"files",
+	"repo-detail",
+	"updatedetail",
+	"percentage",
+	"item-progress",
+	"error",
+	"requirerestart",
+	"status",
+	"speed",
+	"download-size-remaining",
+	"allow-cancel",
+	"no-percentage-updates",
+	"repo-signature-required",
+	"eula-required",
+	"media-change-required",
+	"distro-upgrade",
+	"category",
+};
+G_STATIC_ASSERT (G_N_ELEMENTS (pk_backend_spawn_command_names) == PK_BACKEND_SPAWN_COMMAND_LAST);
+
+/* more than any command takes */
+#define PK_BACKEND_SPAWN_SECTIONS_MAX	16
+
+static PkBackendSpawnCommand
+pk_backend_spawn_command_from_string (const gchar *command)
+{
+	static GHashTable *commands = NULL;
+	guint i;
+
+	/* only ever used from the main thread */
+	if (commands == NULL) {
+		commands = g_hash_table_new (g_str_hash, g_str_equal);
+		for (i = 1; i < PK_BACKEND_SPAWN_COMMAND_LAST; i++) {
+			g_hash_table_insert (commands,
+					     (gpointer) pk_backend_spawn_command_names[i],
+					     GUINT_TO_POINTER (i));
+		}
+	}
+	return GPOINTER_TO_UINT (g_hash_table_lookup (commands, command));
+}
+
 static gboolean
-pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
-			       PkBackendJob *job,
-			       const gchar *line,
-			       GError **error)
+pk_backend_spawn_dispatch (PkBackendSpawn *backend_spawn,
+			   PkBackendJob *job,
+			   PkBackendSpawnCommand command_id,
+			   gchar **sections,
+			   guint size,
+			   GError **error)
 {
-	guint size;
-	gchar *command;
+	const gchar *command = sections[0];
 	gchar *text;
 	guint64 speed;
 	guint64 download_size_remaining;
@@ -148,22 +222,15 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 	PkMediaTypeEnum media_type_enum;
 	PkDistroUpgradeEnum distro_upgrade_enum;
 	PkBackendSpawnPrivate *priv = backend_spawn->priv;
-	g_auto(GStrv) sections = NULL;
-
-	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
-
-	/* check if output line */
-	if (line == NULL)
-		return FALSE;
-
-	/* split by tab */
-	sections = g_strsplit (line, "\t", 0);
-	command = sections[0];
-
-	/* get size */
-	size = g_strv_length (sections);
-
-	if (g_strcmp0 (command, "package") == 0) {
+	g_auto(GStrv) tmp = NULL;
+	g_auto(GStrv) updates = NULL;
+	g_auto(GStrv) obsoletes = NULL;
+	g_auto(GStrv) vendor_urls = NULL;
+	g_auto(GStrv) bugzilla_urls = NULL;
+	g_auto(GStrv) cve_urls = NULL;
+
+	switch (command_id) {
+	case PK_BACKEND_SPAWN_COMMAND_PACKAGE:
 		if (size != 4) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -185,7 +252,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			return FALSE;
 		}
 		pk_backend_job_package (job, info, sections[2], sections[3]);
-	} else if (g_strcmp0 (command, "details") == 0) {
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_DETAILS:
 		if (size != 8) {
 			g_set_error (error, 1, 0,
 				     "invalid command'%s', size %i",
@@ -214,7 +282,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		pk_backend_job_details (job, sections[1], sections[2], sections[3],
 					group, text, sections[6], package_size);
 		g_free (text);
-	} else if (g_strcmp0 (command, "finished") == 0) {
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_FINISHED:
 		if (size != 1) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -225,15 +294,16 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		/* from this point on, we can start the kill timer */
 		pk_backend_spawn_start_kill_timer (backend_spawn);
 
-	} else if (g_strcmp0 (command, "files") == 0) {
-		g_auto(GStrv) tmp = NULL;
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_FILES:
 		if (size != 3) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
 		}
 		tmp = g_strsplit (sections[2], ";", -1);
 		pk_backend_job_files (job, sections[1], tmp);
-	} else if (g_strcmp0 (command, "repo-detail") == 0) {
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_REPO_DETAIL:
 		if (size != 4) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -253,12 +323,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			g_set_error (error, 1, 0, "invalid qualifier '%s'", sections[3]);
 			return FALSE;
 		}
-	} else if (g_strcmp0 (command, "updatedetail") == 0) {
-		g_auto(GStrv) updates = NULL;
-		g_auto(GStrv) obsoletes = NULL;
-		g_auto(GStrv) vendor_urls = NULL;
-		g_auto(GStrv) bugzilla_urls = NULL;
-		g_auto(GStrv) cve_urls = NULL;
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_UPDATEDETAIL:
 		if (size != 13) {
 			g_set_error (error, 1, 0, "invalid command '%s', size %i", command, size);
 			return FALSE;
@@ -297,7 +363,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 					  update_state_enum,
 					  sections[11],
 					  sections[12]);
-	} else if (g_strcmp0 (command, "percentage") == 0) {
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_PERCENTAGE:
 		if (size != 2) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -311,7 +378,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		} else {
 			pk_backend_job_set_percentage (job, percentage);
 		}
-	} else if (g_strcmp0 (command, "item-progress") == 0) {
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_ITEM_PROGRESS:
 		if (size != 4) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -337,7 +405,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 						  sections[1],
 						  status_enum,
 						  percentage);
-	} else if (g_strcmp0 (command, "error") == 0) {
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_ERROR:
 		if (size != 3) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -358,7 +427,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 
 		pk_backend_job_error_code (job, error_enum, "%s", text);
 		g_free (text);
-	} else if (g_strcmp0 (command, "requirerestart") == 0) {
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_REQUIRERESTART:
 		if (size != 3) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -373,7 +443,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			return FALSE;
 		}
 		pk_backend_job_require_restart (job, restart_enum, sections[2]);
-	} else if (g_strcmp0 (command, "status") == 0) {
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_STATUS:
 		if (size != 2) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -384,7 +455,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			return FALSE;
 		}
 		pk_backend_job_set_status (job, status_enum);
-	} else if (g_strcmp0 (command, "speed") == 0) {
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_SPEED:
 		if (size != 2) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -396,7 +468,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			return FALSE;
 		}
 		pk_backend_job_set_speed (job, speed);
-	} else if (g_strcmp0 (command, "download-size-remaining") == 0) {
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_DOWNLOAD_SIZE_REMAINING:
 		if (size != 2) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -408,7 +481,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			return FALSE;
 		}
 		pk_backend_job_set_download_size_remaining (job, download_size_remaining);
-	} else if (g_strcmp0 (command, "allow-cancel") == 0) {
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_ALLOW_CANCEL:
 		if (size != 2) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -421,14 +495,15 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			g_set_error (error, 1, 0, "invalid section '%s'", sections[1]);
 			return FALSE;
 		}
-	} else if (g_strcmp0 (command, "no-percentage-updates") == 0) {
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_NO_PERCENTAGE_UPDATES:
 		if (size != 1) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
 		}
 		pk_backend_job_set_percentage (job, PK_BACKEND_PERCENTAGE_INVALID);
-	} else if (g_strcmp0 (command, "repo-signature-required") == 0) {
-
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_REPO_SIGNATURE_REQUIRED:
 		if (size != 9) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -452,8 +527,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		pk_backend_job_repo_signature_required (job, sections[1],
 							  sections[2], sections[3], sections[4],
 							  sections[5], sections[6], sections[7], sig_type);
-	} else if (g_strcmp0 (command, "eula-required") == 0) {
-
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_EULA_REQUIRED:
 		if (size != 5) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -475,8 +550,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		}
 
 		pk_backend_job_eula_required (job, sections[1], sections[2], sections[3], sections[4]);
-	} else if (g_strcmp0 (command, "media-change-required") == 0) {
-
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_MEDIA_CHANGE_REQUIRED:
 		if (size != 4) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -489,8 +564,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		}
 
 		pk_backend_job_media_change_required (job, media_type_enum, sections[2], sections[3]);
-	} else if (g_strcmp0 (command, "distro-upgrade") == 0) {
-
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_DISTRO_UPGRADE:
 		if (size != 4) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -510,8 +585,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		}
 
 		pk_backend_job_distro_upgrade (job, distro_upgrade_enum, sections[2], sections[3]);
-	} else if (g_strcmp0 (command, "category") == 0) {
-
+		break;
+	case PK_BACKEND_SPAWN_COMMAND_CATEGORY:
 		if (size != 6) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
 			return FALSE;
@@ -544,13 +619,97 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			return FALSE;
 		}
 		pk_backend_job_category (job, sections[1], sections[2], sections[3], sections[4], sections[5]);
-	} else {
+		break;
+	default:
 		g_set_error (error, 1, 0, "invalid command '%s'", command);
 		return FALSE;
 	}
 	return TRUE;
 }
 
+static gboolean
+pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
+			       PkBackendJob *job,
+			       const gchar *line,
+			       GError **error)
+{
+	gchar *sections[PK_BACKEND_SPAWN_SECTIONS_MAX + 1];
+	gchar *tmp;
+	guint size = 1;
+	g_autofree gchar *buf = NULL;
+
+	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
+
+	/* check if output line */
+	if (line == NULL)
+		return FALSE;
+
+	/* split by tab in place, rather than allocating every section */
+	buf = g_strdup (line);
+	sections[0] = buf;
+	for (tmp = strchr (buf, '\t'); tmp != NULL; tmp = strchr (tmp, '\t')) {
+		if (size == PK_BACKEND_SPAWN_SECTIONS_MAX) {
+			g_set_error (error, 1, 0, "invalid command '%s', too many sections", buf);
+			return FALSE;
+		}
+		*tmp++ = '\0';
+		sections[size++] = tmp;
+	}
+	sections[size] = NULL;
+
+	return pk_backend_spawn_dispatch (backend_spawn, job,
+					  pk_backend_spawn_command_from_string (sections[0]),
+					  sections, size, error);
+}
+
+/*
+ * A frame is a command id byte followed by the sections after the command
+ * name, each one terminated by a NUL byte. As nothing needs escaping and
+ * the command needs no lookup this is cheaper to parse than a line.
+ */
+static gboolean
+pk_backend_spawn_parse_frame (PkBackendSpawn *backend_spawn,
+			      PkBackendJob *job,
+			      gchar *frame,
+			      guint len,
+			      GError **error)
+{
+	gchar *sections[PK_BACKEND_SPAWN_SECTIONS_MAX + 1];
+	gchar *tmp;
+	guint command_id;
+	guint size = 1;
+
+	if (len == 0) {
+		g_set_error_literal (error, 1, 0, "empty frame");
+		return FALSE;
+	}
+	command_id = (guchar) frame[0];
+	if (command_id == PK_BACKEND_SPAWN_COMMAND_UNKNOWN ||
+	    command_id >= PK_BACKEND_SPAWN_COMMAND_LAST) {
+		g_set_error (error, 1, 0, "invalid command id %u", command_id);
+		return FALSE;
+	}
+	if (len > 1 && frame[len - 1] != '\0') {
+		g_set_error (error, 1, 0, "frame for '%s' not terminated",
+			     pk_backend_spawn_command_names[command_id]);
+		return FALSE;
+	}
+
+	sections[0] = (gchar *) pk_backend_spawn_command_names[command_id];
+	for (tmp = frame + 1; tmp < frame + len; tmp += strlen (tmp) + 1) {
+		if (size == PK_BACKEND_SPAWN_SECTIONS_MAX) {
+			g_set_error (error, 1, 0, "invalid command '%s', too many sections",
+				     sections[0]);
+			return FALSE;
+		}
+		sections[size++] = tmp;
+	}
+	sections[size] = NULL;
+
+	return pk_backend_spawn_dispatch (backend_spawn, job, command_id,
+					  sections, size, error);
+}
+
 static void
 pk_backend_spawn_exit_cb (PkSpawn *spawn, PkSpawnExitType exit_enum, PkBackendSpawn *backend_spawn)
 {
@@ -567,6 +726,13 @@ pk_backend_spawn_exit_cb (PkSpawn *spawn, PkSpawnExitType exit_enum, PkBackendSp
 				       "Process had to be killed to be cancelled");
 	}
 
+	/* we can't know what the rest of the output would have said */
+	if (exit_enum == PK_SPAWN_EXIT_TYPE_INVALID_OUTPUT &&
+	    !backend_spawn->priv->finished) {
+		pk_backend_job_error_code (backend_spawn->priv->job, PK_ERROR_ENUM_INTERNAL_ERROR,
+				       "The backend was killed as it sent output that could not be parsed");
+	}
+
 	if (exit_enum == PK_SPAWN_EXIT_TYPE_DISPATCHER_EXIT ||
 	    exit_enum == PK_SPAWN_EXIT_TYPE_DISPATCHER_CHANGED) {
 		g_debug ("dispatcher exited, nothing to see here");
@@ -617,6 +783,20 @@ pk_backend_spawn_stdout_cb (PkBackendSpawn *spawn, const gchar *line, PkBackendS
 		g_warning ("failed to parse: %s: %s", line, error->message);
 }
 
+static void
+pk_backend_spawn_frame_cb (PkSpawn *spawn, guint len, gchar *frame, PkBackendSpawn *backend_spawn)
+{
+	g_autoptr(GError) error = NULL;
+	if (!pk_backend_spawn_parse_frame (backend_spawn,
+					   backend_spawn->priv->job,
+					   frame, len,
+					   &error)) {
+		g_autofree gchar *reason = NULL;
+		reason = g_strdup_printf ("failed to parse frame: %s", error->message);
+		pk_spawn_reject_output (spawn, reason);
+	}
+}
+
 static void
 pk_backend_spawn_stderr_cb (PkBackendSpawn *spawn, const gchar *line, PkBackendSpawn *backend_spawn)
 {
@@ -752,6 +932,11 @@ pk_backend_spawn_get_envp (PkBackendSpawn *backend_spawn)
 			      g_strdup ("UID"),
 			      g_strdup_printf ("%u", pk_backend_job_get_uid (priv->job)));
 
+	/* FRAMED_OUTPUT, helpers may then send frames rather than lines; a
+	 * stdout filter needs the lines so it is not offered then */
+	if (priv->stdout_func == NULL)
+		g_hash_table_replace (env_table, g_strdup ("FRAMED_OUTPUT"), g_strdup ("TRUE"));
+
 	/* CACHE_AGE */
 	cache_age = pk_backend_job_get_cache_age (priv->job);
 	if (cache_age == G_MAXUINT) {
@@ -1047,6 +1232,8 @@ pk_backend_spawn_new (GKeyFile *conf)
 			  G_CALLBACK (pk_backend_spawn_exit_cb), backend_spawn);
 	g_signal_connect (backend_spawn->priv->spawn, "stdout",
 			  G_CALLBACK (pk_backend_spawn_stdout_cb), backend_spawn);
+	g_signal_connect (backend_spawn->priv->spawn, "frame",
+			  G_CALLBACK (pk_backend_spawn_frame_cb), backend_spawn);
 	g_signal_connect (backend_spawn->priv->spawn, "stderr",
 			  G_CALLBACK (pk_backend_spawn_stderr_cb), backend_spawn);
 	return PK_BACKEND_SPAWN (backend_spawn);
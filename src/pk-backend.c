@@ -58,6 +58,7 @@ typedef struct {
 	PkBitfield	(*get_provides)			(PkBackend	*backend);
 	gchar		**(*get_mime_types)		(PkBackend	*backend);
 	gboolean	(*supports_parallelization)	(PkBackend	*backend);
+	gboolean	(*supports_results_cache)	(PkBackend	*backend);
 	void		(*job_start)			(PkBackend	*backend,
 							 PkBackendJob	*job);
 	void		(*job_stop)			(PkBackend	*backend,
@@ -203,6 +204,7 @@ struct PkBackendPrivate
 	guint			 repo_list_changed_id;
 	guint			 installed_db_changed_id;
 	guint			 updates_changed_id;
+	PkResultsCache		*results_cache;
 };
 
 G_DEFINE_TYPE (PkBackend, pk_backend, G_TYPE_OBJECT)
@@ -252,6 +254,26 @@ pk_backend_supports_parallelization (PkBackend	*backend)
 	return backend->priv->desc->supports_parallelization (backend);
 }
 
+/**
+ * pk_backend_supports_results_cache:
+ *
+ * Backends only opt in when they call pk_backend_installed_db_changed(),
+ * pk_backend_repo_list_changed() and pk_backend_updates_changed() for
+ * changes made outside PackageKit too, as nothing else drops the cache.
+ *
+ * Return value: %TRUE if the results of queries may be reused
+ **/
+gboolean
+pk_backend_supports_results_cache (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
+
+	/* not compulsory */
+	if (backend->priv->desc->supports_results_cache == NULL)
+		return FALSE;
+	return backend->priv->desc->supports_results_cache (backend);
+}
+
 void
 pk_backend_thread_start (PkBackend *backend, PkBackendJob *job, gpointer func)
 {
@@ -512,6 +534,7 @@ pk_backend_load (PkBackend *backend, GError **error)
 		g_module_symbol (handle, "pk_backend_get_groups", (gpointer *)&desc->get_groups);
 		g_module_symbol (handle, "pk_backend_get_mime_types", (gpointer *)&desc->get_mime_types);
 		g_module_symbol (handle, "pk_backend_supports_parallelization", (gpointer *)&desc->supports_parallelization);
+		g_module_symbol (handle, "pk_backend_supports_results_cache", (gpointer *)&desc->supports_results_cache);
 		g_module_symbol (handle, "pk_backend_get_packages", (gpointer *)&desc->get_packages);
 		g_module_symbol (handle, "pk_backend_get_repo_list", (gpointer *)&desc->get_repo_list);
 		g_module_symbol (handle, "pk_backend_required_by", (gpointer *)&desc->required_by);
@@ -620,6 +643,9 @@ pk_backend_repo_list_changed (PkBackend *backend)
 	g_return_if_fail (PK_IS_BACKEND (backend));
 	g_return_if_fail (backend->priv->loaded);
 
+	/* queries may give different results now */
+	pk_results_cache_invalidate (backend->priv->results_cache, "the repo list changed");
+
 	/* already scheduled */
 	if (backend->priv->repo_list_changed_id != 0)
 		return;
@@ -635,6 +661,7 @@ pk_backend_updates_changed (PkBackend *backend)
 	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
 	g_return_val_if_fail (pk_is_thread_default (), FALSE);
 
+	pk_results_cache_invalidate (backend->priv->results_cache, "the updates changed");
 	g_debug ("emitting updates-changed");
 	g_signal_emit (backend, signals [SIGNAL_UPDATES_CHANGED], 0);
 	return TRUE;
@@ -704,6 +731,9 @@ pk_backend_installed_db_changed (PkBackend *backend)
 	g_return_if_fail (PK_IS_BACKEND (backend));
 	g_return_if_fail (backend->priv->loaded);
 
+	/* do this right away, not when idle, so no stale results are used */
+	pk_results_cache_invalidate (backend->priv->results_cache, "the installed packages changed");
+
 	/* already scheduled */
 	if (backend->priv->installed_db_changed_id != 0)
 		return;
@@ -713,6 +743,19 @@ pk_backend_installed_db_changed (PkBackend *backend)
 		g_idle_add (pk_backend_installed_db_changed_cb, backend);
 }
 
+/**
+ * pk_backend_get_results_cache:
+ *
+ * Returns: (transfer none): the results of read-only transactions that
+ * can be reused until something changes
+ **/
+PkResultsCache *
+pk_backend_get_results_cache (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+	return backend->priv->results_cache;
+}
+
 /**
  * pk_backend_transaction_inhibit_start:
  *
@@ -1074,6 +1117,7 @@ pk_backend_finalize (GObject *object)
 	g_mutex_clear (&backend->priv->eulas_mutex);
 	g_mutex_clear (&backend->priv->thread_hash_mutex);
 	g_hash_table_unref (backend->priv->thread_hash);
+	g_object_unref (backend->priv->results_cache);
 	g_free (backend->priv->desc);
 
 	if (backend->priv->monitor != NULL)
@@ -1717,6 +1761,7 @@ pk_backend_init (PkBackend *backend)
 							    g_free);
 	g_mutex_init (&backend->priv->eulas_mutex);
 	g_mutex_init (&backend->priv->thread_hash_mutex);
+	backend->priv->results_cache = pk_results_cache_new ();
 }
 
 PkBackend *
@@ -36,6 +36,7 @@
 
 #include "pk-backend.h"
 #include "pk-backend-job.h"
+#include "pk-results-cache.h"
 
 G_BEGIN_DECLS
 
@@ -85,6 +86,7 @@ gboolean	 pk_backend_is_implemented		(PkBackend	*backend,
 gchar		*pk_backend_get_accepted_eula_string	(PkBackend	*backend);
 void		 pk_backend_repo_list_changed		(PkBackend      *backend);
 void		 pk_backend_installed_db_changed	(PkBackend      *backend);
+PkResultsCache	*pk_backend_get_results_cache		(PkBackend	*backend);
 
 
 gboolean	 pk_backend_updates_changed		(PkBackend	*backend);
@@ -119,6 +121,7 @@ PkBitfield	 pk_backend_get_filters			(PkBackend	*backend);
 PkBitfield	 pk_backend_get_roles			(PkBackend	*backend);
 gchar		**pk_backend_get_mime_types		(PkBackend	*backend);
 gboolean	 pk_backend_supports_parallelization	(PkBackend	*backend);
+gboolean	 pk_backend_supports_results_cache	(PkBackend	*backend);
 void		 pk_backend_initialize			(GKeyFile		*conf,
 							 PkBackend	*backend);
 void		 pk_backend_destroy			(PkBackend	*backend);
@@ -350,10 +350,10 @@ pk_direct_status_changed_cb (PkBackendJob *job, gpointer object, gpointer user_d
 static void
 pk_direct_package_cb (PkBackendJob *job, gpointer object, gpointer user_data)
 {
-	PkPackage *pkg = PK_PACKAGE (object);
+	PkBackendJobPackage *pkg = (PkBackendJobPackage *) object;
 	g_print ("Package: %s\t%s\n",
-		 pk_info_enum_to_string (pk_package_get_info (pkg)),
-		 pk_package_get_id (pkg));
+		 pk_info_enum_to_string (pkg->info),
+		 pkg->package_id);
 }
 
 static void
@@ -0,0 +1,358 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "pk-results-cache.h"
+
+static void     pk_results_cache_finalize	(GObject        *object);
+
+#define PK_RESULTS_CACHE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_RESULTS_CACHE, PkResultsCachePrivate))
+
+/* the oldest results are dropped when there are more than this many
+ * entries, or more than this many items in all the entries together */
+#define PK_RESULTS_CACHE_ENTRIES_MAX	16
+#define PK_RESULTS_CACHE_ITEMS_MAX	200000
+
+/*
+ * The results of read-only transactions, keyed on the role and everything
+ * the results depend on. Anything that could change the results bumps the
+ * generation and drops every entry, and results are only added if nothing
+ * changed while the transaction that produced them was running.
+ *
+ * A handful of results can each be large, so besides the number of entries
+ * the total number of packages, details, files and so on is bounded too.
+ *
+ * Invalidation may come from any thread.
+ */
+struct PkResultsCachePrivate
+{
+	GMutex			 mutex;
+	GHashTable		*entries;
+	GQueue			*keys;
+	guint			 items;
+	guint			 items_max;
+	guint			 generation;
+	guint			 hits;
+	guint			 misses;
+};
+
+typedef struct {
+	PkResults		*results;
+	guint			 items;
+} PkResultsCacheEntry;
+
+G_DEFINE_TYPE (PkResultsCache, pk_results_cache, G_TYPE_OBJECT)
+
+static void
+pk_results_cache_entry_free (PkResultsCacheEntry *entry)
+{
+	g_object_unref (entry->results);
+	g_free (entry);
+}
+
+/* roughly how much memory the results hold on to */
+static guint
+pk_results_cache_count_items (PkResults *results)
+{
+	GPtrArray *(*getters[])(PkResults *) = {
+		pk_results_get_package_array,
+		pk_results_get_details_array,
+		pk_results_get_update_detail_array,
+		pk_results_get_category_array,
+		pk_results_get_distro_upgrade_array,
+		pk_results_get_require_restart_array,
+		pk_results_get_transaction_array,
+		pk_results_get_files_array,
+		pk_results_get_repo_signature_required_array,
+		pk_results_get_eula_required_array,
+		pk_results_get_media_change_required_array,
+		pk_results_get_repo_detail_array,
+		NULL };
+	guint i;
+	guint items = 0;
+
+	for (i = 0; getters[i] != NULL; i++) {
+		g_autoptr(GPtrArray) array = getters[i] (results);
+		if (array != NULL)
+			items += array->len;
+	}
+	return items;
+}
+
+/* must be called with the mutex held */
+static void
+pk_results_cache_remove_oldest (PkResultsCache *cache)
+{
+	PkResultsCacheEntry *entry;
+	PkResultsCachePrivate *priv = cache->priv;
+	gchar *key;
+
+	key = g_queue_pop_head (priv->keys);
+	entry = g_hash_table_lookup (priv->entries, key);
+	priv->items -= entry->items;
+	g_hash_table_remove (priv->entries, key);
+}
+
+/**
+ * pk_results_cache_set_items_max:
+ * @items_max: the most items to keep in all the entries together
+ *
+ * Only useful for the self tests, the default is sensible.
+ **/
+void
+pk_results_cache_set_items_max (PkResultsCache *cache, guint items_max)
+{
+	g_return_if_fail (PK_IS_RESULTS_CACHE (cache));
+
+	g_mutex_lock (&cache->priv->mutex);
+	cache->priv->items_max = items_max;
+	while (cache->priv->items > items_max)
+		pk_results_cache_remove_oldest (cache);
+	g_mutex_unlock (&cache->priv->mutex);
+}
+
+/**
+ * pk_results_cache_get_generation:
+ *
+ * Returns: the generation to pass to pk_results_cache_add() for results
+ * produced from this point on
+ **/
+guint
+pk_results_cache_get_generation (PkResultsCache *cache)
+{
+	guint generation;
+
+	g_return_val_if_fail (PK_IS_RESULTS_CACHE (cache), 0);
+
+	g_mutex_lock (&cache->priv->mutex);
+	generation = cache->priv->generation;
+	g_mutex_unlock (&cache->priv->mutex);
+	return generation;
+}
+
+/**
+ * pk_results_cache_invalidate:
+ * @reason: what changed, for debugging
+ *
+ * Drops all the cached results, and any still being produced.
+ **/
+void
+pk_results_cache_invalidate (PkResultsCache *cache, const gchar *reason)
+{
+	PkResultsCachePrivate *priv;
+
+	g_return_if_fail (PK_IS_RESULTS_CACHE (cache));
+
+	priv = cache->priv;
+	g_mutex_lock (&priv->mutex);
+	priv->generation++;
+	if (g_hash_table_size (priv->entries) > 0) {
+		g_debug ("invalidating %u cached results as %s",
+			 g_hash_table_size (priv->entries), reason);
+		g_queue_clear (priv->keys);
+		g_hash_table_remove_all (priv->entries);
+		priv->items = 0;
+	}
+	g_mutex_unlock (&priv->mutex);
+}
+
+/**
+ * pk_results_cache_lookup:
+ *
+ * Returns: (transfer full): the cached results, or %NULL
+ **/
+PkResults *
+pk_results_cache_lookup (PkResultsCache *cache, const gchar *key)
+{
+	PkResults *results = NULL;
+	PkResultsCacheEntry *entry;
+	PkResultsCachePrivate *priv;
+
+	g_return_val_if_fail (PK_IS_RESULTS_CACHE (cache), NULL);
+	g_return_val_if_fail (key != NULL, NULL);
+
+	priv = cache->priv;
+	g_mutex_lock (&priv->mutex);
+	entry = g_hash_table_lookup (priv->entries, key);
+	if (entry != NULL) {
+		priv->hits++;
+		results = g_object_ref (entry->results);
+	} else {
+		priv->misses++;
+	}
+	g_mutex_unlock (&priv->mutex);
+	return results;
+}
+
+/**
+ * pk_results_cache_add:
+ * @generation: the generation when the transaction started
+ *
+ * Returns: %TRUE if the results were added, %FALSE if something changed
+ * since they were produced or they are too large to keep
+ **/
+gboolean
+pk_results_cache_add (PkResultsCache *cache,
+		      const gchar *key,
+		      guint generation,
+		      PkResults *results)
+{
+	gchar *key_tmp;
+	gboolean ret = FALSE;
+	guint items;
+	PkResultsCacheEntry *entry;
+	PkResultsCachePrivate *priv;
+
+	g_return_val_if_fail (PK_IS_RESULTS_CACHE (cache), FALSE);
+	g_return_val_if_fail (key != NULL, FALSE);
+	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
+
+	/* count outside the lock, the results are not changed any more */
+	items = pk_results_cache_count_items (results);
+
+	priv = cache->priv;
+	g_mutex_lock (&priv->mutex);
+	if (generation != priv->generation)
+		goto out;
+
+	/* the same query may have run twice at the same time */
+	if (g_hash_table_contains (priv->entries, key))
+		goto out;
+
+	/* this would push everything else out */
+	if (items > priv->items_max) {
+		g_debug ("not caching results with %u items", items);
+		goto out;
+	}
+
+	/* make room */
+	while (g_queue_get_length (priv->keys) >= PK_RESULTS_CACHE_ENTRIES_MAX ||
+	       priv->items + items > priv->items_max)
+		pk_results_cache_remove_oldest (cache);
+
+	entry = g_new0 (PkResultsCacheEntry, 1);
+	entry->results = g_object_ref (results);
+	entry->items = items;
+	key_tmp = g_strdup (key);
+	g_hash_table_insert (priv->entries, key_tmp, entry);
+	g_queue_push_tail (priv->keys, key_tmp);
+	priv->items += items;
+	ret = TRUE;
+out:
+	g_mutex_unlock (&priv->mutex);
+	return ret;
+}
+
+guint
+pk_results_cache_get_hits (PkResultsCache *cache)
+{
+	guint hits;
+
+	g_return_val_if_fail (PK_IS_RESULTS_CACHE (cache), 0);
+
+	g_mutex_lock (&cache->priv->mutex);
+	hits = cache->priv->hits;
+	g_mutex_unlock (&cache->priv->mutex);
+	return hits;
+}
+
+guint
+pk_results_cache_get_misses (PkResultsCache *cache)
+{
+	guint misses;
+
+	g_return_val_if_fail (PK_IS_RESULTS_CACHE (cache), 0);
+
+	g_mutex_lock (&cache->priv->mutex);
+	misses = cache->priv->misses;
+	g_mutex_unlock (&cache->priv->mutex);
+	return misses;
+}
+
+/**
+ * pk_results_cache_get_state:
+ *
+ * Returns: a description of the cache for GetDaemonState()
+ **/
+gchar *
+pk_results_cache_get_state (PkResultsCache *cache)
+{
+	gchar *state;
+	PkResultsCachePrivate *priv;
+
+	g_return_val_if_fail (PK_IS_RESULTS_CACHE (cache), NULL);
+
+	priv = cache->priv;
+	g_mutex_lock (&priv->mutex);
+	state = g_strdup_printf ("Results cache:\n"
+				 "entries[%u] items[%u] generation[%u] hits[%u] misses[%u]\n",
+				 g_hash_table_size (priv->entries),
+				 priv->items,
+				 priv->generation,
+				 priv->hits,
+				 priv->misses);
+	g_mutex_unlock (&priv->mutex);
+	return state;
+}
+
+static void
+pk_results_cache_class_init (PkResultsCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = pk_results_cache_finalize;
+	g_type_class_add_private (klass, sizeof (PkResultsCachePrivate));
+}
+
+static void
+pk_results_cache_init (PkResultsCache *cache)
+{
+	cache->priv = PK_RESULTS_CACHE_GET_PRIVATE (cache);
+	g_mutex_init (&cache->priv->mutex);
+	cache->priv->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+						      g_free, (GDestroyNotify) pk_results_cache_entry_free);
+	cache->priv->keys = g_queue_new ();
+	cache->priv->items_max = PK_RESULTS_CACHE_ITEMS_MAX;
+}
+
+static void
+pk_results_cache_finalize (GObject *object)
+{
+	PkResultsCache *cache;
+	g_return_if_fail (PK_IS_RESULTS_CACHE (object));
+	cache = PK_RESULTS_CACHE (object);
+
+	g_queue_free (cache->priv->keys);
+	g_hash_table_unref (cache->priv->entries);
+	g_mutex_clear (&cache->priv->mutex);
+
+	G_OBJECT_CLASS (pk_results_cache_parent_class)->finalize (object);
+}
+
+PkResultsCache *
+pk_results_cache_new (void)
+{
+	PkResultsCache *cache;
+	cache = g_object_new (PK_TYPE_RESULTS_CACHE, NULL);
+	return PK_RESULTS_CACHE (cache);
+}
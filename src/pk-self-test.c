@@ -24,11 +24,13 @@
 #include <glib.h>
 #include <glib-object.h>
 #include <glib/gstdio.h>
+#include <sys/resource.h>
 
 #include "pk-backend.h"
 #include "pk-backend-spawn.h"
 #include "pk-dbus.h"
 #include "pk-engine.h"
+#include "pk-results-cache.h"
 #include "pk-spawn.h"
 #include "pk-transaction-db.h"
 #include "pk-transaction.h"
@@ -133,9 +135,9 @@ pk_test_backend_func_immediate_false (PkBackendJob *job,
 }
 
 static void
-pk_test_backend_package_cb (PkBackend *backend, PkPackage *package, gpointer user_data)
+pk_test_backend_package_cb (PkBackend *backend, PkBackendJobPackage *package, gpointer user_data)
 {
-	g_debug ("package:%s", pk_package_get_id (package));
+	g_debug ("package:%s", package->package_id);
 	number_packages++;
 }
 
@@ -259,6 +261,10 @@ pk_test_backend_func (void)
 	/* check duplicate filter */
 	g_assert_cmpint (number_packages, ==, 1);
 
+	/* check everything was delivered before Finished */
+	g_assert_cmpint (pk_backend_job_get_queue_depth (job), ==, 0);
+	g_assert_cmpint (pk_backend_job_get_queue_depth_max (job), >=, 1);
+
 	/* reset */
 	g_object_unref (job);
 	job = pk_backend_job_new (conf);
@@ -695,6 +701,141 @@ pk_test_spawn_func (void)
 	g_assert (!ret);
 }
 
+static gdouble spawn_first_line = -1.f;
+
+static void
+pk_test_spawn_throughput_stdout_cb (PkSpawn *spawn, const gchar *line, gpointer user_data)
+{
+	if (stdout_count++ == 0)
+		spawn_first_line = g_test_timer_elapsed ();
+}
+
+static void
+pk_test_spawn_throughput_func (void)
+{
+	gboolean ret;
+	gdouble elapsed;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GKeyFile) conf = NULL;
+	g_autoptr(PkSpawn) spawn = NULL;
+	g_auto(GStrv) argv = NULL;
+
+	conf = g_key_file_new ();
+	spawn = pk_spawn_new (conf);
+	g_signal_connect (spawn, "exit",
+			  G_CALLBACK (pk_test_exit_cb), NULL);
+	g_signal_connect (spawn, "stdout",
+			  G_CALLBACK (pk_test_spawn_throughput_stdout_cb), NULL);
+	stdout_count = 0;
+
+	/* run a helper writing lines as fast as it can */
+	mexit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
+	argv = g_strsplit (TESTDATADIR "/pk-spawn-test-throughput.sh", " ", 0);
+	g_test_timer_start ();
+	ret = pk_spawn_argv (spawn, argv, NULL, PK_SPAWN_ARGV_FLAGS_NONE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* wait for finished */
+	_g_test_loop_run_with_timeout (30000);
+	elapsed = g_test_timer_elapsed ();
+
+	/* make sure we got every line, and the exit after them */
+	g_assert_cmpint (mexit, ==, PK_SPAWN_EXIT_TYPE_SUCCESS);
+	g_assert_cmpint (stdout_count, ==, 20000);
+	g_assert_cmpfloat (spawn_first_line, >=, 0.f);
+	g_test_message ("first line after %.1fms, %.0f lines/s",
+			spawn_first_line * 1000, stdout_count / elapsed);
+}
+
+static guint frame_count = 0;
+
+static void
+pk_test_spawn_frame_cb (PkSpawn *spawn, guint len, gchar *frame, gpointer user_data)
+{
+	if (frame_count++ == 0) {
+		g_assert_cmpint (len, ==, 4);
+		g_assert_cmpint (frame[0], ==, 7);
+		g_assert_cmpstr (frame + 1, ==, "50");
+	} else {
+		g_assert_cmpint (len, ==, 1);
+		g_assert_cmpint (frame[0], ==, 3);
+	}
+}
+
+static void
+pk_test_spawn_framed_func (void)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GKeyFile) conf = NULL;
+	g_autoptr(PkSpawn) spawn = NULL;
+	g_auto(GStrv) argv = NULL;
+
+	conf = g_key_file_new ();
+	spawn = pk_spawn_new (conf);
+	g_signal_connect (spawn, "exit",
+			  G_CALLBACK (pk_test_exit_cb), NULL);
+	g_signal_connect (spawn, "stdout",
+			  G_CALLBACK (pk_test_stdout_cb), NULL);
+	g_signal_connect (spawn, "frame",
+			  G_CALLBACK (pk_test_spawn_frame_cb), NULL);
+	stdout_count = 0;
+	frame_count = 0;
+
+	/* run a helper that switches to frames after one line */
+	mexit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
+	argv = g_strsplit (TESTDATADIR "/pk-spawn-test-framed.sh", " ", 0);
+	ret = pk_spawn_argv (spawn, argv, NULL, PK_SPAWN_ARGV_FLAGS_NONE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* wait for finished */
+	_g_test_loop_run_with_timeout (10000);
+
+	/* the switch itself is not emitted */
+	g_assert_cmpint (mexit, ==, PK_SPAWN_EXIT_TYPE_SUCCESS);
+	g_assert_cmpint (stdout_count, ==, 1);
+	g_assert_cmpint (frame_count, ==, 2);
+}
+
+static void
+pk_test_spawn_framed_invalid_func (void)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GKeyFile) conf = NULL;
+	g_autoptr(PkSpawn) spawn = NULL;
+	g_auto(GStrv) argv = NULL;
+
+	conf = g_key_file_new ();
+	spawn = pk_spawn_new (conf);
+	g_signal_connect (spawn, "exit",
+			  G_CALLBACK (pk_test_exit_cb), NULL);
+	g_signal_connect (spawn, "frame",
+			  G_CALLBACK (pk_test_spawn_frame_cb), NULL);
+	frame_count = 0;
+
+	/* run a helper that writes a line in the middle of its frames */
+	mexit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
+	argv = g_strsplit (TESTDATADIR "/pk-spawn-test-framed-invalid.sh", " ", 0);
+	g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*frame has no magic byte*");
+	ret = pk_spawn_argv (spawn, argv, NULL, PK_SPAWN_ARGV_FLAGS_NONE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* it is killed rather than left to finish sleeping */
+	g_test_timer_start ();
+	_g_test_loop_run_with_timeout (10000);
+	g_test_assert_expected_messages ();
+	g_assert_cmpfloat (g_test_timer_elapsed (), <, 5.f);
+
+	/* nothing after the bad data is emitted */
+	g_assert_cmpint (mexit, ==, PK_SPAWN_EXIT_TYPE_INVALID_OUTPUT);
+	g_assert_cmpint (frame_count, ==, 1);
+	g_assert (!pk_spawn_is_running (spawn));
+}
+
 static void
 pk_test_transaction_func (void)
 {
@@ -727,6 +868,82 @@ pk_test_transaction_func (void)
 	g_dbus_node_info_unref (introspection);
 }
 
+static PkResults *
+pk_test_results_cache_new_results (guint packages)
+{
+	PkResults *results = pk_results_new ();
+	guint i;
+
+	for (i = 0; i < packages; i++) {
+		g_autoptr(PkPackage) package = pk_package_new ();
+		g_autofree gchar *package_id = NULL;
+		package_id = g_strdup_printf ("powertop;1.%u;i386;fedora", i);
+		pk_package_set_id (package, package_id, NULL);
+		pk_results_add_package (results, package);
+	}
+	return results;
+}
+
+static void
+pk_test_results_cache_func (void)
+{
+	guint generation;
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(PkResults) results_tmp = NULL;
+	g_autoptr(PkResultsCache) cache = NULL;
+
+	cache = pk_results_cache_new ();
+	results = pk_results_new ();
+
+	/* nothing cached yet */
+	results_tmp = pk_results_cache_lookup (cache, "get-updates\nnone\n\n");
+	g_assert (results_tmp == NULL);
+	g_assert_cmpint (pk_results_cache_get_misses (cache), ==, 1);
+
+	/* add and find it */
+	generation = pk_results_cache_get_generation (cache);
+	g_assert (pk_results_cache_add (cache, "get-updates\nnone\n\n", generation, results));
+	results_tmp = pk_results_cache_lookup (cache, "get-updates\nnone\n\n");
+	g_assert (results_tmp == results);
+	g_assert_cmpint (pk_results_cache_get_hits (cache), ==, 1);
+	g_clear_object (&results_tmp);
+
+	/* results produced while something changed are not added */
+	generation = pk_results_cache_get_generation (cache);
+	pk_results_cache_invalidate (cache, "testing");
+	results_tmp = pk_results_cache_lookup (cache, "get-updates\nnone\n\n");
+	g_assert (results_tmp == NULL);
+	g_assert (!pk_results_cache_add (cache, "get-updates\nnone\n\n", generation, results));
+	g_assert_cmpint (pk_results_cache_get_misses (cache), ==, 2);
+	g_clear_object (&results);
+
+	/* the total size is bounded, not just the number of entries */
+	pk_results_cache_set_items_max (cache, 5);
+	generation = pk_results_cache_get_generation (cache);
+	results = pk_test_results_cache_new_results (3);
+	g_assert (pk_results_cache_add (cache, "search-name\nnone\na\n", generation, results));
+	g_clear_object (&results);
+	results = pk_test_results_cache_new_results (2);
+	g_assert (pk_results_cache_add (cache, "search-name\nnone\nb\n", generation, results));
+	g_clear_object (&results);
+
+	/* the oldest entry makes room */
+	results = pk_test_results_cache_new_results (2);
+	g_assert (pk_results_cache_add (cache, "search-name\nnone\nc\n", generation, results));
+	g_clear_object (&results);
+	results_tmp = pk_results_cache_lookup (cache, "search-name\nnone\na\n");
+	g_assert (results_tmp == NULL);
+	results_tmp = pk_results_cache_lookup (cache, "search-name\nnone\nb\n");
+	g_assert (results_tmp != NULL);
+	g_clear_object (&results_tmp);
+
+	/* results larger than the whole cache are not kept */
+	results = pk_test_results_cache_new_results (6);
+	g_assert (!pk_results_cache_add (cache, "search-name\nnone\nd\n", generation, results));
+	results_tmp = pk_results_cache_lookup (cache, "search-name\nnone\nc\n");
+	g_assert (results_tmp != NULL);
+}
+
 static void
 pk_test_transaction_db_func (void)
 {
@@ -738,6 +955,9 @@ pk_test_transaction_db_func (void)
 	g_autoptr(PkTransactionDb) db = NULL;
 	g_autofree gchar *proxy_http = NULL;
 	g_autofree gchar *proxy_ftp = NULL;
+	g_auto(GStrv) names = NULL;
+	GVariant *history;
+	GVariant *entries;
 
 	/* remove the self check file */
 #if PK_BUILD_LOCAL
@@ -853,6 +1073,34 @@ pk_test_transaction_db_func (void)
 	g_assert (ret);
 	g_assert_cmpstr (proxy_http, ==, "127.0.0.1:80");
 	g_assert_cmpstr (proxy_ftp, ==, "127.0.0.1:21");
+
+	/* add a transaction with some packages */
+	tid = pk_transaction_db_generate_id (db);
+	ret = pk_transaction_db_add (db, tid);
+	g_assert (ret);
+	ret = pk_transaction_db_set_data (db, tid,
+					  "installing\tpk-test-history;0.1.2;i386;fedora\tsummary\n"
+					  "installing\tpk-test-history;0.1.2;x86_64;fedora\tsummary\n"
+					  "downloading\tpk-test-history-devel;0.1.2;x86_64;fedora\tsummary");
+	g_assert (ret);
+
+	/* not finished, so no history yet */
+	names = g_strsplit ("pk-test-history,pk-test-history-devel", ",", -1);
+	history = pk_transaction_db_get_package_history (db, names, 0);
+	g_assert_cmpint (g_variant_n_children (history), ==, 0);
+	g_variant_unref (history);
+
+	/* multiarch entries are collapsed and downloads ignored */
+	ret = pk_transaction_db_set_finished (db, tid, TRUE, 1000);
+	g_assert (ret);
+	history = pk_transaction_db_get_package_history (db, names, 0);
+	g_assert_cmpint (g_variant_n_children (history), ==, 1);
+	entries = g_variant_lookup_value (history, "pk-test-history", NULL);
+	g_assert (entries != NULL);
+	g_assert_cmpint (g_variant_n_children (entries), ==, 1);
+	g_variant_unref (entries);
+	g_variant_unref (history);
+	g_free (tid);
 }
 
 static PkTransactionDb *db = NULL;
@@ -1396,6 +1644,114 @@ pk_test_scheduler_parallel_func (void)
 	g_object_unref (db);
 }
 
+#define PK_TEST_BACKEND_JOB_PACKAGES	100000
+
+static void
+pk_test_backend_job_packages_cb (PkBackendJob *job,
+				 PkBackendJobPackage *item,
+				 PkBackendJobPackage **last)
+{
+	*last = item;
+	number_packages++;
+}
+
+static glong
+pk_test_peak_rss_kb (void)
+{
+	struct rusage usage;
+
+	g_assert_cmpint (getrusage (RUSAGE_SELF, &usage), ==, 0);
+	return usage.ru_maxrss;
+}
+
+static void
+pk_test_backend_job_packages_drain (PkBackendJob *job)
+{
+	while (pk_backend_job_get_queue_depth (job) > 0)
+		g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+pk_test_backend_job_packages_func (void)
+{
+	PkBackendJobPackage *last = NULL;
+	glong rss;
+	g_autoptr(GKeyFile) conf = g_key_file_new ();
+	g_autoptr(PkBackendJob) job = pk_backend_job_new (conf);
+	g_autoptr(GPtrArray) packages = NULL;
+
+	number_packages = 0;
+	pk_backend_job_set_vfunc (job,
+				  PK_BACKEND_SIGNAL_PACKAGE,
+				  PK_BACKEND_JOB_VFUNC (pk_test_backend_job_packages_cb),
+				  &last);
+
+	/* duplicates are dropped, a new info is not */
+	pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
+				"vips-doc;7.12.4-2.fc8;noarch;linva",
+				"The vips documentation package.");
+	pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
+				"vips-doc;7.12.4-2.fc8;noarch;linva",
+				"The vips documentation package.");
+	pk_backend_job_package_full (job, PK_INFO_ENUM_INSTALLING,
+				     "vips-doc;7.12.4-2.fc8;noarch;linva",
+				     "The vips documentation package.",
+				     PK_INFO_ENUM_IMPORTANT);
+
+	/* invalid package-ids are refused */
+	g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*invalid*");
+	pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
+				"vips-doc;7.12.4-2.fc8;noarch", NULL);
+	g_test_assert_expected_messages ();
+	g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*invalid*");
+	pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
+				";7.12.4-2.fc8;noarch;linva", NULL);
+	g_test_assert_expected_messages ();
+
+	pk_test_backend_job_packages_drain (job);
+	g_assert_cmpint (number_packages, ==, 2);
+	g_assert_nonnull (last);
+	g_assert_cmpstr (last->package_id, ==, "vips-doc;7.12.4-2.fc8;noarch;linva");
+	g_assert_cmpstr (last->summary, ==, "The vips documentation package.");
+	g_assert_cmpint (last->info, ==, PK_INFO_ENUM_INSTALLING);
+	g_assert_cmpint (last->update_severity, ==, PK_INFO_ENUM_IMPORTANT);
+
+	/* the copy kept in the results */
+	{
+		g_autoptr(PkPackage) package = pk_backend_job_package_to_package (last);
+		g_assert_cmpstr (pk_package_get_id (package), ==, last->package_id);
+		g_assert_cmpstr (pk_package_get_name (package), ==, "vips-doc");
+		g_assert_cmpint (pk_package_get_info (package), ==, PK_INFO_ENUM_INSTALLING);
+	}
+
+	/* the peak RSS of a large listing, compared with what a PkPackage
+	 * for each package used to cost */
+	rss = pk_test_peak_rss_kb ();
+	for (guint i = 0; i < PK_TEST_BACKEND_JOB_PACKAGES; i++) {
+		g_autofree gchar *package_id = g_strdup_printf ("package%u;1.%u-1.fc8;x86_64;fedora", i, i);
+		pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE, package_id,
+					"A package in a large repo");
+	}
+	pk_test_backend_job_packages_drain (job);
+	g_assert_cmpint (number_packages, ==, PK_TEST_BACKEND_JOB_PACKAGES + 2);
+	g_test_message ("peak RSS grew by %li kB for %u package records",
+			pk_test_peak_rss_kb () - rss, PK_TEST_BACKEND_JOB_PACKAGES);
+
+	rss = pk_test_peak_rss_kb ();
+	packages = g_ptr_array_new_with_free_func (g_object_unref);
+	for (guint i = 0; i < PK_TEST_BACKEND_JOB_PACKAGES; i++) {
+		g_autofree gchar *package_id = g_strdup_printf ("package%u;1.%u-1.fc8;x86_64;fedora", i, i);
+		PkPackage *package = pk_package_new ();
+		gboolean ret = pk_package_set_id (package, package_id, NULL);
+		g_assert (ret);
+		pk_package_set_info (package, PK_INFO_ENUM_AVAILABLE);
+		pk_package_set_summary (package, "A package in a large repo");
+		g_ptr_array_add (packages, package);
+	}
+	g_test_message ("peak RSS grew by %li kB for %u PkPackage objects",
+			pk_test_peak_rss_kb () - rss, PK_TEST_BACKEND_JOB_PACKAGES);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -1414,13 +1770,18 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit/transaction", pk_test_transaction_func);
 	g_test_add_func ("/packagekit/dbus", pk_test_dbus_func);
 	g_test_add_func ("/packagekit/spawn", pk_test_spawn_func);
+	g_test_add_func ("/packagekit/spawn-throughput", pk_test_spawn_throughput_func);
+	g_test_add_func ("/packagekit/spawn-framed", pk_test_spawn_framed_func);
+	g_test_add_func ("/packagekit/spawn-framed-invalid", pk_test_spawn_framed_invalid_func);
 	g_test_add_func ("/packagekit/scheduler", pk_test_scheduler_func);
 	g_test_add_func ("/packagekit/scheduler-parallel", pk_test_scheduler_parallel_func);
 	g_test_add_func ("/packagekit/transaction-db", pk_test_transaction_db_func);
+	g_test_add_func ("/packagekit/results-cache", pk_test_results_cache_func);
 
 	/* backend stuff */
 	g_test_add_func ("/packagekit/backend", pk_test_backend_func);
 	g_test_add_func ("/packagekit/backend_spawn", pk_test_backend_spawn_func);
+	g_test_add_func ("/packagekit/backend-job-packages", pk_test_backend_job_packages_func);
 
 	return g_test_run ();
 }
@@ -39,6 +39,7 @@
 #include <fcntl.h>
 
 #include <glib/gi18n.h>
+#include <glib-unix.h>
 
 #include "pk-spawn.h"
 #include "pk-shared.h"
@@ -46,8 +47,9 @@
 static void     pk_spawn_finalize	(GObject       *object);
 
 #define PK_SPAWN_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_SPAWN, PkSpawnPrivate))
-#define PK_SPAWN_POLL_DELAY	50 /* ms */
 #define PK_SPAWN_SIGKILL_DELAY	2500 /* ms */
+#define PK_SPAWN_FRAME_SIZE_MAX	(16 * 1024 * 1024)
+#define PK_SPAWN_FRAME_HEADER_SIZE	(1 + sizeof (guint32))
 
 struct PkSpawnPrivate
 {
@@ -55,7 +57,9 @@ struct PkSpawnPrivate
 	gint			 stdin_fd;
 	gint			 stdout_fd;
 	gint			 stderr_fd;
-	guint			 poll_id;
+	guint			 stdout_id;
+	guint			 stderr_id;
+	guint			 child_watch_id;
 	guint			 kill_id;
 	gboolean		 finished;
 	gboolean		 background;
@@ -64,6 +68,9 @@ struct PkSpawnPrivate
 	gboolean		 allow_sigkill;
 	PkSpawnExitType		 exit;
 	GString			*stdout_buf;
+	gsize			 stdout_scanned;
+	gboolean		 stdout_framed;
+	gboolean		 invalid_output;
 	GString			*stderr_buf;
 	gchar			*last_argv0;
 	gchar			**last_envp;
@@ -73,6 +80,7 @@ struct PkSpawnPrivate
 enum {
 	SIGNAL_EXIT,
 	SIGNAL_STDOUT,
+	SIGNAL_FRAME,
 	SIGNAL_STDERR,
 	SIGNAL_LAST
 };
@@ -88,52 +96,214 @@ static guint signals [SIGNAL_LAST] = { 0 };
 
 G_DEFINE_TYPE (PkSpawn, pk_spawn, G_TYPE_OBJECT)
 
+/* returns FALSE when the other end was closed */
 static gboolean
 pk_spawn_read_fd_into_buffer (gint fd, GString *string)
 {
-	gint bytes_read;
+	gssize bytes_read;
 	gchar buffer[BUFSIZ];
 
-	/* ITS4: ignore, we manually NULL terminate and GString cannot overflow */
-	while ((bytes_read = read (fd, buffer, BUFSIZ-1)) > 0) {
-		buffer[bytes_read] = '\0';
-		g_string_append (string, buffer);
+	while ((bytes_read = read (fd, buffer, sizeof (buffer))) > 0)
+		g_string_append_len (string, buffer, bytes_read);
+	if (bytes_read == 0)
+		return FALSE;
+	if (errno == EAGAIN || errno == EINTR)
+		return TRUE;
+	return FALSE;
+}
+
+/**
+ * pk_spawn_reject_output:
+ * @spawn: a #PkSpawn
+ * @reason: why the output was rejected
+ *
+ * Stops reading from the child and kills it, as once it has written
+ * something that can't be parsed nothing after it can be trusted either.
+ * The ::exit signal is emitted with %PK_SPAWN_EXIT_TYPE_INVALID_OUTPUT
+ * when the child has gone.
+ **/
+void
+pk_spawn_reject_output (PkSpawn *spawn, const gchar *reason)
+{
+	g_return_if_fail (PK_IS_SPAWN (spawn));
+
+	if (spawn->priv->invalid_output || spawn->priv->finished)
+		return;
+	g_warning ("killing child as its output was invalid: %s", reason);
+	spawn->priv->invalid_output = TRUE;
+
+	/* nothing else it wrote is going to be emitted */
+	g_string_set_size (spawn->priv->stdout_buf, 0);
+	spawn->priv->stdout_scanned = 0;
+	if (spawn->priv->stdout_id != 0) {
+		g_source_remove (spawn->priv->stdout_id);
+		spawn->priv->stdout_id = 0;
+	}
+	if (spawn->priv->child_pid != -1)
+		kill (spawn->priv->child_pid,
+		      spawn->priv->allow_sigkill ? SIGKILL : SIGQUIT);
+}
+
+static void
+pk_spawn_emit_frames (PkSpawn *spawn)
+{
+	GString *string = spawn->priv->stdout_buf;
+	gchar *frame;
+	gsize len = 0;
+	guint32 size;
+	g_autofree gchar *frames = NULL;
+	g_autofree gchar *reason = NULL;
+
+	/* each frame is the magic byte, a little endian 32 bit length and
+	 * then the data, the last frame may be incomplete */
+	while (string->len - len >= PK_SPAWN_FRAME_HEADER_SIZE) {
+		if ((guchar) string->str[len] != PK_SPAWN_FRAME_MAGIC) {
+			reason = g_strdup ("frame has no magic byte");
+			break;
+		}
+		memcpy (&size, string->str + len + 1, sizeof (size));
+		size = GUINT32_FROM_LE (size);
+		if (size > PK_SPAWN_FRAME_SIZE_MAX) {
+			reason = g_strdup_printf ("frame of %u bytes is too large", size);
+			break;
+		}
+		if (string->len - len - PK_SPAWN_FRAME_HEADER_SIZE < size)
+			break;
+		len += PK_SPAWN_FRAME_HEADER_SIZE + size;
 	}
 
-	return TRUE;
+	/* take the complete frames out before emitting, as the handlers may
+	 * end up using this instance again */
+	if (len > 0) {
+		frames = g_malloc (len);
+		memcpy (frames, string->str, len);
+		g_string_erase (string, 0, len);
+	}
+	for (frame = frames; len > 0 && frame < frames + len;
+	     frame += PK_SPAWN_FRAME_HEADER_SIZE + size) {
+		memcpy (&size, frame + 1, sizeof (size));
+		size = GUINT32_FROM_LE (size);
+		g_signal_emit (spawn, signals [SIGNAL_FRAME], 0,
+			       size, frame + PK_SPAWN_FRAME_HEADER_SIZE);
+
+		/* the handler could not parse it */
+		if (spawn->priv->invalid_output)
+			return;
+	}
+
+	/* everything before the bad frame was good */
+	if (reason != NULL)
+		pk_spawn_reject_output (spawn, reason);
 }
 
-static gboolean
-pk_spawn_emit_whole_lines (PkSpawn *spawn, GString *string)
+static void
+pk_spawn_emit_whole_lines (PkSpawn *spawn)
 {
-	guint i;
-	guint size;
-	guint bytes_processed;
-	g_auto(GStrv) lines = NULL;
+	GString *string = spawn->priv->stdout_buf;
+	gchar *eol = NULL;
+	gchar *line;
+	gchar *tmp;
+	gsize len = 0;
+	g_autofree gchar *lines = NULL;
+
+	/* only look at the bytes that arrived since the last scan, the last
+	 * line may be incomplete */
+	for (tmp = string->str + spawn->priv->stdout_scanned;
+	     (tmp = memchr (tmp, '\n', string->str + string->len - tmp)) != NULL;
+	     tmp++)
+		eol = tmp;
+	if (eol == NULL) {
+		spawn->priv->stdout_scanned = string->len;
+		return;
+	}
 
-	/* if nothing then don't emit */
-	if (pk_strzero (string->str))
-		return FALSE;
+	/* take the complete lines out before emitting, as the handlers may
+	 * end up using this instance again */
+	len = eol - string->str + 1;
+	lines = g_strndup (string->str, len);
+	g_string_erase (string, 0, len);
+	spawn->priv->stdout_scanned = string->len;
+
+	for (line = lines; line < lines + len; line = eol + 1) {
+		eol = memchr (line, '\n', lines + len - line);
+		*eol = '\0';
+
+		/* the helper switched to frames, so put back what follows */
+		if (g_strcmp0 (line, PK_SPAWN_FRAMED_OUTPUT_LINE) == 0) {
+			g_debug ("switching to framed output");
+			spawn->priv->stdout_framed = TRUE;
+			g_string_prepend_len (string, eol + 1, lines + len - eol - 1);
+			spawn->priv->stdout_scanned = 0;
+			pk_spawn_emit_frames (spawn);
+			return;
+		}
+		g_signal_emit (spawn, signals [SIGNAL_STDOUT], 0, line);
+	}
+}
 
-	/* split into lines - the last line may be incomplete */
-	lines = g_strsplit (string->str, "\n", 0);
-	if (lines == NULL)
-		return FALSE;
+static void
+pk_spawn_emit_stdout (PkSpawn *spawn)
+{
+	if (spawn->priv->invalid_output)
+		g_string_set_size (spawn->priv->stdout_buf, 0);
+	else if (spawn->priv->stdout_framed)
+		pk_spawn_emit_frames (spawn);
+	else
+		pk_spawn_emit_whole_lines (spawn);
+}
+
+static void
+pk_spawn_emit_stderr (PkSpawn *spawn)
+{
+	/* emit all lines on standard error in one callback, as it's all
+	 * probably related to the error that just happened */
+	if (spawn->priv->stderr_buf->len != 0) {
+		g_signal_emit (spawn, signals [SIGNAL_STDERR], 0, spawn->priv->stderr_buf->str);
+		g_string_set_size (spawn->priv->stderr_buf, 0);
+	}
+}
 
-	/* find size */
-	size = g_strv_length (lines);
+static gboolean
+pk_spawn_stdout_cb (gint fd, GIOCondition condition, gpointer user_data)
+{
+	PkSpawn *spawn = PK_SPAWN (user_data);
+	gboolean ret;
 
-	bytes_processed = 0;
-	/* we only emit n-1 strings */
-	for (i = 0; i < (size-1); i++) {
-		g_signal_emit (spawn, signals [SIGNAL_STDOUT], 0, lines[i]);
-		/* ITS4: ignore, g_strsplit always NULL terminates */
-		bytes_processed += strlen (lines[i]) + 1;
+	/* all usual output goes on standard out, only bad libraries bitch to stderr */
+	ret = pk_spawn_read_fd_into_buffer (fd, spawn->priv->stdout_buf);
+	pk_spawn_emit_stdout (spawn);
+	if (!ret) {
+		spawn->priv->stdout_id = 0;
+		return G_SOURCE_REMOVE;
 	}
+	return G_SOURCE_CONTINUE;
+}
 
-	/* remove the text we've processed */
-	g_string_erase (string, 0, bytes_processed);
-	return TRUE;
+static gboolean
+pk_spawn_stderr_cb (gint fd, GIOCondition condition, gpointer user_data)
+{
+	PkSpawn *spawn = PK_SPAWN (user_data);
+	gboolean ret;
+
+	ret = pk_spawn_read_fd_into_buffer (fd, spawn->priv->stderr_buf);
+	pk_spawn_emit_stderr (spawn);
+	if (!ret) {
+		spawn->priv->stderr_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+/* read whatever the child wrote before it exited */
+static void
+pk_spawn_drain (PkSpawn *spawn)
+{
+	if (spawn->priv->stdout_fd != -1)
+		pk_spawn_read_fd_into_buffer (spawn->priv->stdout_fd, spawn->priv->stdout_buf);
+	if (spawn->priv->stderr_fd != -1)
+		pk_spawn_read_fd_into_buffer (spawn->priv->stderr_fd, spawn->priv->stderr_buf);
+	pk_spawn_emit_stderr (spawn);
+	pk_spawn_emit_stdout (spawn);
 }
 
 static const gchar *
@@ -151,62 +321,73 @@ pk_spawn_exit_type_enum_to_string (PkSpawnExitType type)
 		return "sigquit";
 	if (type == PK_SPAWN_EXIT_TYPE_SIGKILL)
 		return "sigkill";
+	if (type == PK_SPAWN_EXIT_TYPE_INVALID_OUTPUT)
+		return "invalid-output";
 	return "unknown";
 }
 
-static gboolean
-pk_spawn_check_child (PkSpawn *spawn)
-{
-	pid_t pid;
-	int status;
-	gint retval;
-	static guint limit_printing = 0;
+static void pk_spawn_child_watch_cb (GPid pid, gint status, gpointer user_data);
 
-	/* this shouldn't happen */
-	if (spawn->priv->finished) {
-		g_warning ("finished twice!");
-		spawn->priv->poll_id = 0;
-		return FALSE;
+static void
+pk_spawn_remove_watches (PkSpawn *spawn)
+{
+	if (spawn->priv->stdout_id != 0) {
+		g_source_remove (spawn->priv->stdout_id);
+		spawn->priv->stdout_id = 0;
 	}
+	if (spawn->priv->stderr_id != 0) {
+		g_source_remove (spawn->priv->stderr_id);
+		spawn->priv->stderr_id = 0;
+	}
+	if (spawn->priv->child_watch_id != 0) {
+		g_source_remove (spawn->priv->child_watch_id);
+		spawn->priv->child_watch_id = 0;
+	}
+}
 
-	pk_spawn_read_fd_into_buffer (spawn->priv->stdout_fd, spawn->priv->stdout_buf);
-	pk_spawn_read_fd_into_buffer (spawn->priv->stderr_fd, spawn->priv->stderr_buf);
-
-	/* emit all lines on standard out in one callback, as it's all probably
-	* related to the error that just happened */
-	if (spawn->priv->stderr_buf->len != 0) {
-		g_signal_emit (spawn, signals [SIGNAL_STDERR], 0, spawn->priv->stderr_buf->str);
-		g_string_set_size (spawn->priv->stderr_buf, 0);
+static void
+pk_spawn_add_watches (PkSpawn *spawn)
+{
+	/* sanity check */
+	if (spawn->priv->child_watch_id != 0) {
+		g_warning ("trying to watch child when already watched");
+		pk_spawn_remove_watches (spawn);
 	}
 
-	/* all usual output goes on standard out, only bad libraries bitch to stderr */
-	pk_spawn_emit_whole_lines (spawn, spawn->priv->stdout_buf);
+	/* read output as soon as it arrives, and get told when the child
+	 * exits rather than polling for both */
+	spawn->priv->stdout_id = g_unix_fd_add (spawn->priv->stdout_fd,
+						G_IO_IN | G_IO_HUP | G_IO_ERR,
+						pk_spawn_stdout_cb, spawn);
+	g_source_set_name_by_id (spawn->priv->stdout_id, "[PkSpawn] stdout");
+	spawn->priv->stderr_id = g_unix_fd_add (spawn->priv->stderr_fd,
+						G_IO_IN | G_IO_HUP | G_IO_ERR,
+						pk_spawn_stderr_cb, spawn);
+	g_source_set_name_by_id (spawn->priv->stderr_id, "[PkSpawn] stderr");
+	spawn->priv->child_watch_id = g_child_watch_add (spawn->priv->child_pid,
+							 pk_spawn_child_watch_cb,
+							 spawn);
+	g_source_set_name_by_id (spawn->priv->child_watch_id, "[PkSpawn] child watch");
+}
 
-	/* Only print one in twenty times to avoid filling the screen */
-	if (limit_printing++ % 20 == 0)
-		g_debug ("polling child_pid=%ld (1/20)", (long)spawn->priv->child_pid);
+/* @status is NULL when the child was reaped by someone else and the
+ * wait status is lost, which is reported as a failure */
+static void
+pk_spawn_child_exited (PkSpawn *spawn, const gint *status)
+{
+	gint retval;
 
-	/* check if the child exited */
-	pid = waitpid (spawn->priv->child_pid, &status, WNOHANG);
-	if (pid == -1) {
-		g_warning ("failed to get the child PID data for %ld", (long)spawn->priv->child_pid);
-		return TRUE;
-	}
-	if (pid == 0) {
-		/* process still exist, but has not changed state */
-		return TRUE;
-	}
-	if (pid != spawn->priv->child_pid) {
-		g_warning ("some other process id was returned: got %ld and wanted %ld",
-			     (long)pid, (long)spawn->priv->child_pid);
-		return TRUE;
+	/* this shouldn't happen */
+	if (spawn->priv->finished) {
+		g_warning ("finished twice!");
+		return;
 	}
 
-	/* disconnect the poll as there will be no more updates */
-	if (spawn->priv->poll_id > 0) {
-		g_source_remove (spawn->priv->poll_id);
-		spawn->priv->poll_id = 0;
-	}
+	/* the child may have written more since we last looked */
+	pk_spawn_drain (spawn);
+
+	/* disconnect the watches as there will be no more updates */
+	pk_spawn_remove_watches (spawn);
 
 	/* child exited, close resources */
 	close (spawn->priv->stdin_fd);
@@ -218,8 +399,11 @@ pk_spawn_check_child (PkSpawn *spawn)
 	spawn->priv->child_pid = -1;
 
 	/* use this to detect SIGKILL and SIGQUIT */
-	if (WIFSIGNALED (status)) {
-		retval = WTERMSIG (status);
+	if (status == NULL) {
+		g_warning ("the exit status of the child process is unknown");
+		spawn->priv->exit = PK_SPAWN_EXIT_TYPE_FAILED;
+	} else if (WIFSIGNALED (*status)) {
+		retval = WTERMSIG (*status);
 		if (retval == SIGQUIT) {
 			g_debug ("the child process was terminated by SIGQUIT");
 			spawn->priv->exit = PK_SPAWN_EXIT_TYPE_SIGQUIT;
@@ -227,18 +411,12 @@ pk_spawn_check_child (PkSpawn *spawn)
 			g_debug ("the child process was terminated by SIGKILL");
 			spawn->priv->exit = PK_SPAWN_EXIT_TYPE_SIGKILL;
 		} else {
-			g_warning ("the child process was terminated by signal %i", WTERMSIG (status));
+			g_warning ("the child process was terminated by signal %i", retval);
 			spawn->priv->exit = PK_SPAWN_EXIT_TYPE_SIGKILL;
 		}
 	} else {
-		/* check we are dead and buried */
-		if (!WIFEXITED (status)) {
-			g_warning ("the process did not exit, but waitpid() returned!");
-			return TRUE;
-		}
-
 		/* get the exit code */
-		retval = WEXITSTATUS (status);
+		retval = WEXITSTATUS (*status);
 		if (retval == 0) {
 			g_debug ("the child exited with success");
 			if (spawn->priv->exit == PK_SPAWN_EXIT_TYPE_UNKNOWN)
@@ -262,8 +440,13 @@ pk_spawn_check_child (PkSpawn *spawn)
 		spawn->priv->kill_id = 0;
 	}
 
-	/* are we doing pk_spawn_exit for a good reason? */
-	if (spawn->priv->is_changing_dispatcher)
+	/* are we doing pk_spawn_exit for a good reason? we can't tell
+	 * if the status was lost, so don't hide the failure */
+	if (spawn->priv->invalid_output)
+		spawn->priv->exit = PK_SPAWN_EXIT_TYPE_INVALID_OUTPUT;
+	else if (status == NULL)
+		g_debug ("not overriding exit as the status was lost");
+	else if (spawn->priv->is_changing_dispatcher)
 		spawn->priv->exit = PK_SPAWN_EXIT_TYPE_DISPATCHER_CHANGED;
 	else if (spawn->priv->is_sending_exit)
 		spawn->priv->exit = PK_SPAWN_EXIT_TYPE_DISPATCHER_EXIT;
@@ -271,8 +454,63 @@ pk_spawn_check_child (PkSpawn *spawn)
 	/* don't emit if we just closed an invalid dispatcher */
 	g_debug ("emitting exit %s", pk_spawn_exit_type_enum_to_string (spawn->priv->exit));
 	g_signal_emit (spawn, signals [SIGNAL_EXIT], 0, spawn->priv->exit);
+}
 
-	spawn->priv->poll_id = 0;
+static void
+pk_spawn_child_watch_cb (GPid pid, gint status, gpointer user_data)
+{
+	PkSpawn *spawn = PK_SPAWN (user_data);
+
+	/* the source is destroyed after this returns */
+	spawn->priv->child_watch_id = 0;
+	pk_spawn_child_exited (spawn, &status);
+}
+
+/* only used when we have to block, the main loop does this otherwise */
+static gboolean
+pk_spawn_check_child (PkSpawn *spawn)
+{
+	pid_t pid;
+	int status;
+
+	/* this shouldn't happen */
+	if (spawn->priv->finished) {
+		g_warning ("finished twice!");
+		return FALSE;
+	}
+
+	pk_spawn_drain (spawn);
+
+	/* check if the child exited */
+	pid = waitpid (spawn->priv->child_pid, &status, WNOHANG);
+	if (pid == -1 && errno == ECHILD) {
+		/* reaped by the child watch before it was removed, so the
+		 * status went with the source and we can't claim success */
+		g_warning ("child_pid=%ld was already reaped", (long)spawn->priv->child_pid);
+		pk_spawn_child_exited (spawn, NULL);
+		return FALSE;
+	}
+	if (pid == -1) {
+		g_warning ("failed to get the child PID data for %ld", (long)spawn->priv->child_pid);
+		return TRUE;
+	}
+	if (pid == 0) {
+		/* process still exist, but has not changed state */
+		return TRUE;
+	}
+	if (pid != spawn->priv->child_pid) {
+		g_warning ("some other process id was returned: got %ld and wanted %ld",
+			     (long)pid, (long)spawn->priv->child_pid);
+		return TRUE;
+	}
+
+	/* check we are dead and buried */
+	if (!WIFSIGNALED (status) && !WIFEXITED (status)) {
+		g_warning ("the process did not exit, but waitpid() returned!");
+		return TRUE;
+	}
+
+	pk_spawn_child_exited (spawn, &status);
 	return FALSE;
 }
 
@@ -438,6 +676,9 @@ pk_spawn_exit (PkSpawn *spawn)
 		goto out;
 	}
 
+	/* we reap the child ourselves while blocking */
+	pk_spawn_remove_watches (spawn);
+
 	/* block until the previous script exited */
 	do {
 		g_debug ("waiting for exit");
@@ -450,10 +691,12 @@ pk_spawn_exit (PkSpawn *spawn)
 	} while (ret && count++ < 500);
 
 	/* the script exited okay */
-	if (count < 500)
+	if (count < 500) {
 		ret = TRUE;
-	else
+	} else {
 		g_warning ("failed to exit script");
+		pk_spawn_add_watches (spawn);
+	}
 out:
 	spawn->priv->is_sending_exit = FALSE;
 	return ret;
@@ -559,11 +802,8 @@ pk_spawn_argv (PkSpawn *spawn, gchar **argv, gchar **envp,
 		ret = pk_spawn_exit (spawn);
 		if (!ret) {
 			g_warning ("failed to exit previous instance");
-			/* remove poll, as we can't reply on pk_spawn_check_child() */
-			if (spawn->priv->poll_id != 0) {
-				g_source_remove (spawn->priv->poll_id);
-				spawn->priv->poll_id = 0;
-			}
+			/* remove the watches, as we can't rely on the old instance */
+			pk_spawn_remove_watches (spawn);
 		}
 		spawn->priv->is_changing_dispatcher = FALSE;
 	}
@@ -624,15 +864,13 @@ pk_spawn_argv (PkSpawn *spawn, gchar **argv, gchar **envp,
 		goto out;
 	}
 
-	/* sanity check */
-	if (spawn->priv->poll_id != 0) {
-		g_warning ("trying to set timeout when already set");
-		g_source_remove (spawn->priv->poll_id);
-	}
-
-	/* poll quickly */
-	spawn->priv->poll_id = g_timeout_add (PK_SPAWN_POLL_DELAY, (GSourceFunc) pk_spawn_check_child, spawn);
-	g_source_set_name_by_id (spawn->priv->poll_id, "[PkSpawn] main poll");
+	/* a new child starts with empty buffers */
+	g_string_set_size (spawn->priv->stdout_buf, 0);
+	g_string_set_size (spawn->priv->stderr_buf, 0);
+	spawn->priv->stdout_scanned = 0;
+	spawn->priv->stdout_framed = FALSE;
+	spawn->priv->invalid_output = FALSE;
+	pk_spawn_add_watches (spawn);
 out:
 	return ret;
 }
@@ -714,6 +952,11 @@ pk_spawn_class_init (PkSpawnClass *klass)
 			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
 			      0, NULL, NULL, g_cclosure_marshal_VOID__STRING,
 			      G_TYPE_NONE, 1, G_TYPE_STRING);
+	signals [SIGNAL_FRAME] =
+		g_signal_new ("frame",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__UINT_POINTER,
+			      G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_POINTER);
 	signals [SIGNAL_STDERR] =
 		g_signal_new ("stderr",
 			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
@@ -732,7 +975,9 @@ pk_spawn_init (PkSpawn *spawn)
 	spawn->priv->stdout_fd = -1;
 	spawn->priv->stderr_fd = -1;
 	spawn->priv->stdin_fd = -1;
-	spawn->priv->poll_id = 0;
+	spawn->priv->stdout_id = 0;
+	spawn->priv->stderr_id = 0;
+	spawn->priv->child_watch_id = 0;
 	spawn->priv->kill_id = 0;
 	spawn->priv->finished = FALSE;
 	spawn->priv->is_sending_exit = FALSE;
@@ -741,6 +986,7 @@ pk_spawn_init (PkSpawn *spawn)
 	spawn->priv->last_argv0 = NULL;
 	spawn->priv->last_envp = NULL;
 	spawn->priv->background = FALSE;
+	spawn->priv->stdout_framed = FALSE;
 	spawn->priv->exit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
 
 	spawn->priv->stdout_buf = g_string_new ("");
@@ -759,11 +1005,8 @@ pk_spawn_finalize (GObject *object)
 
 	g_return_if_fail (spawn->priv != NULL);
 
-	/* disconnect the poll in case we were cancelled before completion */
-	if (spawn->priv->poll_id != 0) {
-		g_source_remove (spawn->priv->poll_id);
-		spawn->priv->poll_id = 0;
-	}
+	/* disconnect the watches in case we were cancelled before completion */
+	pk_spawn_remove_watches (spawn);
 
 	/* disconnect the SIGKILL check */
 	if (spawn->priv->kill_id != 0) {
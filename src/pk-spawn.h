@@ -64,9 +64,29 @@ typedef enum {
 	PK_SPAWN_EXIT_TYPE_DISPATCHER_EXIT,	/* we timed out, and exited the dispatcher instance */
 	PK_SPAWN_EXIT_TYPE_SIGQUIT,		/* we killed the instance (SIGQUIT) */
 	PK_SPAWN_EXIT_TYPE_SIGKILL,		/* we killed the instance (SIGKILL) */
+	PK_SPAWN_EXIT_TYPE_INVALID_OUTPUT,	/* we killed the instance for bad output */
 	PK_SPAWN_EXIT_TYPE_UNKNOWN
 } PkSpawnExitType;
 
+/**
+ * PK_SPAWN_FRAMED_OUTPUT_LINE:
+ *
+ * The line a child writes to switch the rest of its standard output from
+ * lines to frames. Each frame is %PK_SPAWN_FRAME_MAGIC, a little endian
+ * 32 bit length and then that many bytes, and is emitted with the "frame"
+ * signal. A frame without the magic byte means something else wrote to
+ * the same descriptor, and the child is killed.
+ **/
+#define PK_SPAWN_FRAMED_OUTPUT_LINE	"framed-output"
+
+/**
+ * PK_SPAWN_FRAME_MAGIC:
+ *
+ * The byte every frame starts with. It can never start a line of UTF-8
+ * text, so stray output is caught on the first frame it corrupts.
+ **/
+#define PK_SPAWN_FRAME_MAGIC		0xfe
+
 typedef enum {
 	PK_SPAWN_ARGV_FLAGS_NONE,
 	PK_SPAWN_ARGV_FLAGS_NEVER_REUSE,
@@ -85,6 +105,8 @@ gboolean	 pk_spawn_argv				(PkSpawn	*spawn,
 gboolean	 pk_spawn_is_running			(PkSpawn	*spawn);
 gboolean	 pk_spawn_kill				(PkSpawn	*spawn);
 gboolean	 pk_spawn_exit				(PkSpawn	*spawn);
+void		 pk_spawn_reject_output			(PkSpawn	*spawn,
+							 const gchar	*reason);
 
 G_END_DECLS
 
@@ -37,6 +37,7 @@
 #include <glib/gstdio.h>
 #include <sqlite3.h>
 #include <packagekit-glib2/pk-enum.h>
+#include <packagekit-glib2/pk-package.h>
 #include <packagekit-glib2/pk-results.h>
 #include <packagekit-glib2/pk-common.h>
 
@@ -410,13 +411,189 @@ pk_transaction_db_set_cmdline (PkTransactionDb *tdb, const gchar *tid, const gch
 					      tid);
 }
 
+/* adds each package in the data of a transaction to transaction_packages */
+static gboolean
+pk_transaction_db_add_packages (PkTransactionDb *tdb,
+				const gchar *tid,
+				const gchar *timespec,
+				const gchar *data)
+{
+	gint64 timestamp = 0;
+	gint rc;
+	guint i;
+	g_auto(GStrv) lines = NULL;
+	g_autoptr(PkPackage) package = pk_package_new ();
+	g_autoptr(sqlite3_stmt) statement = NULL;
+
+	if (timespec != NULL) {
+		g_autoptr(GDateTime) datetime = pk_iso8601_to_datetime (timespec);
+		if (datetime != NULL)
+			timestamp = g_date_time_to_unix (datetime);
+	}
+
+	if (!pk_transaction_db_prepare (tdb,
+					"INSERT INTO transaction_packages (transaction_id, name, arch, "
+					"version, info, data, timestamp) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7)",
+					&statement))
+		return FALSE;
+
+	lines = g_strsplit (data, "\n", -1);
+	for (i = 0; lines[i] != NULL; i++) {
+		g_autoptr(GError) error_local = NULL;
+
+		if (lines[i][0] == '\0')
+			continue;
+		if (!pk_package_parse (package, lines[i], &error_local)) {
+			g_warning ("Failed to parse package: '%s': %s",
+				   lines[i], error_local->message);
+			continue;
+		}
+		sqlite3_reset (statement);
+		sqlite3_bind_text (statement, 1, tid, -1, SQLITE_STATIC);
+		sqlite3_bind_text (statement, 2, pk_package_get_name (package), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text (statement, 3, pk_package_get_arch (package), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text (statement, 4, pk_package_get_version (package), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int (statement, 5, pk_package_get_info (package));
+		sqlite3_bind_text (statement, 6, pk_package_get_data (package), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int64 (statement, 7, timestamp);
+		rc = sqlite3_step (statement);
+		if (rc != SQLITE_DONE) {
+			g_warning ("SQL error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static gboolean
+pk_transaction_db_remove_packages (PkTransactionDb *tdb, const gchar *tid)
+{
+	g_autoptr(sqlite3_stmt) statement = NULL;
+
+	if (!pk_transaction_db_prepare (tdb,
+					"DELETE FROM transaction_packages WHERE transaction_id=?1",
+					&statement))
+		return FALSE;
+	sqlite3_bind_text (statement, 1, tid, -1, SQLITE_STATIC);
+	return pk_transaction_db_step (tdb->priv->db, statement);
+}
+
+static gchar *
+pk_transaction_db_get_timespec (PkTransactionDb *tdb, const gchar *tid)
+{
+	g_autoptr(sqlite3_stmt) statement = NULL;
+
+	if (!pk_transaction_db_prepare (tdb,
+					"SELECT timespec FROM transactions WHERE transaction_id=?1",
+					&statement))
+		return NULL;
+	sqlite3_bind_text (statement, 1, tid, -1, SQLITE_STATIC);
+	if (sqlite3_step (statement) != SQLITE_ROW)
+		return NULL;
+	return g_strdup ((const gchar *) sqlite3_column_text (statement, 0));
+}
+
 gboolean
 pk_transaction_db_set_data (PkTransactionDb *tdb, const gchar *tid, const gchar *data)
 {
-	return pk_transaction_db_set_strings (tdb,
-					      "UPDATE transactions SET data=?1 WHERE transaction_id=?2",
-					      data,
-					      tid);
+	g_autofree gchar *timespec = NULL;
+
+	if (!pk_transaction_db_set_strings (tdb,
+					    "UPDATE transactions SET data=?1 WHERE transaction_id=?2",
+					    data,
+					    tid))
+		return FALSE;
+
+	/* keep the package history in step */
+	if (!pk_transaction_db_remove_packages (tdb, tid))
+		return FALSE;
+	timespec = pk_transaction_db_get_timespec (tdb, tid);
+	return pk_transaction_db_add_packages (tdb, tid, timespec, data);
+}
+
+/**
+ * pk_transaction_db_get_package_history:
+ * @package_names: the package names to look for
+ * @max_size: the maximum number of entries per package, or 0 for all
+ *
+ * Gets the installs, removals and updates of the packages by successful
+ * transactions, oldest first.
+ *
+ * Returns: a #GVariant of type a{saa{sv}}
+ **/
+GVariant *
+pk_transaction_db_get_package_history (PkTransactionDb *tdb,
+				       gchar **package_names,
+				       guint max_size)
+{
+	GVariantBuilder builder;
+	guint i;
+	g_autoptr(sqlite3_stmt) statement = NULL;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), NULL);
+	g_return_val_if_fail (package_names != NULL, NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{saa{sv}}"));
+	if (!pk_transaction_db_prepare (tdb,
+					"SELECT p.info, p.data, p.version, p.timestamp, t.uid "
+					"FROM transaction_packages p "
+					"JOIN transactions t ON p.transaction_id = t.transaction_id "
+					"WHERE p.name = ?1 AND t.succeeded = 1 AND p.timestamp != 0 "
+					"AND p.info IN (?2, ?3, ?4) "
+					"ORDER BY p.timestamp DESC",
+					&statement))
+		return g_variant_builder_end (&builder);
+
+	for (i = 0; package_names[i] != NULL; i++) {
+		gint64 timestamp_last = 0;
+		g_autoptr(GPtrArray) array = g_ptr_array_new ();
+
+		sqlite3_reset (statement);
+		sqlite3_bind_text (statement, 1, package_names[i], -1, SQLITE_STATIC);
+		sqlite3_bind_int (statement, 2, PK_INFO_ENUM_INSTALLING);
+		sqlite3_bind_int (statement, 3, PK_INFO_ENUM_REMOVING);
+		sqlite3_bind_int (statement, 4, PK_INFO_ENUM_UPDATING);
+		while (sqlite3_step (statement) == SQLITE_ROW) {
+			GVariantBuilder entry;
+			const gchar *data = (const gchar *) sqlite3_column_text (statement, 1);
+			const gchar *version = (const gchar *) sqlite3_column_text (statement, 2);
+			gint64 timestamp = sqlite3_column_int64 (statement, 3);
+
+			/* de-duplicate the entry, in the case of multiarch */
+			if (timestamp == timestamp_last)
+				continue;
+			timestamp_last = timestamp;
+
+			g_variant_builder_init (&entry, G_VARIANT_TYPE_ARRAY);
+			g_variant_builder_add (&entry, "{sv}", "info",
+					       g_variant_new_uint32 (sqlite3_column_int (statement, 0)));
+			g_variant_builder_add (&entry, "{sv}", "source",
+					       g_variant_new_string (data != NULL ? data : ""));
+			g_variant_builder_add (&entry, "{sv}", "version",
+					       g_variant_new_string (version != NULL ? version : ""));
+			g_variant_builder_add (&entry, "{sv}", "timestamp",
+					       g_variant_new_uint64 (timestamp));
+			g_variant_builder_add (&entry, "{sv}", "user-id",
+					       g_variant_new_uint32 (sqlite3_column_int (statement, 4)));
+			g_ptr_array_add (array, g_variant_builder_end (&entry));
+			if (max_size > 0 && array->len >= max_size)
+				break;
+		}
+		if (array->len == 0)
+			continue;
+
+		/* oldest first */
+		for (guint j = 0; j < array->len / 2; j++) {
+			gpointer tmp = array->pdata[j];
+			array->pdata[j] = array->pdata[array->len - j - 1];
+			array->pdata[array->len - j - 1] = tmp;
+		}
+		g_variant_builder_add (&builder, "{s@aa{sv}}", package_names[i],
+				       g_variant_new_array (G_VARIANT_TYPE ("a{sv}"),
+							    (GVariant * const *) array->pdata,
+							    array->len));
+	}
+	return g_variant_builder_end (&builder);
 }
 
 gboolean
@@ -474,6 +651,8 @@ pk_transaction_db_empty (PkTransactionDb *tdb)
 
 	statement = "TRUNCATE TABLE transactions;";
 	sqlite3_exec (tdb->priv->db, statement, NULL, NULL, NULL);
+	statement = "DELETE FROM transaction_packages;";
+	sqlite3_exec (tdb->priv->db, statement, NULL, NULL, NULL);
 	return TRUE;
 }
 
@@ -874,6 +1053,38 @@ pk_transaction_db_execute (PkTransactionDb *tdb,
 	return ret;
 }
 
+/* fills transaction_packages from the data of existing transactions */
+static gboolean
+pk_transaction_db_migrate_packages (PkTransactionDb *tdb, GError **error)
+{
+	g_autoptr(sqlite3_stmt) statement = NULL;
+
+	if (!pk_transaction_db_execute (tdb, "BEGIN TRANSACTION", error))
+		return FALSE;
+	if (!pk_transaction_db_prepare (tdb,
+					"SELECT transaction_id, timespec, data FROM transactions "
+					"WHERE data IS NOT NULL",
+					&statement)) {
+		pk_transaction_db_execute (tdb, "ROLLBACK", NULL);
+		g_set_error_literal (error, 1, 0, "failed to read transactions");
+		return FALSE;
+	}
+	while (sqlite3_step (statement) == SQLITE_ROW) {
+		const gchar *tid = (const gchar *) sqlite3_column_text (statement, 0);
+		const gchar *timespec = (const gchar *) sqlite3_column_text (statement, 1);
+		const gchar *data = (const gchar *) sqlite3_column_text (statement, 2);
+		if (tid == NULL || data == NULL)
+			continue;
+		if (!pk_transaction_db_add_packages (tdb, tid, timespec, data)) {
+			pk_transaction_db_execute (tdb, "ROLLBACK", NULL);
+			g_set_error (error, 1, 0,
+				     "failed to add packages for %s", tid);
+			return FALSE;
+		}
+	}
+	return pk_transaction_db_execute (tdb, "COMMIT", error);
+}
+
 gboolean
 pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 {
@@ -969,6 +1180,25 @@ pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 			return FALSE;
 	}
 
+	/* package history, indexed by name */
+	if (!pk_transaction_db_execute (tdb, "SELECT * FROM transaction_packages LIMIT 1", &error_local)) {
+		g_debug ("adding table transaction_packages: %s", error_local->message);
+		g_clear_error (&error_local);
+		statement = "CREATE TABLE transaction_packages (transaction_id TEXT, name TEXT, arch TEXT, version TEXT, info INTEGER, data TEXT, timestamp INTEGER);";
+		if (!pk_transaction_db_execute (tdb, statement, error))
+			return FALSE;
+		statement = "CREATE INDEX transaction_packages_name ON transaction_packages (name);";
+		if (!pk_transaction_db_execute (tdb, statement, error))
+			return FALSE;
+		if (!pk_transaction_db_migrate_packages (tdb, error))
+			return FALSE;
+	}
+
+	/* set_data replaces the rows of one transaction each time */
+	statement = "CREATE INDEX IF NOT EXISTS transaction_packages_transaction_id ON transaction_packages (transaction_id);";
+	if (!pk_transaction_db_execute (tdb, statement, error))
+		return FALSE;
+
 	/* try to set correct permissions */
 	g_chmod (PK_DB_DIR "/transactions.db", 0644);
 
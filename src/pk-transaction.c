@@ -76,6 +76,13 @@ static gboolean pk_transaction_is_supported_content_type (PkTransaction *transac
 /* maximum number of items that can be resolved in one go */
 #define PK_TRANSACTION_MAX_ITEMS_TO_RESOLVE	10000
 
+/* bounds for coalescing ::Package() into ::Packages() */
+#define PK_TRANSACTION_PACKAGES_BATCH_MAX	1000
+#define PK_TRANSACTION_PACKAGES_BATCH_TIMEOUT	50 /* ms */
+
+/* results with more packages than this are not worth keeping */
+#define PK_TRANSACTION_RESULTS_CACHE_ITEMS_MAX	100000
+
 struct PkTransactionPrivate
 {
 	PkRoleEnum		 role;
@@ -104,14 +111,26 @@ struct PkTransactionPrivate
 	GCancellable		*cancellable;
 	gboolean		 skip_auth_check;
 
+	/* batched ::Packages() */
+	gboolean		 batch_packages;
+	GVariantBuilder		*packages_batch;
+	guint			 packages_batch_len;
+	guint			 packages_batch_id;
+
 	/* needed for gui coldplugging */
 	gchar			*last_package_id;
+	guint			 packages_emitted;
 	gchar			*tid;
 	gchar			*sender;
 	gchar			*cmdline;
 	PkResults		*results;
 	PkTransactionDb		*transaction_db;
 
+	/* what a cacheable query emitted */
+	gchar			*results_cache_key;
+	guint			 results_cache_generation;
+	PkResults		*results_cache_results;
+
 	/* cached */
 	gboolean		 cached_force;
 	gboolean		 cached_allow_deps;
@@ -384,11 +403,54 @@ pk_transaction_status_changed_emit (PkTransaction *transaction, PkStatusEnum sta
 					      g_variant_new_uint32 (status));
 }
 
+/*
+ * pk_transaction_packages_flush:
+ *
+ * Sends any ::Package() items that have been coalesced into one
+ * ::Packages() signal. This has to be called before any other signal is
+ * emitted so that clients see the items in the order they were emitted.
+ */
+static void
+pk_transaction_packages_flush (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	if (priv->packages_batch_id != 0) {
+		g_source_remove (priv->packages_batch_id);
+		priv->packages_batch_id = 0;
+	}
+	if (priv->packages_batch == NULL)
+		return;
+
+	g_debug ("emitting %u coalesced packages", priv->packages_batch_len);
+	g_dbus_connection_emit_signal (priv->connection,
+				       NULL,
+				       priv->tid,
+				       PK_DBUS_INTERFACE_TRANSACTION,
+				       "Packages",
+				       g_variant_new ("(a(uss))",
+						      priv->packages_batch),
+				       NULL);
+	g_variant_builder_unref (priv->packages_batch);
+	priv->packages_batch = NULL;
+	priv->packages_batch_len = 0;
+}
+
+static gboolean
+pk_transaction_packages_flush_cb (gpointer user_data)
+{
+	PkTransaction *transaction = PK_TRANSACTION (user_data);
+	transaction->priv->packages_batch_id = 0;
+	pk_transaction_packages_flush (transaction);
+	return G_SOURCE_REMOVE;
+}
+
 static void
 pk_transaction_finished_emit (PkTransaction *transaction,
 			      PkExitEnum exit_enum,
 			      guint time_ms)
 {
+	pk_transaction_packages_flush (transaction);
 	g_debug ("emitting finished '%s', %i",
 		 pk_exit_enum_to_string (exit_enum),
 		 time_ms);
@@ -411,6 +473,7 @@ pk_transaction_error_code_emit (PkTransaction *transaction,
 				PkErrorEnum error_enum,
 				const gchar *details)
 {
+	pk_transaction_packages_flush (transaction);
 	g_debug ("emitting error-code %s, '%s'",
 		 pk_error_enum_to_string (error_enum),
 		 details);
@@ -467,6 +530,8 @@ pk_transaction_details_cb (PkBackendJob *job,
 
 	/* add to results */
 	pk_results_add_details (transaction->priv->results, item);
+	if (transaction->priv->results_cache_results != NULL)
+		pk_results_add_details (transaction->priv->results_cache_results, item);
 
 	/* emit */
 	g_debug ("emitting details");
@@ -502,6 +567,7 @@ pk_transaction_details_cb (PkBackendJob *job,
 		g_variant_builder_add (&builder, "{sv}", "download-size",
 				       g_variant_new_uint64 (size));
 
+	pk_transaction_packages_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -581,6 +647,7 @@ pk_transaction_files_cb (PkBackendJob *job,
 
 	/* emit */
 	g_debug ("emitting files %s", package_id);
+	pk_transaction_packages_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -620,6 +687,7 @@ pk_transaction_category_cb (PkBackendJob *job,
 
 	/* emit */
 	g_debug ("emitting category %s, %s, %s, %s, %s ", parent_id, cat_id, name, summary, icon);
+	pk_transaction_packages_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -647,6 +715,7 @@ pk_transaction_item_progress_cb (PkBackendJob *job,
 		 pk_item_progress_get_package_id (item_progress),
 		 pk_status_enum_to_string (pk_item_progress_get_status (item_progress)),
 		 pk_item_progress_get_percentage (item_progress));
+	pk_transaction_packages_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -685,6 +754,7 @@ pk_transaction_distro_upgrade_cb (PkBackendJob *job,
 	g_debug ("emitting distro-upgrade %s, %s, %s",
 		 pk_update_state_enum_to_string (state),
 		 name, summary);
+	pk_transaction_packages_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -938,7 +1008,6 @@ pk_transaction_offline_finished (PkTransaction *transaction)
 	PkBitfield transaction_flags;
 	gchar **package_ids;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(GPtrArray) array = NULL;
 
 	/* if we're doing UpdatePackages[only-download] then update the
 	 * prepared-updates file */
@@ -981,8 +1050,7 @@ pk_transaction_offline_finished (PkTransaction *transaction)
 	case PK_ROLE_ENUM_GET_UPDATES:
 		/* if we do get-updates and there's no updates then remove
 		 * prepared-updates so the UI doesn't display update & reboot */
-		array = pk_results_get_package_array (transaction->priv->results);
-		if (array->len == 0) {
+		if (transaction->priv->packages_emitted == 0) {
 			if (!pk_offline_auth_invalidate (&error)) {
 				g_warning ("failed to invalidate: %s",
 					   error->message);
@@ -1008,6 +1076,64 @@ pk_transaction_offline_finished (PkTransaction *transaction)
 	}
 }
 
+/* the results only depend on the arguments and the packages, and can be
+ * reused until something changes */
+static gboolean
+pk_transaction_is_cacheable (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	/* the backend does not tell us about changes made outside PackageKit */
+	if (!pk_backend_supports_results_cache (priv->backend))
+		return FALSE;
+
+	/* the caller asked for metadata no older than the cache-age hint */
+	if (pk_backend_job_get_cache_age (priv->job) != G_MAXUINT)
+		return FALSE;
+
+	switch (priv->role) {
+	case PK_ROLE_ENUM_GET_DETAILS:
+	case PK_ROLE_ENUM_GET_PACKAGES:
+	case PK_ROLE_ENUM_GET_UPDATES:
+	case PK_ROLE_ENUM_RESOLVE:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/* queries may give different results while and after this runs */
+static gboolean
+pk_transaction_changes_state (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	if (pk_bitfield_contain (priv->cached_transaction_flags,
+				 PK_TRANSACTION_FLAG_ENUM_SIMULATE))
+		return FALSE;
+	if (pk_bitfield_contain (priv->cached_transaction_flags,
+				 PK_TRANSACTION_FLAG_ENUM_ONLY_DOWNLOAD))
+		return FALSE;
+
+	switch (priv->role) {
+	case PK_ROLE_ENUM_ACCEPT_EULA:
+	case PK_ROLE_ENUM_INSTALL_FILES:
+	case PK_ROLE_ENUM_INSTALL_PACKAGES:
+	case PK_ROLE_ENUM_INSTALL_SIGNATURE:
+	case PK_ROLE_ENUM_REFRESH_CACHE:
+	case PK_ROLE_ENUM_REMOVE_PACKAGES:
+	case PK_ROLE_ENUM_REPAIR_SYSTEM:
+	case PK_ROLE_ENUM_REPO_ENABLE:
+	case PK_ROLE_ENUM_REPO_REMOVE:
+	case PK_ROLE_ENUM_REPO_SET_DATA:
+	case PK_ROLE_ENUM_UPDATE_PACKAGES:
+	case PK_ROLE_ENUM_UPGRADE_SYSTEM:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
 static void
 pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransaction *transaction)
 {
@@ -1059,6 +1185,22 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 	if (exit_enum == PK_EXIT_ENUM_SUCCESS)
 		pk_transaction_finish_invalidate_caches (transaction);
 
+	/* keep the results of a query for the next identical one, or drop
+	 * the ones that may now be different even if we failed half way */
+	if (transaction->priv->results_cache_results != NULL &&
+	    exit_enum == PK_EXIT_ENUM_SUCCESS) {
+		if (pk_results_cache_add (pk_backend_get_results_cache (transaction->priv->backend),
+					  transaction->priv->results_cache_key,
+					  transaction->priv->results_cache_generation,
+					  transaction->priv->results_cache_results))
+			g_debug ("added %s results to the cache", pk_role_enum_to_string (transaction->priv->role));
+	}
+	g_clear_object (&transaction->priv->results_cache_results);
+	if (pk_transaction_changes_state (transaction)) {
+		pk_results_cache_invalidate (pk_backend_get_results_cache (transaction->priv->backend),
+					     pk_role_enum_to_string (transaction->priv->role));
+	}
+
 	/* find the length of time we have been running */
 	time_ms = pk_transaction_get_runtime (transaction);
 	g_debug ("backend was running for %i ms", time_ms);
@@ -1145,7 +1287,7 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 
 static void
 pk_transaction_package_cb (PkBackend *backend,
-			   PkPackage *item,
+			   PkBackendJobPackage *item,
 			   PkTransaction *transaction)
 {
 	const gchar *role_text;
@@ -1153,6 +1295,7 @@ pk_transaction_package_cb (PkBackend *backend,
 	PkInfoEnum update_severity;
 	const gchar *package_id;
 	const gchar *summary = NULL;
+	gboolean keep_package;
 	guint encoded_value;
 
 	g_return_if_fail (PK_IS_TRANSACTION (transaction));
@@ -1165,7 +1308,7 @@ pk_transaction_package_cb (PkBackend *backend,
 	}
 
 	/* check the backend is doing the right thing */
-	info = pk_package_get_info (item);
+	info = item->info;
 	if (transaction->priv->role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
 	    transaction->priv->role == PK_ROLE_ENUM_UPDATE_PACKAGES) {
 		if (info == PK_INFO_ENUM_INSTALLED) {
@@ -1198,15 +1341,31 @@ pk_transaction_package_cb (PkBackend *backend,
 		}
 	}
 
-	/* add to results even if we already got a result */
-	if (info != PK_INFO_ENUM_FINISHED)
-		pk_results_add_package (transaction->priv->results, item);
+	/* add to results even if we already got a result, but only keep the
+	 * full package for the roles that log or inspect them when finished */
+	if (info != PK_INFO_ENUM_FINISHED) {
+		transaction->priv->packages_emitted++;
+		keep_package = transaction->priv->role == PK_ROLE_ENUM_UPDATE_PACKAGES ||
+			       transaction->priv->role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
+			       transaction->priv->role == PK_ROLE_ENUM_REMOVE_PACKAGES;
+		if (transaction->priv->packages_emitted > PK_TRANSACTION_RESULTS_CACHE_ITEMS_MAX)
+			g_clear_object (&transaction->priv->results_cache_results);
+
+		/* the record belongs to the job, the results need a copy */
+		if (keep_package || transaction->priv->results_cache_results != NULL) {
+			g_autoptr(PkPackage) package = pk_backend_job_package_to_package (item);
+			if (keep_package)
+				pk_results_add_package (transaction->priv->results, package);
+			if (transaction->priv->results_cache_results != NULL)
+				pk_results_add_package (transaction->priv->results_cache_results, package);
+		}
+	}
 
 	/* emit */
-	package_id = pk_package_get_id (item);
+	package_id = item->package_id;
 	g_free (transaction->priv->last_package_id);
 	transaction->priv->last_package_id = g_strdup (package_id);
-	summary = pk_package_get_summary (item);
+	summary = item->summary;
 	if (transaction->priv->role != PK_ROLE_ENUM_GET_PACKAGES) {
 		g_debug ("emit package %s, %s, %s",
 			 pk_info_enum_to_string (info),
@@ -1217,9 +1376,31 @@ pk_transaction_package_cb (PkBackend *backend,
 	/* Safety checks, that the two values do not interleave, neither overflow */
 	g_assert ((PK_INFO_ENUM_LAST & (~0xFFFF)) == 0);
 
-	update_severity = pk_package_get_update_severity (item);
+	update_severity = item->update_severity;
 	encoded_value = info | (((guint32) update_severity) << 16);
 
+	/* the client asked for the results to be coalesced */
+	if (transaction->priv->batch_packages) {
+		PkTransactionPrivate *priv = transaction->priv;
+		if (priv->packages_batch == NULL)
+			priv->packages_batch = g_variant_builder_new (G_VARIANT_TYPE ("a(uss)"));
+		g_variant_builder_add (priv->packages_batch, "(uss)",
+				       encoded_value,
+				       package_id,
+				       summary ? summary : "");
+		if (++priv->packages_batch_len >= PK_TRANSACTION_PACKAGES_BATCH_MAX) {
+			pk_transaction_packages_flush (transaction);
+		} else if (priv->packages_batch_id == 0) {
+			priv->packages_batch_id =
+				g_timeout_add (PK_TRANSACTION_PACKAGES_BATCH_TIMEOUT,
+					       pk_transaction_packages_flush_cb,
+					       transaction);
+			g_source_set_name_by_id (priv->packages_batch_id,
+						 "[PkTransaction] packages-batch");
+		}
+		return;
+	}
+
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1252,6 +1433,7 @@ pk_transaction_repo_detail_cb (PkBackend *backend,
 	description = pk_repo_detail_get_description (item);
 	enabled = pk_repo_detail_get_enabled (item);
 	g_debug ("emitting repo-detail %s, %s, %i", repo_id, description, enabled);
+	pk_transaction_packages_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1301,6 +1483,7 @@ pk_transaction_repo_signature_required_cb (PkBackend *backend,
 		 package_id, repository_name, key_url, key_userid, key_id,
 		 key_fingerprint, key_timestamp,
 		 pk_sig_type_enum_to_string (type));
+	pk_transaction_packages_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1346,6 +1529,7 @@ pk_transaction_eula_required_cb (PkBackend *backend,
 	/* emit */
 	g_debug ("emitting eula-required %s, %s, %s, %s",
 		   eula_id, package_id, vendor_name, license_agreement);
+	pk_transaction_packages_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1389,6 +1573,7 @@ pk_transaction_media_change_required_cb (PkBackend *backend,
 		 pk_media_type_enum_to_string (media_type),
 		 media_id,
 		 media_text);
+	pk_transaction_packages_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1454,6 +1639,7 @@ pk_transaction_require_restart_cb (PkBackend *backend,
 	g_debug ("emitting require-restart %s, '%s'",
 		 pk_restart_enum_to_string (restart),
 		 package_id);
+	pk_transaction_packages_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1522,6 +1708,7 @@ pk_transaction_update_detail_cb (PkBackend *backend,
 	issued = pk_update_detail_get_issued (item);
 	updated = pk_update_detail_get_updated (item);
 	g_debug ("emitting update-detail for %s", package_id);
+	pk_transaction_packages_flush (transaction);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -1636,6 +1823,74 @@ pk_transaction_percentage_cb (PkBackendJob *job,
 					      g_variant_new_uint32 (percentage));
 }
 
+/*
+ * pk_transaction_results_cache_replay:
+ *
+ * Emits the results of an identical query that was run since the
+ * packages last changed, and finishes the transaction without running
+ * the backend. When there are none, what the backend emits is recorded
+ * so the next identical query can use it.
+ */
+static gboolean
+pk_transaction_results_cache_replay (PkTransaction *transaction)
+{
+	PkDetails *details;
+	PkPackage *package;
+	PkResultsCache *cache;
+	PkTransactionPrivate *priv = transaction->priv;
+	const gchar *locale;
+	guint i;
+	g_autofree gchar *filters = NULL;
+	g_autofree gchar *values = NULL;
+	g_autoptr(GPtrArray) details_array = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	/* everything the results depend on */
+	filters = pk_filter_bitfield_to_string (priv->cached_filters);
+	locale = pk_backend_job_get_locale (priv->job);
+	if (priv->cached_package_ids != NULL)
+		values = g_strjoinv ("\t", priv->cached_package_ids);
+	g_free (priv->results_cache_key);
+	priv->results_cache_key = g_strdup_printf ("%s\n%s\n%s\n%s",
+						   pk_role_enum_to_string (priv->role),
+						   filters,
+						   locale != NULL ? locale : "",
+						   values != NULL ? values : "");
+
+	cache = pk_backend_get_results_cache (priv->backend);
+	priv->results_cache_generation = pk_results_cache_get_generation (cache);
+	results = pk_results_cache_lookup (cache, priv->results_cache_key);
+	if (results == NULL) {
+		g_clear_object (&priv->results_cache_results);
+		priv->results_cache_results = pk_results_new ();
+		return FALSE;
+	}
+
+	g_debug ("using cached results for %s", pk_role_enum_to_string (priv->role));
+	packages = pk_results_get_package_array (results);
+	for (i = 0; i < packages->len; i++) {
+		PkBackendJobPackage item;
+		package = g_ptr_array_index (packages, i);
+		item.package_id = pk_package_get_id (package);
+		item.summary = pk_package_get_summary (package);
+		item.info = pk_package_get_info (package);
+		item.update_severity = pk_package_get_update_severity (package);
+		pk_transaction_package_cb (priv->backend, &item, transaction);
+	}
+	details_array = pk_results_get_details_array (results);
+	for (i = 0; i < details_array->len; i++) {
+		details = g_ptr_array_index (details_array, i);
+		pk_transaction_details_cb (priv->job, details, transaction);
+	}
+
+	pk_results_set_exit_code (priv->results, PK_EXIT_ENUM_SUCCESS);
+	priv->finished = TRUE;
+	pk_transaction_db_set_finished (priv->transaction_db, priv->tid, TRUE, 0);
+	pk_transaction_finished_emit (transaction, PK_EXIT_ENUM_SUCCESS, 0);
+	return TRUE;
+}
+
 gboolean
 pk_transaction_run (PkTransaction *transaction)
 {
@@ -1664,6 +1919,15 @@ pk_transaction_run (PkTransaction *transaction)
 		return TRUE;
 	}
 
+	/* an identical query may already have been answered */
+	if (pk_transaction_is_cacheable (transaction)) {
+		if (pk_transaction_results_cache_replay (transaction))
+			return TRUE;
+	} else if (pk_transaction_changes_state (transaction)) {
+		pk_results_cache_invalidate (pk_backend_get_results_cache (priv->backend),
+					     pk_role_enum_to_string (priv->role));
+	}
+
 	/* run the job */
 	pk_backend_start_job (priv->backend, priv->job);
 
@@ -4452,6 +4716,23 @@ pk_transaction_set_hint (PkTransaction *transaction,
 		return TRUE;
 	}
 
+	/* batch-packages=true */
+	if (g_strcmp0 (key, "batch-packages") == 0) {
+		if (g_strcmp0 (value, "true") == 0) {
+			priv->batch_packages = TRUE;
+		} else if (g_strcmp0 (value, "false") == 0) {
+			pk_transaction_packages_flush (transaction);
+			priv->batch_packages = FALSE;
+		} else {
+			g_set_error (error,
+				     PK_TRANSACTION_ERROR,
+				     PK_TRANSACTION_ERROR_NOT_SUPPORTED,
+				     "batch-packages hint expects true or false, not %s", value);
+			return FALSE;
+		}
+		return TRUE;
+	}
+
 	/* cache-age=<time-in-seconds> */
 	if (g_strcmp0 (key, "cache-age") == 0) {
 		guint cache_age;
@@ -4473,6 +4754,19 @@ pk_transaction_set_hint (PkTransaction *transaction,
 		return TRUE;
 	}
 
+	/* plan-token=<opaque string shared by a simulation and its transaction> */
+	if (g_strcmp0 (key, "plan-token") == 0) {
+		if (value == NULL || value[0] == '\0') {
+			g_set_error_literal (error,
+					     PK_TRANSACTION_ERROR,
+					     PK_TRANSACTION_ERROR_NOT_SUPPORTED,
+					     "Could not set plan-token to nothing");
+			return FALSE;
+		}
+		pk_backend_job_set_plan_token (priv->job, value);
+		return TRUE;
+	}
+
 	/* to preserve forwards and backwards compatibility, we ignore
 	 * extra options here */
 	g_warning ("unknown option: %s with value %s", key, value);
@@ -4992,6 +5286,7 @@ pk_transaction_reset_after_lock_error (PkTransaction *transaction)
 	/* clear results */
 	g_object_unref (priv->results);
 	priv->results = pk_results_new ();
+	priv->packages_emitted = 0;
 
 	/* reset transaction state */
 	/* first set state manually, otherwise set_state will refuse to switch to an earlier stage */
@@ -5070,6 +5365,15 @@ pk_transaction_dispose (GObject *object)
 		pk_transaction_finished_emit (transaction, PK_EXIT_ENUM_FAILED, 0);
 	}
 
+	if (transaction->priv->packages_batch_id > 0) {
+		g_source_remove (transaction->priv->packages_batch_id);
+		transaction->priv->packages_batch_id = 0;
+	}
+	if (transaction->priv->packages_batch != NULL) {
+		g_variant_builder_unref (transaction->priv->packages_batch);
+		transaction->priv->packages_batch = NULL;
+	}
+
 	if (transaction->priv->registration_id > 0) {
 		g_dbus_connection_unregister_object (transaction->priv->connection,
 						     transaction->priv->registration_id);
@@ -5105,6 +5409,9 @@ pk_transaction_finalize (GObject *object)
 	if (transaction->priv->watch_id > 0)
 		g_bus_unwatch_name (transaction->priv->watch_id);
 	g_free (transaction->priv->last_package_id);
+	g_free (transaction->priv->results_cache_key);
+	if (transaction->priv->results_cache_results != NULL)
+		g_object_unref (transaction->priv->results_cache_results);
 	g_free (transaction->priv->cached_package_id);
 	g_free (transaction->priv->cached_key_id);
 	g_strfreev (transaction->priv->cached_package_ids);